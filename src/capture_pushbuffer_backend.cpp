@@ -0,0 +1,106 @@
+#include "capture_pushbuffer_backend.h"
+
+#include <cstring>
+
+#include "pbkpp_assert.h"
+#include "pushbuffer_capture_format.h"
+
+namespace PBKitPlusPlus {
+
+CapturePushbufferBackend::CapturePushbufferBackend(std::shared_ptr<PushbufferBackend> target, const char *filename)
+    : target_(std::move(target)) {
+  PBKPP_ASSERT(target_ && "CapturePushbufferBackend requires a target backend");
+
+  file_ = fopen(filename, "wb");
+  if (!file_) {
+    return;
+  }
+
+  PushbufferCaptureFileHeader header{kPushbufferCaptureMagic, kPushbufferCaptureVersion};
+  if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+    Close();
+  }
+}
+
+CapturePushbufferBackend::~CapturePushbufferBackend() { Close(); }
+
+void CapturePushbufferBackend::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+uint32_t *CapturePushbufferBackend::Begin() {
+  block_start_ = target_->Begin();
+  return block_start_;
+}
+
+void CapturePushbufferBackend::End(uint32_t *head) {
+  WriteTagRecords();
+  WriteRecord(CAPTURE_RECORD_BLOCK, block_start_, static_cast<uint32_t>(head - block_start_));
+  block_start_ = nullptr;
+  target_->End(head);
+}
+
+void CapturePushbufferBackend::Reset() {
+  WriteRecord(CAPTURE_RECORD_FLUSH, nullptr, 0);
+  target_->Reset();
+}
+
+void CapturePushbufferBackend::Wrap() {
+  WriteRecord(CAPTURE_RECORD_WRAP, nullptr, 0);
+  target_->Wrap();
+}
+
+void CapturePushbufferBackend::EndFrame() {
+  WriteRecord(CAPTURE_RECORD_FRAME_END, nullptr, 0);
+  target_->EndFrame();
+}
+
+void CapturePushbufferBackend::Call(const uint32_t *position, uint32_t num_indices) {
+  if (num_indices) {
+    const uint32_t payload[] = {static_cast<uint32_t>(position - block_start_), num_indices};
+    WriteRecord(CAPTURE_RECORD_CALL_INDICES, payload, 2);
+  }
+  target_->Call(position, num_indices);
+}
+
+void CapturePushbufferBackend::InvalidateState() {
+  WriteRecord(CAPTURE_RECORD_INVALIDATE, nullptr, 0);
+  target_->InvalidateState();
+}
+
+void CapturePushbufferBackend::Tag(const uint32_t *position, const char *tag) {
+  uint32_t offset = position && block_start_ ? static_cast<uint32_t>(position - block_start_) : 0;
+  pending_tags_.push_back({offset, tag ? tag : ""});
+  target_->Tag(position, tag);
+}
+
+void CapturePushbufferBackend::WriteTagRecords() {
+  std::vector<uint32_t> payload;
+  for (auto &pending : pending_tags_) {
+    // One dword for the offset followed by the string and its terminator, rounded up to whole dwords.
+    auto string_dwords = static_cast<uint32_t>((pending.tag.size() + sizeof(uint32_t)) / sizeof(uint32_t));
+    payload.assign(1 + string_dwords, 0);
+    payload[0] = pending.offset;
+    memcpy(payload.data() + 1, pending.tag.c_str(), pending.tag.size());
+    WriteRecord(CAPTURE_RECORD_TAG, payload.data(), static_cast<uint32_t>(payload.size()));
+  }
+  pending_tags_.clear();
+}
+
+void CapturePushbufferBackend::WriteRecord(uint32_t type, const uint32_t *payload, uint32_t num_dwords) {
+  if (!file_) {
+    return;
+  }
+
+  // A failed write leaves a partial record behind, so nothing further is written and IsOpen reports the failure.
+  PushbufferCaptureRecordHeader header{type, num_dwords};
+  if (fwrite(&header, sizeof(header), 1, file_) != 1 ||
+      (num_dwords && fwrite(payload, sizeof(*payload), num_dwords, file_) != num_dwords)) {
+    Close();
+  }
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,67 @@
+#ifndef PBKITPLUSPLUS_SRC_CAPTURE_PUSHBUFFER_BACKEND_H_
+#define PBKITPLUSPLUS_SRC_CAPTURE_PUSHBUFFER_BACKEND_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pushbuffer_backend.h"
+
+namespace PBKitPlusPlus {
+
+//! Forwards pushbuffer blocks to another backend while appending them to a capture file.
+//!
+//! The file uses the format described in pushbuffer_capture_format.h and may be parsed on the host with the
+//! pushbuffer_capture utility library. E.g.,
+//!
+//! `Pushbuffer::SetBackend(std::make_shared<CapturePushbufferBackend>(Pushbuffer::GetBackend(), "e:\\frame.pbc"));`
+class CapturePushbufferBackend : public PushbufferBackend {
+ public:
+  CapturePushbufferBackend(std::shared_ptr<PushbufferBackend> target, const char *filename);
+  ~CapturePushbufferBackend() override;
+
+  CapturePushbufferBackend(const CapturePushbufferBackend &) = delete;
+  CapturePushbufferBackend &operator=(const CapturePushbufferBackend &) = delete;
+
+  uint32_t *Begin() override;
+  void End(uint32_t *head) override;
+  bool Busy() override { return target_->Busy(); }
+  void Reset() override;
+  void Wrap() override;
+  void EndFrame() override;
+  void Call(const uint32_t *position, uint32_t num_indices) override;
+  void InvalidateState() override;
+  void Tag(const uint32_t *position, const char *tag) override;
+
+  //! Returns true if the capture file was opened successfully and every record so far has been written to it. Writing
+  //! stops at the first failure, in which case the file may end with a partial record.
+  [[nodiscard]] bool IsOpen() const { return file_ != nullptr; }
+
+  //! Returns the backend that blocks are forwarded to.
+  [[nodiscard]] const std::shared_ptr<PushbufferBackend> &GetTarget() const { return target_; }
+
+ private:
+  struct PendingTag {
+    //! Offset in dwords from the start of the block.
+    uint32_t offset;
+    std::string tag;
+  };
+
+  //! Closes the capture file. Subsequent records are discarded.
+  void Close();
+  void WriteRecord(uint32_t type, const uint32_t *payload, uint32_t num_dwords);
+  void WriteTagRecords();
+
+  std::shared_ptr<PushbufferBackend> target_;
+  FILE *file_ = nullptr;
+  //! The start of the block currently being written.
+  uint32_t *block_start_ = nullptr;
+  //! Tags that apply to the block currently being written, which are written out ahead of it.
+  std::vector<PendingTag> pending_tags_;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_CAPTURE_PUSHBUFFER_BACKEND_H_
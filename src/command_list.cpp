@@ -0,0 +1,181 @@
+#include "command_list.h"
+
+#ifdef XBOX
+#include <pbkit/pbkit.h>
+#endif
+#include <xboxkrnl/xboxkrnl.h>
+
+#include <cstring>
+
+#include "nxdk_ext.h"
+#include "pbkpp_assert.h"
+#include "pushbuffer.h"
+#include "recording_pushbuffer_backend.h"
+
+namespace PBKitPlusPlus {
+
+// Extracts the parameter count from a method header.
+static constexpr uint32_t MethodParamCount(uint32_t header) { return (header >> 18) & 0x7FF; }
+
+CommandList::CommandList() = default;
+
+CommandList::~CommandList() {
+  PBKPP_ASSERT(!recorder_ && "CommandList destroyed while recording");
+  ReleaseResident();
+}
+
+void CommandList::BeginRecording() {
+  PBKPP_ASSERT(!recorder_ && "BeginRecording called on a CommandList that is already recording");
+
+  Clear();
+  recorder_ = std::make_shared<RecordingPushbufferBackend>();
+  Pushbuffer::BeginCapture(recorder_);
+}
+
+void CommandList::EndRecording() {
+  PBKPP_ASSERT(recorder_ && "EndRecording must not be called without BeginRecording");
+
+  Pushbuffer::EndCapture();
+  dwords_ = recorder_->GetDwords();
+  for (auto &call : recorder_->GetCalls()) {
+    calls_.push_back({call.offset, call.num_indices});
+  }
+  recorder_.reset();
+
+  // Precompute the chunk boundaries so that replay is a simple sequence of copies.
+  uint32_t chunk_start = 0;
+  uint32_t offset = 0;
+  auto next_call = calls_.begin();
+  const auto num_dwords = static_cast<uint32_t>(dwords_.size());
+  while (offset < num_dwords) {
+    uint32_t method_size = 1;
+    if (next_call != calls_.end() && next_call->offset == offset) {
+      // Subroutine calls are a single dword and must not be parsed as a method header.
+      ++next_call;
+    } else {
+      method_size = Pushbuffer::MethodSize(MethodParamCount(dwords_[offset]));
+      PBKPP_ASSERT(method_size <= Pushbuffer::kMaxRawDwords && "Recorded method is too large to be replayed");
+    }
+
+    if (offset + method_size - chunk_start > Pushbuffer::kMaxRawDwords) {
+      chunk_ends_.push_back(offset);
+      chunk_start = offset;
+    }
+    offset += method_size;
+  }
+  PBKPP_ASSERT(offset == num_dwords && "Recorded stream ends with a partial method");
+
+  if (chunk_start < num_dwords) {
+    chunk_ends_.push_back(num_dwords);
+  }
+}
+
+uint32_t CommandList::MarkPatchSlot(uint32_t num_values) {
+  PBKPP_ASSERT(recorder_ && "MarkPatchSlot must be called while recording");
+
+  auto head = Pushbuffer::singleton_->head_;
+  auto end = head ? recorder_->GetRecordedOffset(head) : static_cast<uint32_t>(recorder_->GetDwords().size());
+  PBKPP_ASSERT(num_values && num_values <= end && "Patch slot exceeds the recorded commands");
+
+  patch_slots_.push_back({end - num_values, num_values});
+  return static_cast<uint32_t>(patch_slots_.size() - 1);
+}
+
+uint32_t CommandList::GetPatchSlotSize(uint32_t slot) const {
+  PBKPP_ASSERT(slot < patch_slots_.size() && "Invalid patch slot");
+  return patch_slots_[slot].num_values;
+}
+
+void CommandList::Patch(uint32_t slot, const uint32_t *values) {
+  PBKPP_ASSERT(!recorder_ && "Patch must not be called while recording");
+  PBKPP_ASSERT(slot < patch_slots_.size() && "Invalid patch slot");
+
+  auto &patch_slot = patch_slots_[slot];
+  memcpy(dwords_.data() + patch_slot.offset, values, patch_slot.num_values * sizeof(uint32_t));
+  if (resident_dwords_) {
+    memcpy(resident_dwords_ + patch_slot.offset, values, patch_slot.num_values * sizeof(uint32_t));
+    FlushWriteCombinedStores();
+  }
+}
+
+void CommandList::Patch(uint32_t slot, const float *values) { Patch(slot, reinterpret_cast<const uint32_t *>(values)); }
+
+void CommandList::Patch(uint32_t slot, uint32_t index, uint32_t value) {
+  PBKPP_ASSERT(!recorder_ && "Patch must not be called while recording");
+  PBKPP_ASSERT(slot < patch_slots_.size() && "Invalid patch slot");
+
+  auto &patch_slot = patch_slots_[slot];
+  PBKPP_ASSERT(index < patch_slot.num_values && "Patch index out of range");
+  dwords_[patch_slot.offset + index] = value;
+  if (resident_dwords_) {
+    resident_dwords_[patch_slot.offset + index] = value;
+    FlushWriteCombinedStores();
+  }
+}
+
+void CommandList::MakeResident() {
+  PBKPP_ASSERT(!recorder_ && "MakeResident must not be called while recording");
+  PBKPP_ASSERT(calls_.empty() && "Command lists containing subroutine calls may not be made resident");
+
+  ReleaseResident();
+
+  const auto num_dwords = static_cast<uint32_t>(dwords_.size());
+  resident_dwords_ = static_cast<uint32_t *>(MmAllocateContiguousMemoryEx(
+      (num_dwords + 1) * sizeof(uint32_t), 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE));
+  PBKPP_ASSERT(resident_dwords_ && "Failed to allocate resident command list.");
+
+  memcpy(resident_dwords_, dwords_.data(), num_dwords * sizeof(uint32_t));
+  resident_dwords_[num_dwords] = Pushbuffer::kSubroutineReturn;
+
+  FlushWriteCombinedStores();
+}
+
+void CommandList::CallResident() const {
+  PBKPP_ASSERT(resident_dwords_ && "CallResident requires MakeResident to have been called");
+
+  Pushbuffer::Begin();
+  Pushbuffer::PushCall(resident_dwords_);
+  Pushbuffer::End();
+}
+
+void CommandList::ReleaseResident() {
+  if (resident_dwords_) {
+    MmFreeContiguousMemory(resident_dwords_);
+    resident_dwords_ = nullptr;
+  }
+}
+
+void CommandList::Replay() const {
+  PBKPP_ASSERT(!recorder_ && "A CommandList may not be replayed while it is recording");
+
+  if (chunk_ends_.empty()) {
+    return;
+  }
+
+  Pushbuffer::Begin();
+  uint32_t chunk_start = 0;
+  auto next_call = calls_.begin();
+  for (auto chunk_end : chunk_ends_) {
+    Pushbuffer::PushRaw(dwords_.data() + chunk_start, chunk_end - chunk_start);
+
+    // Report any calls in the chunk so that the backend sees the same stream as when the list was recorded.
+    auto &backend = Pushbuffer::singleton_->backend_;
+    auto head = Pushbuffer::singleton_->head_;
+    for (; next_call != calls_.end() && next_call->offset < chunk_end; ++next_call) {
+      backend->Call(head - (chunk_end - next_call->offset), next_call->num_indices);
+    }
+    chunk_start = chunk_end;
+  }
+  Pushbuffer::End();
+}
+
+void CommandList::Clear() {
+  PBKPP_ASSERT(!recorder_ && "Clear must not be called while recording");
+  dwords_.clear();
+  chunk_ends_.clear();
+  patch_slots_.clear();
+  calls_.clear();
+  ReleaseResident();
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,133 @@
+#ifndef PBKITPLUSPLUS_SRC_COMMAND_LIST_H_
+#define PBKITPLUSPLUS_SRC_COMMAND_LIST_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PBKitPlusPlus {
+
+class RecordingPushbufferBackend;
+
+//! A captured sequence of pushbuffer commands that may be replayed any number of times.
+//!
+//! Everything pushed through `Pushbuffer` (including by `NV2AState` and the other helper classes) between
+//! BeginRecording and EndRecording is captured rather than submitted. Replaying copies the captured dwords into the live
+//! pushbuffer in a handful of bulk copies, so its cost is proportional to the size of the list rather than to the
+//! number of API calls that produced it.
+//!
+//! Operations that bypass the pushbuffer and talk to pbkit directly (e.g., pb_fill, pb_finished) are performed
+//! immediately while recording and are not captured. Redundant write filtering and ring submission are suspended while
+//! recording so that the captured stream does not depend on the state at the time it was recorded.
+//!
+//! Values that change between replays (e.g., a matrix or light position) may be marked as patch slots while recording
+//! and updated in place before each replay, avoiding the need to re-record the rest of the list.
+//!
+//! Large static lists may be made resident in contiguous memory, after which CallResident invokes them using the nv2a
+//! pushbuffer subroutine mechanism at the cost of a single dword in the live pushbuffer.
+class CommandList {
+ public:
+  CommandList();
+  ~CommandList();
+
+  CommandList(const CommandList &) = delete;
+  CommandList &operator=(const CommandList &) = delete;
+
+  //! Discards any previously recorded commands and starts capturing pushbuffer output.
+  //!
+  //! It is illegal to call this within a Begin/End block or while another CommandList is recording.
+  void BeginRecording();
+
+  //! Stops capturing pushbuffer output.
+  void EndRecording();
+
+  //! Marks the last num_values parameter dwords pushed while recording as a patch slot and returns its index.
+  //!
+  //! E.g., `Pushbuffer::Push3F(NV097_SET_LIGHT_LOCAL_POSITION, pos); slot = list.MarkPatchSlot(3);`
+  //!
+  //! The dwords must all be parameters of methods pushed since BeginRecording (i.e., not method headers).
+  uint32_t MarkPatchSlot(uint32_t num_values);
+
+  //! Returns the number of dwords in the given patch slot.
+  [[nodiscard]] uint32_t GetPatchSlotSize(uint32_t slot) const;
+
+  //! Overwrites the recorded values of the given patch slot. `values` must contain GetPatchSlotSize(slot) entries.
+  //!
+  //! If the list is resident, the resident copy is updated in place as well. A resident list must not be patched while
+  //! a previous CallResident may still be executing, as the GPU would read a mix of old and new values. Insert a Fence
+  //! after the call and wait on it before patching, or patch a separate list for each call in flight.
+  void Patch(uint32_t slot, const uint32_t *values);
+
+  //! Overwrites the recorded values of the given patch slot. `values` must contain GetPatchSlotSize(slot) entries.
+  //!
+  //! The same restrictions as for the uint32_t overload apply to resident lists.
+  void Patch(uint32_t slot, const float *values);
+
+  //! Overwrites a single value within the given patch slot.
+  //!
+  //! The same restrictions as for the other overloads apply to resident lists.
+  void Patch(uint32_t slot, uint32_t index, uint32_t value);
+
+  //! Returns true if this list is currently capturing pushbuffer output.
+  [[nodiscard]] bool IsRecording() const { return recorder_ != nullptr; }
+
+  //! Copies the recorded commands into the pushbuffer.
+  void Replay() const;
+
+  //! Copies the recorded commands, followed by a subroutine return, into contiguous memory so that they may be executed
+  //! by CallResident. Any previous resident copy is released.
+  //!
+  //! The nv2a does not support nested subroutines, so lists that contain calls (e.g., NV2AState::DrawElements with an
+  //! IndexBuffer) may not be made resident.
+  //!
+  //! The caller is responsible for ensuring that the GPU is not executing the previous resident copy (e.g., via a
+  //! Fence).
+  void MakeResident();
+
+  //! Returns true if MakeResident has been called since the list was last recorded or cleared.
+  [[nodiscard]] bool IsResident() const { return resident_dwords_ != nullptr; }
+
+  //! Pushes a subroutine call that causes the GPU to execute the resident copy of the list and then return to the
+  //! pushbuffer.
+  //!
+  //! The nv2a does not support nested subroutines, so resident lists must not themselves contain calls.
+  void CallResident() const;
+
+  //! Returns the recorded method headers and parameters.
+  [[nodiscard]] const std::vector<uint32_t> &GetDwords() const { return dwords_; }
+
+  //! Discards all recorded commands and releases any resident copy.
+  void Clear();
+
+ private:
+  //! Frees the resident copy of the list.
+  void ReleaseResident();
+
+  struct PatchSlot {
+    //! Offset of the first value within dwords_.
+    uint32_t offset;
+    uint32_t num_values;
+  };
+
+  //! A subroutine call command within dwords_, which is a single dword rather than a method.
+  struct SubroutineCall {
+    //! Offset of the call command within dwords_.
+    uint32_t offset;
+    //! Number of vertex indices submitted by the subroutine.
+    uint32_t num_indices;
+  };
+
+  std::shared_ptr<RecordingPushbufferBackend> recorder_;
+  std::vector<uint32_t> dwords_;
+  //! Offsets into dwords_ at which each replay chunk ends. Chunks hold whole methods and fit within a single block.
+  std::vector<uint32_t> chunk_ends_;
+  std::vector<PatchSlot> patch_slots_;
+  std::vector<SubroutineCall> calls_;
+
+  //! Copy of dwords_ in contiguous memory, terminated by a subroutine return.
+  uint32_t *resident_dwords_ = nullptr;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_COMMAND_LIST_H_
@@ -0,0 +1,139 @@
+#include "dynamic_vertex_ring.h"
+
+#include <pbkit/pbkit.h>
+#include <xboxkrnl/xboxkrnl.h>
+
+#include "pbkpp_assert.h"
+#include "pushbuffer.h"
+
+namespace PBKitPlusPlus {
+
+DynamicVertexRing::DynamicVertexRing(const VertexFormat &format, uint32_t capacity)
+    : format_(format), capacity_(capacity * format.GetStride()) {
+  PBKPP_ASSERT(format.GetStride() && "VertexFormat must contain at least one attribute.");
+  PBKPP_ASSERT(capacity && "DynamicVertexRing must hold at least one vertex.");
+
+  buffer_ = static_cast<uint8_t *>(
+      MmAllocateContiguousMemoryEx(capacity_, 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE));
+  PBKPP_ASSERT(buffer_ && "Failed to allocate dynamic vertex ring.");
+}
+
+DynamicVertexRing::~DynamicVertexRing() {
+  // The GPU may still be reading from the ring.
+  if (pending_count_) {
+    FenceManager::Wait(pending_[(pending_first_ + pending_count_ - 1) % kMaxPendingFences].fence);
+  }
+
+  if (buffer_) {
+    MmFreeContiguousMemory(buffer_);
+  }
+}
+
+DynamicVertexRing::Allocation DynamicVertexRing::Allocate(uint32_t num_vertices) {
+  PBKPP_ASSERT(!Pushbuffer::IsInBlock() && "DynamicVertexRing::Allocate may not be called within a pushbuffer block.");
+  PBKPP_ASSERT(num_vertices && "Allocation must contain at least one vertex.");
+  uint32_t size = num_vertices * format_.GetStride();
+  PBKPP_ASSERT(size <= capacity_ && "Allocation exceeds the capacity of the DynamicVertexRing.");
+
+  // Allocations must be contiguous, so any space at the end of the ring that is too small is skipped.
+  bool wrap = head_ + size > capacity_;
+  uint32_t skip = wrap ? capacity_ - head_ : 0;
+  uint32_t required = skip + size;
+
+  if (GetFreeBytes() < required) {
+    Reclaim(required, false);
+  }
+  if (GetFreeBytes() < required) {
+    Reclaim(required, true);
+  }
+  if (wrap && allocated_ == reclaimed_) {
+    // Nothing is outstanding, so the space skipped at the end of the ring is free immediately.
+    allocated_ += skip;
+    reclaimed_ += skip;
+    skip = 0;
+    required = size;
+  }
+  // Allocations that have not been drawn yet may still be being filled in, so their space is never reclaimed.
+  PBKPP_ASSERT(GetFreeBytes() >= required &&
+               "DynamicVertexRing is too small to hold the allocation alongside those that have not been drawn.");
+
+  if (wrap) {
+    allocated_ += skip;
+    head_ = 0;
+    ++wraps_;
+    cache_break_pending_ = true;
+  }
+
+  Allocation ret;
+  ret.data = buffer_ + head_;
+  ret.num_vertices = num_vertices;
+  ret.ring = this;
+
+  head_ += size;
+  allocated_ += size;
+  ret.end = allocated_;
+
+  ++total_allocations_;
+  total_bytes_ += size;
+  return ret;
+}
+
+void DynamicVertexRing::SetAttribute(const Allocation &allocation, uint32_t vertex_index, uint32_t attribute_index,
+                                     const float *values) const {
+  PBKPP_ASSERT(allocation.ring == this && "Allocation was not made from this DynamicVertexRing.");
+  PBKPP_ASSERT(vertex_index < allocation.num_vertices && "Invalid vertex_index.");
+  PBKPP_ASSERT(format_.HasAttribute(attribute_index) && "Attribute is not present in the vertex format.");
+
+  auto &attribute = format_.GetAttribute(attribute_index);
+  VertexFormat::PackAttribute(attribute, values, allocation.data + vertex_index * attribute.stride + attribute.offset);
+}
+
+void DynamicVertexRing::Retire(const Allocation &allocation, Fence fence) {
+  PBKPP_ASSERT(allocation.ring == this);
+
+  if (pending_count_ == kMaxPendingFences) {
+    // Fences are signaled in order, so the newest entry can simply be extended to cover this draw as well.
+    auto &newest = pending_[(pending_first_ + pending_count_ - 1) % kMaxPendingFences];
+    newest.fence = fence;
+    if (allocation.end > newest.end) {
+      newest.end = allocation.end;
+    }
+    return;
+  }
+
+  pending_[(pending_first_ + pending_count_) % kMaxPendingFences] = {fence, allocation.end};
+  ++pending_count_;
+}
+
+void DynamicVertexRing::Reclaim(uint32_t bytes, bool wait) {
+  while (pending_count_ && GetFreeBytes() < bytes) {
+    auto &oldest = pending_[pending_first_];
+    if (!FenceManager::IsSignaled(oldest.fence)) {
+      if (!wait) {
+        return;
+      }
+      ++stalls_;
+      FenceManager::Wait(oldest.fence);
+    }
+
+    if (oldest.end > reclaimed_) {
+      reclaimed_ = oldest.end;
+    }
+    pending_first_ = (pending_first_ + 1) % kMaxPendingFences;
+    --pending_count_;
+  }
+}
+
+DynamicVertexRing::Stats DynamicVertexRing::GetStats() const {
+  Stats ret{};
+  ret.capacity_bytes = capacity_;
+  ret.used_bytes = static_cast<uint32_t>(allocated_ - reclaimed_);
+  ret.pending_fences = pending_count_;
+  ret.total_allocations = total_allocations_;
+  ret.total_bytes = total_bytes_;
+  ret.wraps = wraps_;
+  ret.stalls = stalls_;
+  return ret;
+}
+
+}  // namespace PBKitPlusPlus
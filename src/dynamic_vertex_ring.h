@@ -0,0 +1,126 @@
+#ifndef PBKITPLUSPLUS_SRC_DYNAMIC_VERTEX_RING_H_
+#define PBKITPLUSPLUS_SRC_DYNAMIC_VERTEX_RING_H_
+
+#include <cstdint>
+
+#include "fence.h"
+#include "vertex_format.h"
+
+namespace PBKitPlusPlus {
+
+class NV2AState;
+
+//! Streams short lived vertex data (e.g., UI, particles, debug geometry) through a ring of contiguous memory.
+//!
+//! Each draw takes a fresh range of the ring with Allocate, fills it, and passes the allocation to
+//! NV2AState::DrawArrays, which inserts a Fence behind the draw. When the ring runs out of space, ranges whose fences
+//! the GPU has passed are reclaimed, so streaming neither allocates memory nor overwrites data that the GPU may still
+//! be reading. The CPU only waits if the ring is too small to hold the data of every draw in flight.
+//!
+//! Ranges are reclaimed in allocation order, so allocations must be drawn in the order they were made. An allocation
+//! that is never drawn is reclaimed along with the next one that is; until then, it continues to occupy the ring.
+//!
+//! E.g.,
+//!   DynamicVertexRing ring(format, 4096);
+//!   auto vertices = ring.Allocate(6);
+//!   for (uint32_t i = 0; i < 6; ++i) {
+//!     ring.SetAttribute(vertices, i, NV2A_VERTEX_ATTR_POSITION, positions[i]);
+//!   }
+//!   host.DrawArrays(vertices, format.GetAttributeMask());
+class DynamicVertexRing {
+ public:
+  //! Maximum number of fences tracked at once. Beyond this, consecutive draws share a fence.
+  static constexpr uint32_t kMaxPendingFences = 32;
+
+  //! A range of vertices taken from the ring.
+  struct Allocation {
+    //! The first vertex, laid out as described by DynamicVertexRing::GetFormat.
+    uint8_t *data{nullptr};
+    uint32_t num_vertices{0};
+    //! The ring the allocation was taken from.
+    DynamicVertexRing *ring{nullptr};
+    //! The ring position immediately following the allocation.
+    uint64_t end{0};
+  };
+
+  struct Stats {
+    uint32_t capacity_bytes;
+    //! Bytes that have been allocated but not yet reclaimed.
+    uint32_t used_bytes;
+    //! Number of draws whose fences have not yet been reclaimed.
+    uint32_t pending_fences;
+    uint64_t total_allocations;
+    uint64_t total_bytes;
+    //! Number of times the ring wrapped to the beginning.
+    uint32_t wraps;
+    //! Number of times Allocate had to wait for the GPU.
+    uint32_t stalls;
+  };
+
+  //! Reserves space for `capacity` vertices of the given format. The format is always interleaved.
+  DynamicVertexRing(const VertexFormat &format, uint32_t capacity);
+  ~DynamicVertexRing();
+
+  DynamicVertexRing(const DynamicVertexRing &) = delete;
+  DynamicVertexRing &operator=(const DynamicVertexRing &) = delete;
+
+  //! Returns space for `num_vertices` vertices, reclaiming (and if necessary waiting for) ranges used by earlier draws.
+  //! The ring must be large enough to hold the new allocation along with every earlier allocation that has not been
+  //! drawn.
+  //!
+  //! It is illegal to call this within a pushbuffer block, as it may need to wait on a fence.
+  Allocation Allocate(uint32_t num_vertices);
+
+  //! Sets the value of a single attribute of an allocated vertex, packing it into the attribute's type. See
+  //! VertexBuffer::SetAttribute.
+  void SetAttribute(const Allocation &allocation, uint32_t vertex_index, uint32_t attribute_index,
+                    const float *values) const;
+
+  [[nodiscard]] const VertexFormat &GetFormat() const { return format_; }
+  [[nodiscard]] uint32_t GetCapacity() const { return capacity_ / format_.GetStride(); }
+  [[nodiscard]] Stats GetStats() const;
+
+ private:
+  friend class NV2AState;
+
+  struct PendingFence {
+    Fence fence;
+    //! Ring position up to which data may be reclaimed once the fence is signaled.
+    uint64_t end;
+  };
+
+  //! Records that the given allocation has been drawn with the given fence behind it.
+  void Retire(const Allocation &allocation, Fence fence);
+
+  //! Reclaims ranges until `bytes` are free, waiting on fences if `wait` is true.
+  void Reclaim(uint32_t bytes, bool wait);
+
+  [[nodiscard]] uint32_t GetFreeBytes() const { return capacity_ - static_cast<uint32_t>(allocated_ - reclaimed_); }
+
+  VertexFormat format_;
+  uint8_t *buffer_{nullptr};
+  uint32_t capacity_;
+
+  //! Offset at which the next allocation will be made.
+  uint32_t head_{0};
+  //! Total bytes consumed (including space skipped when wrapping) and reclaimed over the life of the ring.
+  uint64_t allocated_{0};
+  uint64_t reclaimed_{0};
+
+  //! Fences in insertion order, stored as a circular queue.
+  PendingFence pending_[kMaxPendingFences]{};
+  uint32_t pending_first_{0};
+  uint32_t pending_count_{0};
+
+  //! Set when the ring wraps, as the GPU may still have the previous contents of reused memory in its vertex cache.
+  bool cache_break_pending_{false};
+
+  uint64_t total_allocations_{0};
+  uint64_t total_bytes_{0};
+  uint32_t wraps_{0};
+  uint32_t stalls_{0};
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_DYNAMIC_VERTEX_RING_H_
@@ -0,0 +1,96 @@
+#include "fence.h"
+
+#include <pbkit/pbkit.h>
+#include <xboxkrnl/xboxkrnl.h>
+
+#include "nxdk_ext.h"
+#include "pbkpp_assert.h"
+#include "pushbuffer.h"
+#include "pushbuffer_backend.h"
+
+namespace PBKitPlusPlus {
+
+volatile uint32_t *FenceManager::semaphore_ = nullptr;
+uint32_t FenceManager::last_inserted_value_ = 0;
+
+// Compares two semaphore values, accounting for wraparound.
+static inline bool HasReached(uint32_t completed, uint32_t value) {
+  return static_cast<int32_t>(completed - value) >= 0;
+}
+
+void FenceManager::Initialize() {
+  if (semaphore_) {
+    return;
+  }
+
+  semaphore_ = static_cast<volatile uint32_t *>(
+      MmAllocateContiguousMemoryEx(sizeof(uint32_t), 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE));
+  PBKPP_ASSERT(semaphore_ && "Failed to allocate fence semaphore.");
+  *semaphore_ = 0;
+  last_inserted_value_ = 0;
+}
+
+Fence FenceManager::Allocate() {
+  PBKPP_ASSERT(semaphore_ && "FenceManager::Initialize must be called before inserting fences.");
+
+  Fence fence{++last_inserted_value_};
+  // Zero is reserved for the default (always signaled) fence.
+  if (!fence.value) {
+    fence.value = ++last_inserted_value_;
+  }
+  return fence;
+}
+
+uint32_t FenceManager::GetSemaphoreOffset() {
+  PBKPP_ASSERT(semaphore_);
+  return reinterpret_cast<uint32_t>(semaphore_) & 0x03FFFFFF;
+}
+
+Fence FenceManager::Insert() {
+  // A release recorded into a CommandList would write a stale value to the semaphore each time the list is replayed.
+  PBKPP_ASSERT(!Pushbuffer::IsCapturing() && "Fences must not be inserted while recording a CommandList");
+
+  auto fence = Allocate();
+
+  // The context and offset are re-sent with each fence so that fences remain valid if the state is modified
+  // elsewhere. They are dropped by the redundant write filter when it is enabled.
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_CONTEXT_DMA_SEMAPHORE, kSemaphoreDMAChannel);
+  Pushbuffer::Push(NV097_SET_SEMAPHORE_OFFSET, GetSemaphoreOffset());
+  Pushbuffer::Push(NV097_BACK_END_WRITE_SEMAPHORE_RELEASE, fence.value);
+  Pushbuffer::End();
+
+  return fence;
+}
+
+bool FenceManager::IsSignaled(Fence fence) {
+  if (!fence.value || HasReached(GetCompletedValue(), fence.value)) {
+    return true;
+  }
+
+  // Once all submitted work has been consumed every fence outside of the open block has necessarily been passed. This
+  // also allows backends that never execute commands (e.g., RecordingPushbufferBackend) to make progress. While a
+  // CommandList is being recorded the live pushbuffer has no open block, and only its backend reflects the GPU.
+  if (Pushbuffer::IsCapturing()) {
+    return !Pushbuffer::GetSubmissionBackend()->Busy();
+  }
+  return !Pushbuffer::IsInBlock() && !Pushbuffer::GetBackend()->Busy();
+}
+
+void FenceManager::Wait(Fence fence) {
+  PBKPP_ASSERT(!Pushbuffer::IsInBlock() && "Wait must not be called within a pushbuffer block");
+  PBKPP_ASSERT(!Pushbuffer::IsCapturing() && "Wait must not be called while recording a CommandList");
+
+  while (!IsSignaled(fence)) {
+    /* Wait for completion... */
+  }
+}
+
+uint32_t FenceManager::GetCompletedValue() {
+  PBKPP_ASSERT(semaphore_);
+  return *semaphore_;
+}
+
+uint32_t FenceManager::GetLastInsertedValue() { return last_inserted_value_; }
+
+}  // namespace PBKitPlusPlus
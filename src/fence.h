@@ -0,0 +1,65 @@
+#ifndef PBKITPLUSPLUS_SRC_FENCE_H_
+#define PBKITPLUSPLUS_SRC_FENCE_H_
+
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+//! Identifies a point in the pushbuffer command stream that the GPU signals once every preceding command has been
+//! processed.
+struct Fence {
+  //! The semaphore value released when the fence is reached. A default constructed fence is always signaled.
+  uint32_t value = 0;
+};
+
+//! Issues fences backed by the nv2a back end semaphore.
+//!
+//! Each fence pushes a semaphore release that writes a monotonically increasing value into a word of contiguous memory
+//! once the GPU has finished with everything before it. This allows the CPU to wait for a specific point in the command
+//! stream (e.g., the last draw that reads a vertex buffer) rather than for the entire pipeline to become idle.
+class FenceManager {
+ public:
+  //! The context DMA channel through which the semaphore is written. pbkit configures DMA_A (channel 3) to span all of
+  //! physical memory.
+  static constexpr uint32_t kSemaphoreDMAChannel = 3;
+
+  //! Allocates the semaphore storage. Must be called after pbkit has been initialized.
+  static void Initialize();
+
+  //! Pushes a semaphore release and returns a fence that will be signaled once the GPU has processed it.
+  //!
+  //! The release is not visible to the GPU until the enclosing pushbuffer block (if any) has been ended. It is illegal to
+  //! call this while recording a CommandList, as each replay would release the same stale value.
+  static Fence Insert();
+
+  //! Reserves the next fence value without pushing anything. The caller is responsible for pushing a release of
+  //! `fence.value` to the semaphore at GetSemaphoreOffset() through kSemaphoreDMAChannel.
+  static Fence Allocate();
+
+  //! Returns the offset of the semaphore word within kSemaphoreDMAChannel.
+  static uint32_t GetSemaphoreOffset();
+
+  //! Returns true if the GPU has processed the given fence.
+  static bool IsSignaled(Fence fence);
+
+  //! Blocks until the GPU has processed the given fence.
+  //!
+  //! It is illegal to call this within a Begin/End block, as the fence may not have been submitted yet, or while
+  //! recording a CommandList.
+  static void Wait(Fence fence);
+
+  //! Returns the value of the most recent fence released by the GPU.
+  static uint32_t GetCompletedValue();
+
+  //! Returns the value of the most recently inserted fence.
+  static uint32_t GetLastInsertedValue();
+
+ private:
+  //! Semaphore word written by the GPU, in write combined contiguous memory.
+  static volatile uint32_t *semaphore_;
+  static uint32_t last_inserted_value_;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_FENCE_H_
@@ -0,0 +1,106 @@
+#include "frame_arena.h"
+
+#include <cstdlib>
+
+#include "pbkpp_assert.h"
+#include "pushbuffer_stats.h"
+
+namespace PBKitPlusPlus {
+
+// Granularity with which the backing buffer is grown.
+static constexpr size_t kGrowthGranularity = 64 * 1024;
+
+uint8_t *FrameArena::buffer_ = nullptr;
+size_t FrameArena::capacity_ = 0;
+size_t FrameArena::offset_ = 0;
+FrameArena::OverflowBlock *FrameArena::overflow_ = nullptr;
+size_t FrameArena::overflow_bytes_ = 0;
+size_t FrameArena::peak_usage_ = 0;
+uint32_t FrameArena::frame_heap_allocations_ = 0;
+uint32_t FrameArena::last_frame_heap_allocations_ = 0;
+uint64_t FrameArena::total_heap_allocations_ = 0;
+
+static inline uintptr_t AlignUp(uintptr_t value, size_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+void FrameArena::Initialize(size_t capacity) {
+  PBKPP_ASSERT(!offset_ && !overflow_ && "FrameArena::Initialize must not be called while allocations are live");
+
+  free(buffer_);
+  buffer_ = static_cast<uint8_t *>(malloc(capacity));
+  PBKPP_ASSERT(buffer_ && "Failed to allocate frame arena.");
+  capacity_ = capacity;
+  PBKPP_STATS_RECORD(HeapAllocation);
+  ++frame_heap_allocations_;
+  ++total_heap_allocations_;
+}
+
+void *FrameArena::Allocate(size_t size, size_t alignment) {
+  PBKPP_ASSERT(alignment && !(alignment & (alignment - 1)) && "Alignment must be a power of two");
+
+  if (!buffer_) {
+    Initialize();
+  }
+
+  auto base = reinterpret_cast<uintptr_t>(buffer_);
+  auto start = AlignUp(base + offset_, alignment) - base;
+  if (start + size > capacity_) {
+    return AllocateOverflow(size, alignment);
+  }
+
+  offset_ = start + size;
+  if (offset_ + overflow_bytes_ > peak_usage_) {
+    peak_usage_ = offset_ + overflow_bytes_;
+  }
+  return buffer_ + start;
+}
+
+void *FrameArena::AllocateOverflow(size_t size, size_t alignment) {
+  auto block_size = sizeof(OverflowBlock) + size + alignment;
+  auto block = static_cast<OverflowBlock *>(malloc(block_size));
+  PBKPP_ASSERT(block && "Failed to allocate frame arena overflow block.");
+  PBKPP_STATS_RECORD(HeapAllocation);
+  ++frame_heap_allocations_;
+  ++total_heap_allocations_;
+
+  block->next = overflow_;
+  block->size = block_size;
+  overflow_ = block;
+  overflow_bytes_ += block_size;
+  if (offset_ + overflow_bytes_ > peak_usage_) {
+    peak_usage_ = offset_ + overflow_bytes_;
+  }
+
+  return reinterpret_cast<void *>(AlignUp(reinterpret_cast<uintptr_t>(block + 1), alignment));
+}
+
+void FrameArena::FreeOverflow(void *until) {
+  while (overflow_ && overflow_ != until) {
+    auto next = overflow_->next;
+    overflow_bytes_ -= overflow_->size;
+    free(overflow_);
+    overflow_ = next;
+  }
+}
+
+FrameArena::Marker FrameArena::GetMarker() { return {offset_, overflow_}; }
+
+void FrameArena::Rewind(const Marker &marker) {
+  PBKPP_ASSERT(marker.offset <= offset_ && "FrameArena markers must not outlive a Reset");
+  FreeOverflow(marker.overflow);
+  offset_ = marker.offset;
+}
+
+void FrameArena::Reset() {
+  FreeOverflow(nullptr);
+  offset_ = 0;
+
+  if (peak_usage_ > capacity_) {
+    Initialize(AlignUp(peak_usage_, kGrowthGranularity));
+  }
+  peak_usage_ = 0;
+
+  last_frame_heap_allocations_ = frame_heap_allocations_;
+  frame_heap_allocations_ = 0;
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,109 @@
+#ifndef PBKITPLUSPLUS_SRC_FRAME_ARENA_H_
+#define PBKITPLUSPLUS_SRC_FRAME_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+//! Linear allocator for scratch memory that is only needed while building commands for the current frame.
+//!
+//! Allocations are carved out of a single buffer and are never freed individually. Instead, the arena is rewound to a
+//! marker (see ScopedFrameArenaMarker) or reset entirely, which NV2AState::PrepareDraw does at the start of each frame.
+//! Requests that do not fit in the buffer are satisfied from the heap and the buffer is grown on the next Reset, so once
+//! the working set of a frame has been seen the arena makes no further heap allocations.
+//!
+//! As the buffer never shrinks, the arena should only be used for scratch memory that is needed every frame. Large
+//! one-off allocations (e.g., texture conversions) should come from the heap instead.
+class FrameArena {
+ public:
+  static constexpr size_t kDefaultCapacity = 256 * 1024;
+  static constexpr size_t kDefaultAlignment = 16;
+
+  //! Identifies a point that the arena may be rewound to.
+  struct Marker {
+    size_t offset;
+    void *overflow;
+  };
+
+  //! Allocates the backing buffer. Called automatically by the first allocation if necessary.
+  static void Initialize(size_t capacity = kDefaultCapacity);
+
+  //! Returns `size` bytes of uninitialized memory with the given (power of two) alignment. The memory remains valid
+  //! until the arena is rewound past it or reset.
+  static void *Allocate(size_t size, size_t alignment = kDefaultAlignment);
+
+  //! Returns uninitialized storage for `count` instances of T.
+  template <typename T>
+  static T *Allocate(size_t count) {
+    return static_cast<T *>(Allocate(count * sizeof(T), alignof(T) > kDefaultAlignment ? alignof(T) : kDefaultAlignment));
+  }
+
+  //! Returns a marker for the current allocation position.
+  static Marker GetMarker();
+
+  //! Releases every allocation made since the given marker was retrieved.
+  static void Rewind(const Marker &marker);
+
+  //! Releases every allocation. Any pointers previously returned by Allocate become invalid.
+  //!
+  //! If allocations spilled to the heap since the last reset, the backing buffer is grown to the peak usage.
+  static void Reset();
+
+  //! Returns the size of the backing buffer.
+  static size_t GetCapacity() { return capacity_; }
+
+  //! Returns the number of bytes currently allocated from the backing buffer, including alignment padding.
+  static size_t GetUsed() { return offset_; }
+
+  //! Returns the number of heap allocations made by the arena since the last Reset. Allocations made elsewhere are
+  //! counted by PushbufferStats when instrumentation is enabled.
+  static uint32_t GetFrameHeapAllocations() { return frame_heap_allocations_; }
+
+  //! Returns the number of heap allocations made by the arena between the two most recent calls to Reset. This is zero
+  //! in the steady state.
+  static uint32_t GetLastFrameHeapAllocations() { return last_frame_heap_allocations_; }
+
+  //! Returns the total number of heap allocations made by the arena.
+  static uint64_t GetTotalHeapAllocations() { return total_heap_allocations_; }
+
+ private:
+  //! Header of an allocation that did not fit within the backing buffer.
+  struct OverflowBlock {
+    OverflowBlock *next;
+    size_t size;
+  };
+
+  static void *AllocateOverflow(size_t size, size_t alignment);
+  static void FreeOverflow(void *until);
+
+  static uint8_t *buffer_;
+  static size_t capacity_;
+  static size_t offset_;
+  //! Most recent overflow allocation, linked to those before it.
+  static OverflowBlock *overflow_;
+  //! Bytes currently held by overflow allocations.
+  static size_t overflow_bytes_;
+  //! The largest amount of memory in use at once since the last Reset.
+  static size_t peak_usage_;
+  static uint32_t frame_heap_allocations_;
+  static uint32_t last_frame_heap_allocations_;
+  static uint64_t total_heap_allocations_;
+};
+
+//! Rewinds the FrameArena to its position at construction when destroyed, releasing temporary allocations.
+class ScopedFrameArenaMarker {
+ public:
+  ScopedFrameArenaMarker() : marker_(FrameArena::GetMarker()) {}
+  ~ScopedFrameArenaMarker() { FrameArena::Rewind(marker_); }
+
+  ScopedFrameArenaMarker(const ScopedFrameArenaMarker &) = delete;
+  ScopedFrameArenaMarker &operator=(const ScopedFrameArenaMarker &) = delete;
+
+ private:
+  FrameArena::Marker marker_;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_FRAME_ARENA_H_
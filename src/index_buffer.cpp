@@ -0,0 +1,143 @@
+#include "index_buffer.h"
+
+#ifdef XBOX
+#include <pbkit/pbkit.h>
+#else
+#include <pbkit/nv_regs.h>
+#endif
+#include <xboxkrnl/xboxkrnl.h>
+
+#include <cstring>
+
+#include "nxdk_ext.h"
+#include "pbkpp_assert.h"
+#include "pushbuffer.h"
+
+namespace PBKitPlusPlus {
+
+// Maximum number of parameters in a single method header.
+static constexpr uint32_t kMaxParamsPerMethod = 0x7FF;
+
+static inline uint32_t EncodeElementMethod(uint32_t command, uint32_t num_params) {
+  return (num_params << 18) + (SUBCH_3D << 13) + NV2A_SUPPRESS_COMMAND_INCREMENT(command);
+}
+
+IndexBuffer::IndexBuffer(uint32_t num_indices, IndexFormat format) : num_indices_(num_indices), format_(format) {
+  PBKPP_ASSERT(num_indices && "IndexBuffer must hold at least one index.");
+
+  num_run_indices_ = format == INDEX_FORMAT_16 ? (num_indices & ~1) : num_indices;
+  auto indices_per_run = GetIndicesPerRun();
+  uint32_t num_runs = (num_run_indices_ + indices_per_run - 1) / indices_per_run;
+  uint32_t run_dwords = format == INDEX_FORMAT_16 ? num_run_indices_ / 2 : num_run_indices_;
+  bool has_trailing_index = num_run_indices_ != num_indices;
+
+  uint32_t num_dwords = num_runs + run_dwords + (has_trailing_index ? 2 : 0) + 1;
+  dwords_ = static_cast<uint32_t *>(MmAllocateContiguousMemoryEx(num_dwords * sizeof(uint32_t), 0, MAXRAM, 0,
+                                                                 PAGE_WRITECOMBINE | PAGE_READWRITE));
+  PBKPP_ASSERT(dwords_ && "Failed to allocate index buffer.");
+
+  // Write the method headers and terminating return up front so that SetIndices only needs to fill in parameters.
+  uint32_t command = format == INDEX_FORMAT_16 ? NV097_ARRAY_ELEMENT16 : NV097_ARRAY_ELEMENT32;
+  uint32_t *head = dwords_;
+  for (uint32_t remaining = run_dwords; remaining;) {
+    uint32_t count = remaining < kMaxParamsPerMethod ? remaining : kMaxParamsPerMethod;
+    *head = EncodeElementMethod(command, count);
+    head += count + 1;
+    remaining -= count;
+  }
+
+  if (has_trailing_index) {
+    *head = EncodeElementMethod(NV097_ARRAY_ELEMENT32, 1);
+    trailing_index_ = head + 1;
+    *trailing_index_ = 0;
+    head += 2;
+  }
+  *head = Pushbuffer::kSubroutineReturn;
+}
+
+IndexBuffer::~IndexBuffer() {
+  if (dwords_) {
+    MmFreeContiguousMemory(dwords_);
+  }
+}
+
+uint32_t IndexBuffer::GetIndicesPerRun() const {
+  return format_ == INDEX_FORMAT_16 ? kMaxParamsPerMethod * 2 : kMaxParamsPerMethod;
+}
+
+uint32_t *IndexBuffer::GetRunParams(uint32_t run) const { return dwords_ + run * (kMaxParamsPerMethod + 1) + 1; }
+
+void IndexBuffer::SetIndices(uint32_t first, const uint16_t *indices, uint32_t count) {
+  PBKPP_ASSERT(format_ == INDEX_FORMAT_16 && "16-bit indices may only be set on an INDEX_FORMAT_16 buffer.");
+  PBKPP_ASSERT(first + count <= num_indices_ && "Index range exceeds the size of the buffer.");
+
+  // Indices within a run are packed exactly as they appear in a uint16_t array, so each run is a single copy.
+  auto indices_per_run = GetIndicesPerRun();
+  uint32_t index = first;
+  uint32_t end = first + count;
+  uint32_t run_end = end < num_run_indices_ ? end : num_run_indices_;
+  while (index < run_end) {
+    auto run = index / indices_per_run;
+    auto run_offset = index % indices_per_run;
+    auto batch = indices_per_run - run_offset;
+    if (batch > run_end - index) {
+      batch = run_end - index;
+    }
+
+    auto dst = reinterpret_cast<uint16_t *>(GetRunParams(run)) + run_offset;
+    memcpy(dst, indices, batch * sizeof(uint16_t));
+    indices += batch;
+    index += batch;
+  }
+
+  if (index < end) {
+    *trailing_index_ = *indices;
+  }
+
+  FlushWriteCombinedStores();
+}
+
+void IndexBuffer::SetIndices(uint32_t first, const uint32_t *indices, uint32_t count) {
+  PBKPP_ASSERT(first + count <= num_indices_ && "Index range exceeds the size of the buffer.");
+
+  if (format_ == INDEX_FORMAT_16) {
+    // Narrow in chunks that fit on the stack.
+    uint16_t narrowed[256];
+    while (count) {
+      uint32_t batch = count < 256 ? count : 256;
+      for (uint32_t i = 0; i < batch; ++i) {
+        PBKPP_ASSERT(indices[i] < 0xFFFF && "Index out of range for INDEX_FORMAT_16.");
+        narrowed[i] = static_cast<uint16_t>(indices[i]);
+      }
+      SetIndices(first, narrowed, batch);
+      first += batch;
+      indices += batch;
+      count -= batch;
+    }
+    return;
+  }
+
+  auto indices_per_run = GetIndicesPerRun();
+  uint32_t end = first + count;
+  while (first < end) {
+    auto run = first / indices_per_run;
+    auto run_offset = first % indices_per_run;
+    auto batch = indices_per_run - run_offset;
+    if (batch > end - first) {
+      batch = end - first;
+    }
+
+    memcpy(GetRunParams(run) + run_offset, indices, batch * sizeof(uint32_t));
+    indices += batch;
+    first += batch;
+  }
+
+  FlushWriteCombinedStores();
+}
+
+void IndexBuffer::Call() const {
+  // Element methods only trigger vertex processing, so the register shadow remains valid.
+  Pushbuffer::PushCall(dwords_, false, num_indices_);
+}
+
+}  // namespace PBKitPlusPlus
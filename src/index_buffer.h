@@ -0,0 +1,70 @@
+#ifndef PBKITPLUSPLUS_SRC_INDEX_BUFFER_H_
+#define PBKITPLUSPLUS_SRC_INDEX_BUFFER_H_
+
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+class NV2AState;
+
+//! Holds vertex indices in contiguous memory so that indexed draws cost a single dword in the live pushbuffer.
+//!
+//! The nv2a cannot fetch indices from memory directly; they must arrive as NV097_ARRAY_ELEMENT* method parameters. The
+//! indices are therefore stored pre-encoded as a pushbuffer subroutine (runs of non-incrementing ARRAY_ELEMENT16 or
+//! ARRAY_ELEMENT32 methods followed by a return), which NV2AState::DrawElements invokes with a call command. 16-bit
+//! indices are stored two per dword, exactly as they are laid out in a uint16_t array, so filling the buffer is a series
+//! of bulk copies.
+//!
+//! As with resident CommandLists, the nv2a does not support nested subroutines, so DrawElements must not be recorded
+//! into a CommandList that is itself made resident.
+class IndexBuffer {
+ public:
+  enum IndexFormat {
+    //! Indices must be < 0xFFFF.
+    INDEX_FORMAT_16,
+    INDEX_FORMAT_32,
+  };
+
+  explicit IndexBuffer(uint32_t num_indices, IndexFormat format = INDEX_FORMAT_16);
+  ~IndexBuffer();
+
+  IndexBuffer(const IndexBuffer &) = delete;
+  IndexBuffer &operator=(const IndexBuffer &) = delete;
+
+  //! Overwrites `count` indices starting at index `first`.
+  //!
+  //! The caller is responsible for ensuring that the GPU is not executing a draw that uses this buffer (e.g., via a
+  //! Fence).
+  void SetIndices(uint32_t first, const uint16_t *indices, uint32_t count);
+  void SetIndices(uint32_t first, const uint32_t *indices, uint32_t count);
+
+  [[nodiscard]] uint32_t GetNumIndices() const { return num_indices_; }
+  [[nodiscard]] IndexFormat GetFormat() const { return format_; }
+
+ private:
+  friend class NV2AState;
+
+  //! Pushes a subroutine call that submits every index in the buffer.
+  void Call() const;
+
+  //! Returns the number of indices held by each element method run.
+  [[nodiscard]] uint32_t GetIndicesPerRun() const;
+
+  //! Returns a pointer to the parameters of the given element method run.
+  [[nodiscard]] uint32_t *GetRunParams(uint32_t run) const;
+
+  uint32_t num_indices_;
+  IndexFormat format_;
+
+  //! The encoded element methods, terminated by a subroutine return.
+  uint32_t *dwords_ = nullptr;
+  //! Number of indices stored in element method runs. For 16-bit buffers with an odd number of indices, the final index
+  //! follows in its own ARRAY_ELEMENT32 method.
+  uint32_t num_run_indices_ = 0;
+  //! The parameter of the trailing ARRAY_ELEMENT32 method, if any.
+  uint32_t *trailing_index_ = nullptr;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_INDEX_BUFFER_H_
@@ -0,0 +1,287 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+#include "index_buffer.h"
+#include "pbkpp_assert.h"
+#include "vertex_buffer.h"
+
+namespace PBKitPlusPlus {
+
+// Tuning values for the Forsyth vertex scoring function. The scoring cache is larger than the hardware cache; Forsyth
+// found that the resulting orders are insensitive to the exact cache size and perform well on any FIFO of similar size.
+static constexpr uint32_t kScoringCacheSize = 32;
+static constexpr float kCacheDecayPower = 1.5f;
+static constexpr float kLastTriangleScore = 0.75f;
+static constexpr float kValenceBoostScale = 2.0f;
+static constexpr float kValenceBoostPower = 0.5f;
+
+// Returns the score of a vertex given its position in the simulated LRU cache (-1 if it is not cached) and the number
+// of triangles that still reference it.
+static float ScoreVertex(int32_t cache_position, uint32_t remaining_valence) {
+  if (!remaining_valence) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // The vertices of the most recent triangle are penalized slightly to avoid favoring thin strips.
+      score = kLastTriangleScore;
+    } else {
+      const float scale = 1.0f / (kScoringCacheSize - 3);
+      score = powf(1.0f - static_cast<float>(cache_position - 3) * scale, kCacheDecayPower);
+    }
+  }
+
+  // Favor vertices with few remaining triangles so that they are finished off and leave the working set.
+  score += kValenceBoostScale * powf(static_cast<float>(remaining_valence), -kValenceBoostPower);
+  return score;
+}
+
+std::shared_ptr<IndexBuffer> IndexedMesh::CreateIndexBuffer() const {
+  auto max_index = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+  auto format = max_index < 0xFFFF ? IndexBuffer::INDEX_FORMAT_16 : IndexBuffer::INDEX_FORMAT_32;
+  auto ret = std::make_shared<IndexBuffer>(indices.size(), format);
+  ret->SetIndices(0, indices.data(), indices.size());
+  return ret;
+}
+
+IndexedMesh MeshOptimizer::WeldVertices(const VertexBuffer &triangles, uint32_t attribute_mask) {
+  auto num_vertices = triangles.GetNumVertices();
+  auto format = triangles.GetFormat();
+
+  uint32_t key_size = 0;
+  for (uint32_t i = 0; i < VertexFormat::kNumAttributes; ++i) {
+    if (format.HasAttribute(i) && (attribute_mask & (1 << i))) {
+      key_size += format.GetAttribute(i).size;
+    }
+  }
+  PBKPP_ASSERT(key_size && "attribute_mask does not select any attributes of the VertexBuffer.");
+
+  // Gather the selected attributes of each vertex from the staging copy into a contiguous key for hashing.
+  std::vector<uint8_t> keys(static_cast<size_t>(key_size) * num_vertices);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    auto key = keys.data() + static_cast<size_t>(v) * key_size;
+    for (uint32_t i = 0; i < VertexFormat::kNumAttributes; ++i) {
+      if (format.HasAttribute(i) && (attribute_mask & (1 << i))) {
+        triangles.ReadAttribute(v, i, key);
+        key += format.GetAttribute(i).size;
+      }
+    }
+  }
+
+  IndexedMesh ret;
+  ret.indices.resize(num_vertices);
+
+  std::vector<uint32_t> unique_vertices;
+  std::unordered_map<std::string_view, uint32_t> vertex_ids;
+  vertex_ids.reserve(num_vertices);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    std::string_view key(reinterpret_cast<const char *>(keys.data()) + static_cast<size_t>(v) * key_size, key_size);
+    auto inserted = vertex_ids.emplace(key, static_cast<uint32_t>(unique_vertices.size()));
+    if (inserted.second) {
+      unique_vertices.push_back(v);
+    }
+    ret.indices[v] = inserted.first->second;
+  }
+
+  ret.vertices = triangles.Gather(unique_vertices.data(), unique_vertices.size());
+  return ret;
+}
+
+float MeshOptimizer::CalculateACMR(const uint32_t *indices, uint32_t num_indices, uint32_t cache_size) {
+  PBKPP_ASSERT(cache_size && "cache_size must be at least 1.");
+  if (num_indices < 3) {
+    return 0.0f;
+  }
+
+  // A vertex is in the FIFO if fewer than cache_size misses have occurred since it was inserted.
+  std::unordered_map<uint32_t, uint32_t> insertion_time;
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < num_indices; ++i) {
+    auto it = insertion_time.find(indices[i]);
+    if (it != insertion_time.end() && misses - it->second < cache_size) {
+      continue;
+    }
+    insertion_time[indices[i]] = misses++;
+  }
+
+  return static_cast<float>(misses) / static_cast<float>(num_indices / 3);
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t *indices, uint32_t num_indices, uint32_t num_vertices) {
+  PBKPP_ASSERT(!(num_indices % 3) && "num_indices must be a multiple of 3.");
+  uint32_t num_triangles = num_indices / 3;
+  if (num_triangles < 2) {
+    return;
+  }
+
+  // Build the vertex -> triangle adjacency. The first remaining_valence entries of each vertex's list are the triangles
+  // that have not yet been emitted.
+  std::vector<uint32_t> remaining_valence(num_vertices, 0);
+  for (uint32_t i = 0; i < num_indices; ++i) {
+    PBKPP_ASSERT(indices[i] < num_vertices && "Index exceeds num_vertices.");
+    ++remaining_valence[indices[i]];
+  }
+
+  std::vector<uint32_t> adjacency_offset(num_vertices + 1, 0);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    adjacency_offset[v + 1] = adjacency_offset[v] + remaining_valence[v];
+  }
+
+  std::vector<uint32_t> adjacency(num_indices);
+  {
+    std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+    for (uint32_t i = 0; i < num_indices; ++i) {
+      adjacency[fill[indices[i]]++] = i / 3;
+    }
+  }
+
+  std::vector<int32_t> cache_position(num_vertices, -1);
+  std::vector<float> vertex_score(num_vertices);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    vertex_score[v] = ScoreVertex(-1, remaining_valence[v]);
+  }
+
+  std::vector<float> triangle_score(num_triangles);
+  std::vector<bool> emitted(num_triangles, false);
+  int32_t best_triangle = 0;
+  for (uint32_t t = 0; t < num_triangles; ++t) {
+    auto tri = indices + t * 3;
+    triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    if (triangle_score[t] > triangle_score[best_triangle]) {
+      best_triangle = static_cast<int32_t>(t);
+    }
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(num_indices);
+
+  // Holds the simulated LRU cache, plus room for the 3 entries that may be pushed out by each new triangle.
+  uint32_t cache[kScoringCacheSize + 3];
+  uint32_t cache_entries = 0;
+  uint32_t next_unemitted = 0;
+
+  for (uint32_t i = 0; i < num_triangles; ++i) {
+    if (best_triangle < 0) {
+      // None of the cached vertices have remaining triangles, so start on a new region of the mesh.
+      while (emitted[next_unemitted]) {
+        ++next_unemitted;
+      }
+      best_triangle = static_cast<int32_t>(next_unemitted);
+    }
+
+    auto triangle = static_cast<uint32_t>(best_triangle);
+    auto tri = indices + triangle * 3;
+    emitted[triangle] = true;
+
+    uint32_t new_cache[kScoringCacheSize + 3];
+    uint32_t new_cache_entries = 0;
+    for (uint32_t k = 0; k < 3; ++k) {
+      auto v = tri[k];
+      output.push_back(v);
+      new_cache[new_cache_entries++] = v;
+
+      // Remove the triangle from the vertex's remaining list.
+      auto begin = adjacency.begin() + adjacency_offset[v];
+      auto end = begin + remaining_valence[v];
+      auto it = std::find(begin, end, triangle);
+      PBKPP_ASSERT(it != end);
+      std::iter_swap(it, end - 1);
+      --remaining_valence[v];
+    }
+
+    for (uint32_t k = 0; k < cache_entries; ++k) {
+      auto v = cache[k];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) {
+        new_cache[new_cache_entries++] = v;
+      }
+    }
+
+    // Rescore everything that was or is in the cache; entries beyond kScoringCacheSize have just been evicted.
+    for (uint32_t k = 0; k < new_cache_entries; ++k) {
+      auto v = new_cache[k];
+      cache_position[v] = k < kScoringCacheSize ? static_cast<int32_t>(k) : -1;
+      vertex_score[v] = ScoreVertex(cache_position[v], remaining_valence[v]);
+    }
+
+    best_triangle = -1;
+    float best_score = -1.0f;
+    for (uint32_t k = 0; k < new_cache_entries; ++k) {
+      auto v = new_cache[k];
+      auto begin = adjacency.begin() + adjacency_offset[v];
+      auto end = begin + remaining_valence[v];
+      for (auto it = begin; it != end; ++it) {
+        auto t = *it;
+        auto t_indices = indices + t * 3;
+        triangle_score[t] = vertex_score[t_indices[0]] + vertex_score[t_indices[1]] + vertex_score[t_indices[2]];
+        if (triangle_score[t] > best_score) {
+          best_score = triangle_score[t];
+          best_triangle = static_cast<int32_t>(t);
+        }
+      }
+    }
+
+    cache_entries = std::min(new_cache_entries, kScoringCacheSize);
+    memcpy(cache, new_cache, cache_entries * sizeof(cache[0]));
+  }
+
+  memcpy(indices, output.data(), num_indices * sizeof(uint32_t));
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(uint32_t *indices, uint32_t num_indices,
+                                                         uint32_t num_vertices) {
+  static constexpr uint32_t kUnassigned = 0xFFFFFFFF;
+
+  std::vector<uint32_t> old_to_new(num_vertices, kUnassigned);
+  std::vector<uint32_t> new_to_old;
+  for (uint32_t i = 0; i < num_indices; ++i) {
+    auto old_index = indices[i];
+    PBKPP_ASSERT(old_index < num_vertices && "Index exceeds num_vertices.");
+    if (old_to_new[old_index] == kUnassigned) {
+      old_to_new[old_index] = static_cast<uint32_t>(new_to_old.size());
+      new_to_old.push_back(old_index);
+    }
+    indices[i] = old_to_new[old_index];
+  }
+
+  return new_to_old;
+}
+
+IndexedMesh MeshOptimizer::Optimize(const VertexBuffer &triangles, Stats *stats, uint32_t attribute_mask) {
+  auto welded = WeldVertices(triangles, attribute_mask);
+  auto ret = Optimize(welded, stats);
+  if (stats) {
+    stats->input_vertices = triangles.GetNumVertices();
+  }
+  return ret;
+}
+
+IndexedMesh MeshOptimizer::Optimize(const IndexedMesh &mesh, Stats *stats) {
+  PBKPP_ASSERT(mesh.vertices && "IndexedMesh has no vertices.");
+  auto num_vertices = mesh.vertices->GetNumVertices();
+  auto num_indices = static_cast<uint32_t>(mesh.indices.size());
+
+  IndexedMesh ret;
+  ret.indices = mesh.indices;
+  OptimizeVertexCache(ret.indices.data(), num_indices, num_vertices);
+  auto remap = OptimizeVertexFetch(ret.indices.data(), num_indices, num_vertices);
+  ret.vertices = mesh.vertices->Gather(remap.data(), remap.size());
+
+  if (stats) {
+    stats->input_vertices = num_vertices;
+    stats->unique_vertices = remap.size();
+    stats->triangles = num_indices / 3;
+    stats->acmr_before = CalculateACMR(mesh.indices.data(), num_indices);
+    stats->acmr_after = CalculateACMR(ret.indices.data(), num_indices);
+  }
+
+  return ret;
+}
+
+}  // namespace PBKitPlusPlus
@@ -14,13 +14,18 @@
 #include <xboxkrnl/xboxkrnl.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <utility>
 
+#include "fence.h"
+#include "frame_arena.h"
 #include "nxdk_ext.h"
 #include "pushbuffer.h"
+#include "pushbuffer_backend.h"
 #include "shaders/vertex_shader_program.h"
 #include "texture_generator.h"
 #include "vertex_buffer.h"
+#include "vertex_memory_pool.h"
 #include "xbox_math_d3d.h"
 #include "xbox_math_matrix.h"
 #include "xbox_math_types.h"
@@ -42,13 +47,15 @@ static constexpr uint32_t kDefaultDMAChannelA = 3;
 const uint32_t kDefaultDMAColorChannel = 9;
 
 NV2AState::NV2AState(uint32_t framebuffer_width, uint32_t framebuffer_height, uint32_t max_texture_width,
-                     uint32_t max_texture_height, uint32_t max_texture_depth)
+                     uint32_t max_texture_height, uint32_t max_texture_depth, uint32_t vertex_memory_pool_size)
     : framebuffer_width_(framebuffer_width),
       framebuffer_height_(framebuffer_height),
       max_texture_width_(max_texture_width),
       max_texture_height_(max_texture_height),
       max_texture_depth_(max_texture_depth) {
   Pushbuffer::Initialize();
+  FenceManager::Initialize();
+  VertexMemoryPool::Initialize(vertex_memory_pool_size);
 
   // allocate texture memory buffer large enough for all types
   uint32_t stride = max_texture_width_ * 4;
@@ -96,6 +103,7 @@ NV2AState::~NV2AState() {
 
 void NV2AState::ClearDepthStencilRegion(uint32_t depth_value, uint8_t stencil_value, uint32_t left, uint32_t top,
                                         uint32_t width, uint32_t height) const {
+  PBKPP_TAG_CALL_SITE("NV2AState::ClearDepthStencilRegion");
   if (!width || width > framebuffer_width_) {
     width = framebuffer_width_;
   }
@@ -104,9 +112,11 @@ void NV2AState::ClearDepthStencilRegion(uint32_t depth_value, uint8_t stencil_va
   }
 
   pb_set_depth_stencil_buffer_region(depth_buffer_format_, depth_value, stencil_value, left, top, width, height);
+  Pushbuffer::InvalidateShadowRegisters();
 }
 
 void NV2AState::ClearColorRegion(uint32_t argb, uint32_t left, uint32_t top, uint32_t width, uint32_t height) const {
+  PBKPP_TAG_CALL_SITE("NV2AState::ClearColorRegion");
   if (!width || width > framebuffer_width_) {
     width = framebuffer_width_;
   }
@@ -114,6 +124,7 @@ void NV2AState::ClearColorRegion(uint32_t argb, uint32_t left, uint32_t top, uin
     height = framebuffer_height_;
   }
   pb_fill(static_cast<int>(left), static_cast<int>(top), static_cast<int>(width), static_cast<int>(height), argb);
+  Pushbuffer::InvalidateShadowRegisters();
 }
 
 void NV2AState::EraseText() { pb_erase_text_screen(); }
@@ -151,6 +162,7 @@ void NV2AState::SetSurfaceFormatImmediate(SurfaceColorFormat color_format, Surfa
 }
 
 void NV2AState::CommitSurfaceFormat() const {
+  PBKPP_TAG_CALL_SITE("NV2AState::CommitSurfaceFormat");
   uint32_t value = SET_MASK(NV097_SET_SURFACE_FORMAT_COLOR, surface_color_format_) |
                    SET_MASK(NV097_SET_SURFACE_FORMAT_ZETA, depth_buffer_format_) |
                    SET_MASK(NV097_SET_SURFACE_FORMAT_ANTI_ALIASING, antialiasing_setting_) |
@@ -178,6 +190,7 @@ void NV2AState::CommitSurfaceFormat() const {
 }
 
 void NV2AState::SetDepthClip(float min, float max) const {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetDepthClip");
   Pushbuffer::Begin();
   Pushbuffer::PushF(NV097_SET_CLIP_MIN, min);
   Pushbuffer::PushF(NV097_SET_CLIP_MAX, max);
@@ -206,6 +219,9 @@ float NV2AState::MaxDepthBufferValue(uint32_t depth_buffer_format, bool float_mo
 }
 
 void NV2AState::PrepareDraw(uint32_t argb, uint32_t depth_value, uint8_t stencil_value) {
+  PBKPP_TAG_CALL_SITE("NV2AState::PrepareDraw");
+  FrameArena::Reset();
+
   pb_wait_for_vbl();
   Pushbuffer::Flush();
 
@@ -220,13 +236,13 @@ void NV2AState::PrepareDraw(uint32_t argb, uint32_t depth_value, uint8_t stencil
     vertex_shader_program_->PrepareDraw();
   }
 
-  while (pb_busy()) {
-    /* Wait for completion... */
-  }
+  Pushbuffer::WaitForIdle();
 }
 
 void NV2AState::SetVertexBufferAttributes(uint32_t enabled_fields) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetVertexBufferAttributes");
   PBKPP_ASSERT(vertex_buffer_ && "Vertex buffer must be set before calling SetVertexBufferAttributes.");
+  vertex_buffer_->Commit();
   if (!vertex_buffer_->IsCacheValid()) {
     Pushbuffer::Begin();
     Pushbuffer::Push(NV097_BREAK_VERTEX_BUFFER_CACHE, 0);
@@ -237,75 +253,70 @@ void NV2AState::SetVertexBufferAttributes(uint32_t enabled_fields) {
   // TODO: FIXME: Linearize on a per-stage basis instead of basing entirely on stage 0.
   // E.g., if texture unit 0 uses linear and 1 uses swizzle, TEX0 should be linearized, TEX1 should be normalized.
   bool is_linear = texture_stage_[0].enabled_ && texture_stage_[0].IsLinear();
-  Vertex *vptr = is_linear ? vertex_buffer_->linear_vertex_buffer_ : vertex_buffer_->normalized_vertex_buffer_;
-
-  auto set = [this, enabled_fields](VertexAttribute attribute, uint32_t attribute_index, uint32_t format, uint32_t size,
-                                    const void *data) {
-    if (enabled_fields & attribute) {
-      uint32_t stride = sizeof(Vertex);
-      if (vertex_attribute_stride_override_[attribute_index] != kNoStrideOverride) {
-        stride = vertex_attribute_stride_override_[attribute_index];
-      }
-      SetVertexAttribute(attribute_index, format, size, stride, data);
-    } else {
-      ClearVertexAttribute(attribute_index);
+  SetVertexAttributes(vertex_buffer_->GetFormat(), vertex_buffer_->GetVertexData(is_linear), enabled_fields);
+}
+
+void NV2AState::SetVertexAttributes(const VertexFormat &format, const uint8_t *vertex_data, uint32_t enabled_fields) {
+  // Attributes that are not present in the format are cleared even if they are requested.
+  for (uint32_t i = 0; i < VertexFormat::kNumAttributes; ++i) {
+    auto &attribute = format.GetAttribute(i);
+    if (!(enabled_fields & (1 << i)) || !attribute.count) {
+      ClearVertexAttribute(i);
+      continue;
     }
-  };
 
-  set(POSITION, NV2A_VERTEX_ATTR_POSITION, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, vertex_buffer_->position_count_,
-      &vptr[0].pos);
-  set(WEIGHT, NV2A_VERTEX_ATTR_WEIGHT, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, vertex_buffer_->weight_count_,
-      &vptr[0].weight);
-  set(NORMAL, NV2A_VERTEX_ATTR_NORMAL, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, vertex_buffer_->normal_count_,
-      &vptr[0].normal);
-  set(DIFFUSE, NV2A_VERTEX_ATTR_DIFFUSE, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, vertex_buffer_->diffuse_count_,
-      &vptr[0].diffuse);
-  set(SPECULAR, NV2A_VERTEX_ATTR_SPECULAR, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, vertex_buffer_->specular_count_,
-      &vptr[0].specular);
-  set(FOG_COORD, NV2A_VERTEX_ATTR_FOG_COORD, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->fog_coord_count_, &vptr[0].fog_coord);
-  set(POINT_SIZE, NV2A_VERTEX_ATTR_POINT_SIZE, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->point_size_count_, &vptr[0].point_size);
-
-  set(BACK_DIFFUSE, NV2A_VERTEX_ATTR_BACK_DIFFUSE, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->back_diffuse_count_, &vptr[0].back_diffuse);
-  set(BACK_SPECULAR, NV2A_VERTEX_ATTR_BACK_SPECULAR, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->back_specular_count_, &vptr[0].back_specular);
-
-  set(TEXCOORD0, NV2A_VERTEX_ATTR_TEXTURE0, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->tex0_coord_count_, &vptr[0].texcoord0);
-  set(TEXCOORD1, NV2A_VERTEX_ATTR_TEXTURE1, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->tex1_coord_count_, &vptr[0].texcoord1);
-  set(TEXCOORD2, NV2A_VERTEX_ATTR_TEXTURE2, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->tex2_coord_count_, &vptr[0].texcoord2);
-  set(TEXCOORD3, NV2A_VERTEX_ATTR_TEXTURE3, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F,
-      vertex_buffer_->tex3_coord_count_, &vptr[0].texcoord3);
-
-  //  set(V13, NV2A_VERTEX_ATTR_13, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, 4, &vptr[0].v13);
-  ClearVertexAttribute(NV2A_VERTEX_ATTR_13);
-
-  //  set(V14, NV2A_VERTEX_ATTR_14, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, 4, &vptr[0].v14);
-  ClearVertexAttribute(NV2A_VERTEX_ATTR_14);
-
-  //  set(V15, NV2A_VERTEX_ATTR_15, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, 4, &vptr[0].v15);
-  ClearVertexAttribute(NV2A_VERTEX_ATTR_15);
+    uint32_t stride = attribute.stride;
+    if (vertex_attribute_stride_override_[i] != kNoStrideOverride) {
+      stride = vertex_attribute_stride_override_[i];
+    }
+    SetVertexAttribute(i, attribute.type, attribute.count, stride, vertex_data + attribute.offset);
+  }
 }
 
 void NV2AState::DrawArrays(uint32_t enabled_vertex_fields, DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawArrays");
   if (vertex_shader_program_) {
     vertex_shader_program_->PrepareDraw();
   }
 
   PBKPP_ASSERT(vertex_buffer_ && "Vertex buffer must be set before calling DrawArrays.");
-  auto num_vertices = vertex_buffer_->num_vertices_;
+  SetVertexBufferAttributes(enabled_vertex_fields);
+  PushDrawArrays(vertex_buffer_->num_vertices_, primitive);
+}
+
+void NV2AState::DrawArrays(const DynamicVertexRing::Allocation &vertices, uint32_t enabled_vertex_fields,
+                           DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawArrays");
+  if (vertex_shader_program_) {
+    vertex_shader_program_->PrepareDraw();
+  }
+
+  auto ring = vertices.ring;
+  PBKPP_ASSERT(ring && "Invalid DynamicVertexRing allocation.");
+  // The allocation is reclaimed once the fence below is passed, which a recorded draw could not guarantee on replay.
+  PBKPP_ASSERT(!Pushbuffer::IsCapturing() && "DynamicVertexRing allocations must not be drawn into a CommandList.");
+
+  FlushWriteCombinedStores();
+
+  if (ring->cache_break_pending_) {
+    Pushbuffer::Begin();
+    Pushbuffer::Push(NV097_BREAK_VERTEX_BUFFER_CACHE, 0);
+    Pushbuffer::End();
+    ring->cache_break_pending_ = false;
+  }
+
+  SetVertexAttributes(ring->GetFormat(), vertices.data, enabled_vertex_fields);
+  PushDrawArrays(vertices.num_vertices, primitive);
+  ring->Retire(vertices, FenceManager::Insert());
+}
+
+void NV2AState::PushDrawArrays(uint32_t num_vertices, DrawPrimitive primitive) {
   PBKPP_ASSERT(num_vertices <= 0x100FE &&
                "NV097_DRAW_ARRAYS only allows start indices below 0xFFFF and 0xFF vertices per push");
 
   // Max 0xFF due to NV097_DRAW_ARRAYS_COUNT bitmask.
   static constexpr uint32_t kVerticesPerPush = 0xFF;
 
-  SetVertexBufferAttributes(enabled_vertex_fields);
-
   Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
 
@@ -325,18 +336,18 @@ void NV2AState::DrawArrays(uint32_t enabled_vertex_fields, DrawPrimitive primiti
 }
 
 void NV2AState::Begin(DrawPrimitive primitive) const {
+  // The block is intentionally left open until End() so that immediate mode attribute calls share it.
   Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
-  Pushbuffer::End();
 }
 
 void NV2AState::End() const {
-  Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
   Pushbuffer::End();
 }
 
 void NV2AState::DrawInlineBuffer(uint32_t enabled_vertex_fields, DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawInlineBuffer");
   if (vertex_shader_program_) {
     vertex_shader_program_->PrepareDraw();
   }
@@ -345,15 +356,15 @@ void NV2AState::DrawInlineBuffer(uint32_t enabled_vertex_fields, DrawPrimitive p
 
   PBKitFlushPushbufer();
 
+  if (vertex_buffer_->IsCompact()) {
+    DrawInlineBufferCompact(enabled_vertex_fields, primitive);
+    return;
+  }
+
   Begin(primitive);
 
-  auto vertex = vertex_buffer_->Lock();
+  auto vertex = vertex_buffer_->LockReadOnly();
   for (auto i = 0; i < vertex_buffer_->GetNumVertices(); ++i, ++vertex) {
-    // Flush the pushbuffer occasionally.
-    if ((i & 0x0FFF) == 0) {
-      PBKitFlushPushbufer();
-    }
-
     if (enabled_vertex_fields & WEIGHT) {
       if (vertex_buffer_->weight_count_ == 4) {
         SetWeight(vertex->weight[0], vertex->weight[1], vertex->weight[2], vertex->weight[3]);
@@ -436,12 +447,39 @@ void NV2AState::DrawInlineBuffer(uint32_t enabled_vertex_fields, DrawPrimitive p
     }
   }
   vertex_buffer_->Unlock();
-  vertex_buffer_->SetCacheValid();
+
+  End();
+}
+
+void NV2AState::DrawInlineBufferCompact(uint32_t enabled_vertex_fields, DrawPrimitive primitive) {
+  Begin(primitive);
+
+  auto &format = vertex_buffer_->format_;
+  auto vertex_data = vertex_buffer_->GetStagingData();
+
+  // Packed attributes are expanded on the CPU. Missing components take the same defaults the hardware uses for short
+  // array attributes.
+  auto set_attribute = [&format, vertex_data](uint32_t index, uint32_t vertex_index) {
+    auto &attribute = format.GetAttribute(index);
+    float values[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    VertexFormat::UnpackAttribute(attribute, vertex_data + attribute.offset + vertex_index * attribute.stride, values);
+    Pushbuffer::PushF(NV097_SET_VERTEX_DATA4F_M + index * 16, values[0], values[1], values[2], values[3]);
+  };
+
+  for (uint32_t i = 0; i < vertex_buffer_->GetNumVertices(); ++i) {
+    // Setting the position locks in the previously set values and must be done last, so iteration is reversed.
+    for (int32_t index = VertexFormat::kNumAttributes - 1; index >= 0; --index) {
+      if ((enabled_vertex_fields & (1 << index)) && format.HasAttribute(index)) {
+        set_attribute(index, i);
+      }
+    }
+  }
 
   End();
 }
 
 void NV2AState::DrawInlineArray(uint32_t enabled_vertex_fields, DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawInlineArray");
   if (vertex_shader_program_) {
     vertex_shader_program_->PrepareDraw();
   }
@@ -453,73 +491,48 @@ void NV2AState::DrawInlineArray(uint32_t enabled_vertex_fields, DrawPrimitive pr
   Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
 
-  // Helper macro to push 1-4 float components based on count.
-#define PUSH_ATTR(count, field)                                                         \
-  if ((count) == 4) {                                                                   \
-    Pushbuffer::Push4F(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), (field));   \
-  } else if ((count) == 3) {                                                            \
-    Pushbuffer::Push3F(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), (field));   \
-  } else if ((count) == 2) {                                                            \
-    Pushbuffer::Push2F(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), (field));   \
-  } else if ((count) == 1) {                                                            \
-    Pushbuffer::PushF(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), (field)[0]); \
-  } else {                                                                              \
-    PBKPP_ASSERT(!"Invalid attribute count");                                           \
-  }
-
-  auto vertex = vertex_buffer_->Lock();
-  for (auto i = 0; i < vertex_buffer_->GetNumVertices(); ++i, ++vertex) {
-    // Note: Ordering is important and must follow the NV2A_VERTEX_ATTR_POSITION, ... ordering.
-    if (enabled_vertex_fields & POSITION) {
-      PUSH_ATTR(vertex_buffer_->position_count_, vertex->pos)
-    }
-    if (enabled_vertex_fields & WEIGHT) {
-      PUSH_ATTR(vertex_buffer_->weight_count_, vertex->weight)
-    }
-    if (enabled_vertex_fields & NORMAL) {
-      PUSH_ATTR(vertex_buffer_->normal_count_, vertex->normal)
-    }
-    if (enabled_vertex_fields & DIFFUSE) {
-      PUSH_ATTR(vertex_buffer_->diffuse_count_, vertex->diffuse)
-    }
-    if (enabled_vertex_fields & SPECULAR) {
-      PUSH_ATTR(vertex_buffer_->specular_count_, vertex->specular)
-    }
-    if (enabled_vertex_fields & FOG_COORD) {
-      PUSH_ATTR(vertex_buffer_->fog_coord_count_, vertex->fog_coord)
-    }
-    if (enabled_vertex_fields & POINT_SIZE) {
-      PUSH_ATTR(vertex_buffer_->point_size_count_, vertex->point_size)
-    }
-    if (enabled_vertex_fields & BACK_DIFFUSE) {
-      PUSH_ATTR(vertex_buffer_->back_diffuse_count_, vertex->back_diffuse)
-    }
-    if (enabled_vertex_fields & BACK_SPECULAR) {
-      PUSH_ATTR(vertex_buffer_->back_specular_count_, vertex->back_specular)
-    }
-    if (enabled_vertex_fields & TEXCOORD0) {
-      PUSH_ATTR(vertex_buffer_->tex0_coord_count_, vertex->texcoord0)
-    }
-    if (enabled_vertex_fields & TEXCOORD1) {
-      PUSH_ATTR(vertex_buffer_->tex1_coord_count_, vertex->texcoord1)
-    }
-    if (enabled_vertex_fields & TEXCOORD2) {
-      PUSH_ATTR(vertex_buffer_->tex2_coord_count_, vertex->texcoord2)
+  // Note: Ordering is important and must follow the NV2A_VERTEX_ATTR_POSITION, ... ordering.
+  struct InlineAttribute {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t stride;
+  };
+  InlineAttribute attributes[VertexFormat::kNumAttributes];
+  uint32_t num_attributes = 0;
+  uint32_t vertex_bytes = 0;
+
+  auto format = vertex_buffer_->GetFormat();
+  auto vertex_data = vertex_buffer_->GetStagingData();
+  for (uint32_t i = 0; i < VertexFormat::kNumAttributes; ++i) {
+    auto &attribute = format.GetAttribute(i);
+    if (!(enabled_vertex_fields & (1 << i)) || !attribute.count) {
+      continue;
     }
-    if (enabled_vertex_fields & TEXCOORD3) {
-      PUSH_ATTR(vertex_buffer_->tex3_coord_count_, vertex->texcoord3)
+    attributes[num_attributes++] = {vertex_data + attribute.offset, attribute.size, attribute.stride};
+    vertex_bytes += attribute.size;
+  }
+  uint32_t vertex_dwords = vertex_bytes / 4;
+
+  // Each vertex is written as a single run of inline array data.
+  for (uint32_t i = 0; i < vertex_buffer_->GetNumVertices(); ++i) {
+    Pushbuffer::Reservation reservation(Pushbuffer::MethodSize(vertex_dwords));
+    auto params = reservation.Emit(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), vertex_dwords);
+    for (auto attribute = attributes; attribute != attributes + num_attributes; ++attribute) {
+      memcpy(params, attribute->data + i * attribute->stride, attribute->size);
+      params += attribute->size / 4;
     }
   }
-#undef PUSH_ATTR
-  vertex_buffer_->Unlock();
-  vertex_buffer_->SetCacheValid();
 
   Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
   Pushbuffer::End();
 }
 
+// Number of single dword element methods written per pushbuffer reservation.
+static constexpr uint32_t kElementsPerReservation = 32;
+
 void NV2AState::DrawInlineElements16(const std::vector<uint32_t> &indices, uint32_t enabled_vertex_fields,
                                      DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawInlineElements16");
   if (vertex_shader_program_) {
     vertex_shader_program_->PrepareDraw();
   }
@@ -532,18 +545,21 @@ void NV2AState::DrawInlineElements16(const std::vector<uint32_t> &indices, uint3
   Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
 
   PBKPP_ASSERT(indices.size() < 0x7FFFFFFF);
-  int indices_remaining = static_cast<int>(indices.size());
+  uint32_t pairs_remaining = indices.size() / 2;
   const uint32_t *next_index = indices.data();
-  while (indices_remaining >= 2) {
-    uint32_t index_pair = *next_index++ & 0xFFFF;
-    index_pair += *next_index++ << 16;
-
-    Pushbuffer::Push(NV097_ARRAY_ELEMENT16, index_pair);
-
-    indices_remaining -= 2;
+  while (pairs_remaining) {
+    uint32_t batch_size = std::min(pairs_remaining, kElementsPerReservation);
+    pairs_remaining -= batch_size;
+
+    Pushbuffer::Reservation reservation(batch_size * Pushbuffer::MethodSize(1));
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      uint32_t index_pair = *next_index++ & 0xFFFF;
+      index_pair += *next_index++ << 16;
+      reservation.Push(NV097_ARRAY_ELEMENT16, index_pair);
+    }
   }
 
-  if (indices_remaining) {
+  if (indices.size() & 1) {
     Pushbuffer::Push(NV097_ARRAY_ELEMENT32, *next_index);
   }
 
@@ -553,6 +569,7 @@ void NV2AState::DrawInlineElements16(const std::vector<uint32_t> &indices, uint3
 
 void NV2AState::DrawInlineElements32(const std::vector<uint32_t> &indices, uint32_t enabled_vertex_fields,
                                      DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawInlineElements32");
   if (vertex_shader_program_) {
     vertex_shader_program_->PrepareDraw();
   }
@@ -563,14 +580,97 @@ void NV2AState::DrawInlineElements32(const std::vector<uint32_t> &indices, uint3
   Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
 
-  for (auto index : indices) {
-    Pushbuffer::Push(NV097_ARRAY_ELEMENT32, index);
+  uint32_t indices_remaining = indices.size();
+  const uint32_t *next_index = indices.data();
+  while (indices_remaining) {
+    uint32_t batch_size = std::min(indices_remaining, kElementsPerReservation);
+    indices_remaining -= batch_size;
+
+    Pushbuffer::Reservation reservation(batch_size * Pushbuffer::MethodSize(1));
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      reservation.Push(NV097_ARRAY_ELEMENT32, *next_index++);
+    }
+  }
+
+  Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
+  Pushbuffer::End();
+}
+
+void NV2AState::DrawElements(const IndexBuffer &indices, uint32_t enabled_vertex_fields, DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawElements");
+  if (vertex_shader_program_) {
+    vertex_shader_program_->PrepareDraw();
+  }
+
+  PBKPP_ASSERT(vertex_buffer_ && "Vertex buffer must be set before calling DrawElements.");
+
+  SetVertexBufferAttributes(enabled_vertex_fields);
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
+  indices.Call();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
+  Pushbuffer::End();
+}
+
+// Maximum number of index dwords written per element method when streaming indices through the pushbuffer.
+static constexpr uint32_t kStreamedElementsPerMethod = 64;
+
+// Writes runs of the given non-incrementing element method, each holding up to kStreamedElementsPerMethod dwords.
+static void StreamElements(uint32_t command, const void *dwords, uint32_t num_dwords) {
+  auto src = static_cast<const uint8_t *>(dwords);
+  while (num_dwords) {
+    uint32_t batch = std::min(num_dwords, kStreamedElementsPerMethod);
+    num_dwords -= batch;
+
+    Pushbuffer::Reservation reservation(Pushbuffer::MethodSize(batch));
+    auto params = reservation.Emit(NV2A_SUPPRESS_COMMAND_INCREMENT(command), batch);
+    memcpy(params, src, batch * sizeof(uint32_t));
+    src += batch * sizeof(uint32_t);
+  }
+}
+
+void NV2AState::DrawElements(const uint16_t *indices, uint32_t num_indices, uint32_t enabled_vertex_fields,
+                             DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawElements");
+  if (vertex_shader_program_) {
+    vertex_shader_program_->PrepareDraw();
+  }
+
+  PBKPP_ASSERT(vertex_buffer_ && "Vertex buffer must be set before calling DrawElements.");
+
+  SetVertexBufferAttributes(enabled_vertex_fields);
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
+
+  StreamElements(NV097_ARRAY_ELEMENT16, indices, num_indices / 2);
+  if (num_indices & 1) {
+    Pushbuffer::Push(NV097_ARRAY_ELEMENT32, indices[num_indices - 1]);
   }
 
   Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
   Pushbuffer::End();
 }
 
+void NV2AState::DrawElements(const uint32_t *indices, uint32_t num_indices, uint32_t enabled_vertex_fields,
+                             DrawPrimitive primitive) {
+  PBKPP_TAG_CALL_SITE("NV2AState::DrawElements");
+  if (vertex_shader_program_) {
+    vertex_shader_program_->PrepareDraw();
+  }
+
+  PBKPP_ASSERT(vertex_buffer_ && "Vertex buffer must be set before calling DrawElements.");
+
+  SetVertexBufferAttributes(enabled_vertex_fields);
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
+  StreamElements(NV097_ARRAY_ELEMENT32, indices, num_indices);
+  Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
+  Pushbuffer::End();
+}
+
 void NV2AState::SetVertex(float x, float y, float z) const {
   Pushbuffer::Begin();
   Pushbuffer::PushF(NV097_SET_VERTEX3F, x, y, z);
@@ -705,17 +805,17 @@ void NV2AState::SetTexCoord0S(int u, int v) const {
 }
 
 void NV2AState::SetTexCoord0(float s, float t, float p, float q) const {
-  auto pb = pb_begin();
-  pb = pb_push4f(pb, NV097_SET_TEXCOORD0_4F, s, t, p, q);
-  pb_end(pb);
+  Pushbuffer::Begin();
+  Pushbuffer::PushF(NV097_SET_TEXCOORD0_4F, s, t, p, q);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord0S(int s, int t, int p, int q) const {
-  auto pb = pb_begin();
+  Pushbuffer::Begin();
   uint32_t st = (s & 0xFFFF) | (t << 16);
   uint32_t pq = (p & 0xFFFF) | (q << 16);
-  pb = pb_push2(pb, NV097_SET_TEXCOORD0_4S, st, pq);
-  pb_end(pb);
+  Pushbuffer::Push(NV097_SET_TEXCOORD0_4S, st, pq);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord1(float u, float v) const {
@@ -732,17 +832,17 @@ void NV2AState::SetTexCoord1S(int u, int v) const {
 }
 
 void NV2AState::SetTexCoord1(float s, float t, float p, float q) const {
-  auto pb = pb_begin();
-  pb = pb_push4f(pb, NV097_SET_TEXCOORD1_4F, s, t, p, q);
-  pb_end(pb);
+  Pushbuffer::Begin();
+  Pushbuffer::PushF(NV097_SET_TEXCOORD1_4F, s, t, p, q);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord1S(int s, int t, int p, int q) const {
-  auto pb = pb_begin();
+  Pushbuffer::Begin();
   uint32_t st = (s & 0xFFFF) | (t << 16);
   uint32_t pq = (p & 0xFFFF) | (q << 16);
-  pb = pb_push2(pb, NV097_SET_TEXCOORD1_4S, st, pq);
-  pb_end(pb);
+  Pushbuffer::Push(NV097_SET_TEXCOORD1_4S, st, pq);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord2(float u, float v) const {
@@ -759,17 +859,17 @@ void NV2AState::SetTexCoord2S(int u, int v) const {
 }
 
 void NV2AState::SetTexCoord2(float s, float t, float p, float q) const {
-  auto pb = pb_begin();
-  pb = pb_push4f(pb, NV097_SET_TEXCOORD2_4F, s, t, p, q);
-  pb_end(pb);
+  Pushbuffer::Begin();
+  Pushbuffer::PushF(NV097_SET_TEXCOORD2_4F, s, t, p, q);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord2S(int s, int t, int p, int q) const {
-  auto pb = pb_begin();
+  Pushbuffer::Begin();
   uint32_t st = (s & 0xFFFF) | (t << 16);
   uint32_t pq = (p & 0xFFFF) | (q << 16);
-  pb = pb_push2(pb, NV097_SET_TEXCOORD2_4S, st, pq);
-  pb_end(pb);
+  Pushbuffer::Push(NV097_SET_TEXCOORD2_4S, st, pq);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord3(float u, float v) const {
@@ -786,20 +886,21 @@ void NV2AState::SetTexCoord3S(int u, int v) const {
 }
 
 void NV2AState::SetTexCoord3(float s, float t, float p, float q) const {
-  auto pb = pb_begin();
-  pb = pb_push4f(pb, NV097_SET_TEXCOORD3_4F, s, t, p, q);
-  pb_end(pb);
+  Pushbuffer::Begin();
+  Pushbuffer::PushF(NV097_SET_TEXCOORD3_4F, s, t, p, q);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetTexCoord3S(int s, int t, int p, int q) const {
-  auto pb = pb_begin();
+  Pushbuffer::Begin();
   uint32_t st = (s & 0xFFFF) | (t << 16);
   uint32_t pq = (p & 0xFFFF) | (q << 16);
-  pb = pb_push2(pb, NV097_SET_TEXCOORD3_4S, st, pq);
-  pb_end(pb);
+  Pushbuffer::Push(NV097_SET_TEXCOORD3_4S, st, pq);
+  Pushbuffer::End();
 }
 
 void NV2AState::SetupControl0(bool enable_stencil_write, bool w_buffered, bool texture_perspective_enable) const {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetupControl0");
   // FIXME: Figure out what to do in cases where there are multiple stages with different conversion needs.
   // Is this supported by hardware?
   bool requires_colorspace_conversion = texture_stage_[0].RequiresColorspaceConversion();
@@ -821,6 +922,7 @@ void NV2AState::SetupControl0(bool enable_stencil_write, bool w_buffered, bool t
 }
 
 void NV2AState::SetupTextureStages() const {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetupTextureStages");
   // TODO: Support texture memory that is not allocated from the base of the DMA target registered by pbkit.
   auto texture_dma_offset = reinterpret_cast<uint32_t>(texture_memory_);
   auto palette_dma_offset = reinterpret_cast<uint32_t>(texture_palette_memory_);
@@ -892,13 +994,22 @@ void NV2AState::SetPaletteSize(PaletteSize size, uint32_t stage) { texture_stage
 void NV2AState::FinishDraw() {
   PBKitBusyWait();
 
-  /* Swap buffers (if we can) */
-  while (pb_finished()) {
-    /* Not ready to swap yet */
+  {
+    PBKPP_STATS_TIME_SCOPE(FinishDraw);
+    /* Swap buffers (if we can) */
+    while (pb_finished()) {
+      /* Not ready to swap yet */
+    }
   }
+
+  // pb_finished programs the next back buffer directly.
+  Pushbuffer::InvalidateShadowRegisters();
+  Pushbuffer::GetBackend()->EndFrame();
+  PBKPP_STATS_END_FRAME();
 }
 
 void NV2AState::SetVertexShaderProgram(std::shared_ptr<VertexShaderProgram> program) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetVertexShaderProgram");
   vertex_shader_program_ = std::move(program);
 
   if (vertex_shader_program_) {
@@ -921,9 +1032,17 @@ std::shared_ptr<VertexBuffer> NV2AState::AllocateVertexBuffer(uint32_t num_verti
   return vertex_buffer_;
 }
 
+std::shared_ptr<VertexBuffer> NV2AState::AllocateVertexBuffer(uint32_t num_vertices, const VertexFormat &format,
+                                                              VertexBuffer::Layout layout) {
+  vertex_buffer_.reset();
+  vertex_buffer_ = std::make_shared<VertexBuffer>(num_vertices, format, layout);
+  return vertex_buffer_;
+}
+
 void NV2AState::SetVertexBuffer(std::shared_ptr<VertexBuffer> buffer) { vertex_buffer_ = std::move(buffer); }
 
 void NV2AState::SetXDKDefaultViewportAndFixedFunctionMatrices() {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetXDKDefaultViewportAndFixedFunctionMatrices");
   SetWindowClip(framebuffer_width_, framebuffer_height_);
   SetViewportOffset(0.531250f, 0.531250f, 0, 0);
   SetViewportScale(0, -0, 0, 0);
@@ -939,6 +1058,7 @@ void NV2AState::SetXDKDefaultViewportAndFixedFunctionMatrices() {
 }
 
 void NV2AState::SetDefaultViewportAndFixedFunctionMatrices() {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetDefaultViewportAndFixedFunctionMatrices");
   SetWindowClip(framebuffer_width_, framebuffer_height_);
   SetViewportOffset(320, 240, 0, 0);
   if (depth_buffer_format_ == NV097_SET_SURFACE_FORMAT_ZETA_Z16) {
@@ -1041,6 +1161,7 @@ void NV2AState::SetWindowClipExclusive(bool exclusive) {
 }
 
 void NV2AState::SetWindowClip(uint32_t right, uint32_t bottom, uint32_t left, uint32_t top, uint32_t region) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetWindowClip");
   Pushbuffer::Begin();
   const uint32_t offset = region * 4;
   Pushbuffer::Push(NV097_SET_WINDOW_CLIP_HORIZONTAL + offset, left + (right << 16));
@@ -1049,18 +1170,21 @@ void NV2AState::SetWindowClip(uint32_t right, uint32_t bottom, uint32_t left, ui
 }
 
 void NV2AState::SetViewportOffset(float x, float y, float z, float w) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetViewportOffset");
   Pushbuffer::Begin();
   Pushbuffer::PushF(NV097_SET_VIEWPORT_OFFSET, x, y, z, w);
   Pushbuffer::End();
 }
 
 void NV2AState::SetViewportScale(float x, float y, float z, float w) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetViewportScale");
   Pushbuffer::Begin();
   Pushbuffer::PushF(NV097_SET_VIEWPORT_SCALE, x, y, z, w);
   Pushbuffer::End();
 }
 
 void NV2AState::SetFixedFunctionModelViewMatrix(const matrix4_t &model_matrix) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetFixedFunctionModelViewMatrix");
   MatrixCopyMatrix(fixed_function_model_view_matrix_, model_matrix);
 
   Pushbuffer::Begin();
@@ -1077,6 +1201,7 @@ void NV2AState::SetFixedFunctionModelViewMatrix(const matrix4_t &model_matrix) {
 }
 
 void NV2AState::SetFixedFunctionProjectionMatrix(const matrix4_t &projection_matrix) {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetFixedFunctionProjectionMatrix");
   MatrixCopyMatrix(fixed_function_projection_matrix_, projection_matrix);
   memcpy(fixed_function_projection_matrix_, projection_matrix, sizeof(fixed_function_projection_matrix_));
 
@@ -1143,6 +1268,7 @@ void NV2AState::SetColorMask(uint32_t mask) const {
 }
 
 void NV2AState::SetBlend(bool enable, uint32_t func, uint32_t sfactor, uint32_t dfactor) const {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetBlend");
   Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_BLEND_ENABLE, enable);
   if (enable) {
@@ -1166,6 +1292,7 @@ void NV2AState::SetAlphaReference(uint32_t alpha) const {
 }
 
 void NV2AState::SetAlphaFunc(bool enable, uint32_t func) const {
+  PBKPP_TAG_CALL_SITE("NV2AState::SetAlphaFunc");
   Pushbuffer::Begin();
   Pushbuffer::Push(NV097_SET_ALPHA_TEST_ENABLE, enable);
   Pushbuffer::Push(NV097_SET_ALPHA_FUNC, func);
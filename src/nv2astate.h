@@ -8,11 +8,14 @@
 #include <string>
 
 #include "nxdk_ext.h"
+#include "dynamic_vertex_ring.h"
+#include "index_buffer.h"
 #include "pbkpp_assert.h"
 #include "pushbuffer.h"
 #include "texture_format.h"
 #include "texture_stage.h"
 #include "vertex_buffer.h"
+#include "vertex_memory_pool.h"
 #include "xbox_math_types.h"
 
 #define MASK(mask, val) (((val) << (__builtin_ffs(mask) - 1)) & (mask))
@@ -254,8 +257,11 @@ class NV2AState {
   };
 
  public:
+  //! `vertex_memory_pool_size` is the size of the contiguous region that VertexMemoryPool reserves for vertex data the
+  //! first time an NV2AState is constructed. Passing 0 disables pooling, giving each VertexBuffer its own allocation.
   NV2AState(uint32_t framebuffer_width, uint32_t framebuffer_height, uint32_t max_texture_width,
-            uint32_t max_texture_height, uint32_t max_texture_depth = 4);
+            uint32_t max_texture_height, uint32_t max_texture_depth = 4,
+            uint32_t vertex_memory_pool_size = VertexMemoryPool::kDefaultRegionSize);
   virtual ~NV2AState();
 
   TextureStage &GetTextureStage(uint32_t stage) { return texture_stage_[stage]; }
@@ -387,7 +393,12 @@ class NV2AState {
   [[nodiscard]] inline float GetFramebufferHeightF() const { return static_cast<float>(framebuffer_height_); }
 
   //! Allocates a VertexBuffer large enough to hold the given number of vertices.
+  //!
+  //! Vertex data is sub-allocated from the VertexMemoryPool; see VertexMemoryPool::GetStats for usage.
   std::shared_ptr<VertexBuffer> AllocateVertexBuffer(uint32_t num_vertices);
+  //! Allocates a compact VertexBuffer that stores only the attributes in the given format.
+  std::shared_ptr<VertexBuffer> AllocateVertexBuffer(uint32_t num_vertices, const VertexFormat &format,
+                                                     VertexBuffer::Layout layout = VertexBuffer::LAYOUT_INTERLEAVED);
   //! Sets the active vertex buffer.
   void SetVertexBuffer(std::shared_ptr<VertexBuffer> buffer);
   //! Returns the active vertex buffer.
@@ -406,13 +417,21 @@ class NV2AState {
   //! Erases the pb_text overlay.
   static void EraseText();
 
+  //! Resets the FrameArena, invalidating any scratch allocations made during the previous frame.
+  //!
   //! Note: A number of states are expected to be set before this method is called.
   //! E.g., texture stages, shader states
   //! This is not an exhaustive list and is not necessarily up to date. Prefer to call this just before initiating draw
   //! and be suspect of order dependence if you see results that seem to indicate that settings are being ignored.
   void PrepareDraw(uint32_t argb = 0xFF000000, uint32_t depth_value = 0xFFFFFFFF, uint8_t stencil_value = 0x00);
 
+  //! Draws the active vertex buffer. Fields that are not present in the buffer's VertexFormat are ignored.
   void DrawArrays(uint32_t enabled_vertex_fields = kDefaultVertexFields, DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
+  //! Draws vertices streamed through a DynamicVertexRing, then inserts a fence that allows the ring to reclaim them.
+  //!
+  //! It is illegal to call this while recording a CommandList.
+  void DrawArrays(const DynamicVertexRing::Allocation &vertices, uint32_t enabled_vertex_fields = kDefaultVertexFields,
+                  DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
   void DrawInlineBuffer(uint32_t enabled_vertex_fields = kDefaultVertexFields,
                         DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
 
@@ -428,6 +447,20 @@ class NV2AState {
   void DrawInlineElements32(const std::vector<uint32_t> &indices, uint32_t enabled_vertex_fields = kDefaultVertexFields,
                             DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
 
+  //! Draws the active vertex buffer using the indices in the given IndexBuffer. The indices are submitted by a single
+  //! pushbuffer subroutine call, so the CPU cost does not depend on the number of indices.
+  void DrawElements(const IndexBuffer &indices, uint32_t enabled_vertex_fields = kDefaultVertexFields,
+                    DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
+
+  //! Draws the active vertex buffer using the given 16-bit indices, which must be < 0xFFFF. Pairs of indices are copied
+  //! into the pushbuffer in bulk, as a uint16_t array already has the layout expected by NV097_ARRAY_ELEMENT16.
+  void DrawElements(const uint16_t *indices, uint32_t num_indices, uint32_t enabled_vertex_fields = kDefaultVertexFields,
+                    DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
+
+  //! Draws the active vertex buffer using the given 32-bit indices.
+  void DrawElements(const uint32_t *indices, uint32_t num_indices, uint32_t enabled_vertex_fields = kDefaultVertexFields,
+                    DrawPrimitive primitive = PRIMITIVE_TRIANGLES);
+
   //! Swaps the back buffer.
   static void FinishDraw();
 
@@ -496,6 +529,8 @@ class NV2AState {
 
   //! Start the process of rendering an inline-defined primitive (specified via SetXXXX methods below).
   //! Note that End() must be called to trigger rendering, and that SetVertex() triggers the creation of a vertex.
+  //!
+  //! A pushbuffer block is held open until End() is called so that the per-vertex SetXXXX calls share it.
   void Begin(DrawPrimitive primitive) const;
   //! Triggers the rendering of the primitive specified by the previous call to Begin.
   void End() const;
@@ -823,20 +858,16 @@ class NV2AState {
     Pushbuffer::End();
   }
 
-  //! Does a busywait
+  //! Busy waits until the active pushbuffer backend has consumed all submitted blocks.
   static void PBKitBusyWait() {
-    while (pb_busy()) {
-      /* Wait for completion... */
-    }
+    PBKPP_STATS_TIME_SCOPE(BusyWait);
+    Pushbuffer::WaitForIdle();
   }
 
   //! Waits for the pushbuffer to empty then resets it to head.
   //!
-  //! It is illegal to call this within a pb_begin/pb_end block, doing so may crash or lead to undefined behavior.
-  static void PBKitFlushPushbufer() {
-    PBKitBusyWait();
-    pb_reset();
-  }
+  //! It is illegal to call this within a Pushbuffer Begin/End block.
+  static void PBKitFlushPushbufer() { Pushbuffer::Flush(); }
 
   //! Renders a 256x256 checkerboard pattern that is stretched and unprojected to fill the framebuffer.
   //!
@@ -870,6 +901,15 @@ class NV2AState {
                                             bool ab_dot_product, bool cd_dot_product, CombinerSumMuxMode sum_or_mux,
                                             CombinerOutOp op) const;
 
+  //! Implements DrawInlineBuffer for vertex buffers with a compact VertexFormat.
+  void DrawInlineBufferCompact(uint32_t enabled_vertex_fields, DrawPrimitive primitive);
+
+  //! Points the vertex attributes at the given data, which is laid out as described by `format`.
+  void SetVertexAttributes(const VertexFormat &format, const uint8_t *vertex_data, uint32_t enabled_fields);
+
+  //! Draws `num_vertices` vertices from the current vertex attributes.
+  void PushDrawArrays(uint32_t num_vertices, DrawPrimitive primitive);
+
  protected:
   uint32_t framebuffer_width_;
   uint32_t framebuffer_height_;
@@ -22,6 +22,42 @@
 #define NV2A_VERTEX_ATTR_14 14
 #define NV2A_VERTEX_ATTR_15 15
 
+// Vertex array component types. nxdk only defines TYPE_F in some versions.
+#ifndef NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D 0
+#endif
+#ifndef NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1 1
+#endif
+#ifndef NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL 4
+#endif
+#ifndef NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K 5
+#endif
+#ifndef NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP 6
+#endif
+
+#ifndef NV097_SET_CONTEXT_DMA_SEMAPHORE
+#define NV097_SET_CONTEXT_DMA_SEMAPHORE 0x000001A4
+#endif
+
+// pbkit.h values needed by code that is also built with a host toolchain (e.g., Pushbuffer in tests), where only
+// nv_regs.h is available.
+#ifndef SUBCH_3D
+#define SUBCH_3D 0
+#endif
+#ifndef PBKIT_PUSHBUFFER_SIZE
+#define PBKIT_PUSHBUFFER_SIZE (512 * 1024)
+#endif
+#ifndef MAXRAM
+#define MAXRAM 0x03FFAFFF
+#endif
+#ifndef NV2A_SUPPRESS_COMMAND_INCREMENT
+#define NV2A_SUPPRESS_COMMAND_INCREMENT(cmd) (0x40000000 | (cmd))
+#endif
+
 #define NV097_SET_WEIGHT2F 0x16A0
 #define NV097_SET_WEIGHT3F 0x16B0
 
@@ -180,4 +216,8 @@
 #define NV097_SET_SWATH_WIDTH_V_04 0x04
 #define NV097_SET_SWATH_WIDTH_V_OFF 0x0F
 
+//! Drains the CPU's write combining buffers so that stores to write combined (GPU visible) memory have landed before
+//! the GPU is told about them (e.g., by a pushbuffer method referencing the memory).
+inline void FlushWriteCombinedStores() { asm volatile("sfence" ::: "memory"); }
+
 #endif  // NXDK_EXT_H__
@@ -1,10 +1,17 @@
 #include "pushbuffer.h"
 
+#ifdef XBOX
 #include <pbkit/pbkit.h>
+#else
+// Host builds (e.g., tests) only have pbkit's register definitions. nxdk_ext.h supplies the remaining constants.
+#include <pbkit/nv_regs.h>
+#endif
 
 #include <cstring>
 
+#include "nxdk_ext.h"
 #include "pbkpp_assert.h"
+#include "pushbuffer_backend.h"
 
 namespace PBKitPlusPlus {
 
@@ -12,183 +19,516 @@ namespace PBKitPlusPlus {
 static constexpr uint32_t kMaxElementsPerBlock = 96;
 // Maximum number of DWORDs in the pushbuffer, as defined by pbkit with some headroom.
 static constexpr uint32_t kMaxElements = PBKIT_PUSHBUFFER_SIZE / 5;
+static_assert(Pushbuffer::kMaxRawDwords < kMaxElementsPerBlock);
+static_assert(Pushbuffer::kSubchannel3D == SUBCH_3D);
+
+// Maximum number of parameters that may follow a single method header.
+static constexpr uint32_t kMaxParamsPerMethod = 0x7FF;
+// Bit set in a command that causes all of its parameters to be written to the same method.
+static constexpr uint32_t kNonIncrementingFlag = NV2A_SUPPRESS_COMMAND_INCREMENT(0);
+
+// Number of DWORDs written to release a fence at the end of a ring segment.
+static constexpr uint32_t kRingFenceElements = 5;
 
 Pushbuffer *Pushbuffer::singleton_ = nullptr;
 
 void Pushbuffer::Initialize() {
   if (!singleton_) {
     singleton_ = new Pushbuffer();
+    singleton_->backend_ = std::make_shared<PBKitPushbufferBackend>();
   }
 }
 
-void Pushbuffer::Begin() {
+Pushbuffer::Reservation::Reservation(uint32_t num_dwords) {
+  PBKPP_ASSERT(singleton_->block_depth_ && "Reservations must be made within a Begin/End block");
+  PBKPP_ASSERT(num_dwords < kMaxElementsPerBlock && "Reservation exceeds the maximum block size");
+
+  singleton_->Reserve(num_dwords);
+  singleton_->run_header_ = nullptr;
+
+  head_ = singleton_->head_;
+  end_ = head_ + num_dwords;
+}
+
+Pushbuffer::Reservation::~Reservation() {
+  PBKPP_ASSERT(head_ <= end_ && "Wrote more dwords than were reserved");
+  singleton_->head_ = head_;
+}
+
+void Pushbuffer::BeginCapture(std::shared_ptr<PushbufferBackend> backend) {
   PBKPP_ASSERT(singleton_);
-  PBKPP_ASSERT(!singleton_->head_ && "Nested pushbuffer blocks are not supported");
+  PBKPP_ASSERT(!singleton_->block_depth_ && "BeginCapture must not be called within a pushbuffer block");
+  PBKPP_ASSERT(!singleton_->capturing_ && "Captures may not be nested");
+
+  auto &state = singleton_->capture_state_;
+  state.backend = std::move(singleton_->backend_);
+  state.filter_redundant_writes = singleton_->filter_redundant_writes_;
+  state.ring_submission = singleton_->ring_submission_;
+  state.ring_segment = singleton_->ring_segment_;
+  state.total_block_elements = singleton_->total_block_elements_;
+
+  singleton_->capturing_ = true;
+  singleton_->backend_ = std::move(backend);
+  singleton_->filter_redundant_writes_ = false;
+  singleton_->ring_submission_ = false;
+  singleton_->total_block_elements_ = 0;
+}
+
+void Pushbuffer::EndCapture() {
+  PBKPP_ASSERT(singleton_->capturing_ && "EndCapture must not be called without BeginCapture");
+  PBKPP_ASSERT(!singleton_->block_depth_ && "EndCapture must not be called within a pushbuffer block");
+
+  auto &state = singleton_->capture_state_;
+  singleton_->backend_ = std::move(state.backend);
+  singleton_->filter_redundant_writes_ = state.filter_redundant_writes;
+  singleton_->ring_submission_ = state.ring_submission;
+  singleton_->ring_segment_ = state.ring_segment;
+  singleton_->total_block_elements_ = state.total_block_elements;
+  singleton_->capturing_ = false;
+}
 
-  singleton_->head_ = pb_begin();
+void Pushbuffer::SetBackend(std::shared_ptr<PushbufferBackend> backend) {
+  PBKPP_ASSERT(singleton_);
+  PBKPP_ASSERT(!singleton_->block_depth_ && "SetBackend must not be called within a pushbuffer block");
+  PBKPP_ASSERT(!singleton_->capturing_ && "SetBackend must not be called while capturing");
+
+  if (!backend) {
+    backend = std::make_shared<PBKitPushbufferBackend>();
+  }
+  singleton_->backend_ = std::move(backend);
   singleton_->current_block_elements_ = 0;
+  singleton_->total_block_elements_ = 0;
+  singleton_->ResetRing();
 }
 
-void Pushbuffer::End(bool flush) {
-  PBKPP_ASSERT(singleton_->head_ && "End must not be called without Begin");
+const std::shared_ptr<PushbufferBackend> &Pushbuffer::GetBackend() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->backend_;
+}
 
-  pb_end(singleton_->head_);
+const std::shared_ptr<PushbufferBackend> &Pushbuffer::GetSubmissionBackend() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->capturing_ ? singleton_->capture_state_.backend : singleton_->backend_;
+}
 
-  singleton_->current_block_elements_ = 0;
-  singleton_->head_ = nullptr;
+bool Pushbuffer::IsCapturing() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->capturing_;
+}
+
+void Pushbuffer::SetRedundantWriteFilterEnabled(bool enabled) {
+  PBKPP_ASSERT(singleton_);
+  singleton_->filter_redundant_writes_ = enabled;
+  singleton_->shadow_.Invalidate();
+}
+
+bool Pushbuffer::IsRedundantWriteFilterEnabled() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->filter_redundant_writes_;
+}
+
+void Pushbuffer::InvalidateShadowRegisters() {
+  PBKPP_ASSERT(singleton_);
+  singleton_->shadow_.Invalidate();
+  singleton_->backend_->InvalidateState();
+}
+
+void Pushbuffer::SetCoalescingEnabled(bool enabled) {
+  PBKPP_ASSERT(singleton_);
+  singleton_->coalesce_writes_ = enabled;
+  singleton_->run_header_ = nullptr;
+}
+
+bool Pushbuffer::IsCoalescingEnabled() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->coalesce_writes_;
+}
+
+void Pushbuffer::SetRingSubmissionEnabled(bool enabled) {
+  PBKPP_ASSERT(singleton_);
+  PBKPP_ASSERT(!singleton_->block_depth_ && "SetRingSubmissionEnabled must not be called within a pushbuffer block");
+  PBKPP_ASSERT(!singleton_->capturing_ && "SetRingSubmissionEnabled must not be called while capturing");
+
+  Flush();
+  singleton_->ring_submission_ = enabled;
+}
+
+bool Pushbuffer::IsRingSubmissionEnabled() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->ring_submission_;
+}
+
+void Pushbuffer::Begin() {
+  PBKPP_ASSERT(singleton_);
+
+  if (singleton_->block_depth_++) {
+    return;
+  }
+  PBKPP_STATS_RECORD(LogicalBlock);
+  singleton_->OpenBlock();
+}
+
+void Pushbuffer::End(bool flush) {
+  PBKPP_ASSERT(singleton_->block_depth_ && "End must not be called without Begin");
+
+  if (--singleton_->block_depth_) {
+    PBKPP_ASSERT(!flush && "Flush must not be requested when ending a nested pushbuffer block");
+    return;
+  }
+  singleton_->CloseBlock();
 
   if (flush) {
     Flush();
   }
 }
 
+bool Pushbuffer::IsInBlock() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->block_depth_ != 0;
+}
+
 void Pushbuffer::Flush() {
   PBKPP_ASSERT(!singleton_->head_ && "Flush must not be called within a pushbuffer block");
 
-  while (pb_busy()) {
-    /* Wait for completion... */
+  if (singleton_->capturing_) {
+    // Only the capture is reset. The live pushbuffer, including the fences that guard its ring segments, is left as it
+    // was so that EndCapture resumes it safely.
+    singleton_->backend_->Reset();
+    singleton_->current_block_elements_ = 0;
+    singleton_->total_block_elements_ = 0;
+    return;
+  }
+
+  PBKPP_STATS_RECORD(Flush);
+
+  {
+    PBKPP_STATS_TIME_SCOPE(Flush);
+    WaitForIdle();
   }
 
-  pb_reset();
+  singleton_->backend_->Reset();
 
   singleton_->current_block_elements_ = 0;
   singleton_->total_block_elements_ = 0;
+  singleton_->ResetRing();
+}
+
+void Pushbuffer::WaitForIdle() {
+  auto &backend = singleton_->backend_;
+  while (backend->Busy()) {
+    /* Wait for completion... */
+  }
+}
+
+#ifdef PBKPP_INSTRUMENTATION
+void Pushbuffer::SetCallSiteTag(const char *tag) {
+  PBKPP_ASSERT(singleton_);
+
+  singleton_->call_site_tag_ = tag;
+  singleton_->run_header_ = nullptr;
+  singleton_->backend_->Tag(singleton_->head_, tag);
+}
+
+const char *Pushbuffer::GetCallSiteTag() {
+  PBKPP_ASSERT(singleton_);
+  return singleton_->call_site_tag_;
+}
+#endif
+
+void Pushbuffer::OpenBlock() {
+  head_ = backend_->Begin();
+  current_block_elements_ = 0;
+  run_header_ = nullptr;
+}
+
+void Pushbuffer::CloseBlock() {
+  backend_->End(head_);
+  PBKPP_STATS_RECORD(BackendBlock);
+
+  current_block_elements_ = 0;
+  head_ = nullptr;
+  run_header_ = nullptr;
 }
 
 void Pushbuffer::Reserve(uint32_t num_dwords) {
+  if (ring_submission_) {
+    ReserveRing(num_dwords);
+  } else if (total_block_elements_ + num_dwords >= kMaxElements) {
+    CloseBlock();
+    Flush();
+    OpenBlock();
+  } else if (current_block_elements_ + num_dwords >= kMaxElementsPerBlock) {
+    CloseBlock();
+    OpenBlock();
+  }
+
   total_block_elements_ += num_dwords;
   current_block_elements_ += num_dwords;
+}
 
-  if (total_block_elements_ >= kMaxElements) {
-    End(true);
-    Begin();
-    return;
+void Pushbuffer::ReserveRing(uint32_t num_dwords) {
+  static constexpr uint32_t kRingSegmentElements = kMaxElements / kRingSegments;
+
+  // Room is always left for the fence that ends the current segment, so it never spills into the next one.
+  auto end = total_block_elements_ + num_dwords + kRingFenceElements;
+  auto end_segment = end / kRingSegmentElements;
+  if (end_segment >= kRingSegments) {
+    end_segment = kRingSegments - 1;
+  }
+
+  if (end >= kMaxElements) {
+    EmitRingFence();
+    CloseBlock();
+    backend_->Wrap();
+    total_block_elements_ = 0;
+    EnterRingSegment(0);
+  } else if (end_segment != ring_segment_) {
+    EmitRingFence();
+    CloseBlock();
+    EnterRingSegment(ring_segment_ + 1);
+  } else if (current_block_elements_ + num_dwords >= kMaxElementsPerBlock) {
+    CloseBlock();
+    OpenBlock();
+  }
+}
+
+void Pushbuffer::EmitRingFence() {
+  // The fence is not part of any reservation, so it is moved into a block of its own if the current block cannot hold
+  // it without exceeding the per-block limit.
+  if (current_block_elements_ + kRingFenceElements >= kMaxElementsPerBlock) {
+    CloseBlock();
+    OpenBlock();
+  }
+
+  auto fence = FenceManager::Allocate();
+
+  head_[0] = EncodeMethod(SUBCH_3D, NV097_SET_CONTEXT_DMA_SEMAPHORE, 1);
+  head_[1] = FenceManager::kSemaphoreDMAChannel;
+  head_[2] = EncodeMethod(SUBCH_3D, NV097_SET_SEMAPHORE_OFFSET, 2);
+  head_[3] = FenceManager::GetSemaphoreOffset();
+  head_[4] = fence.value;
+
+  if (filter_redundant_writes_) {
+    shadow_.Update(NV097_SET_CONTEXT_DMA_SEMAPHORE, 1, head_ + 1);
+    shadow_.Update(NV097_SET_SEMAPHORE_OFFSET, 1, head_ + 3);
+  }
+
+  head_ += kRingFenceElements;
+  PBKPP_STATS_RECORD_METHOD(SUBCH_3D, NV097_SET_CONTEXT_DMA_SEMAPHORE, MethodSize(1));
+  PBKPP_STATS_RECORD_METHOD(SUBCH_3D, NV097_SET_SEMAPHORE_OFFSET, MethodSize(2));
+  current_block_elements_ += kRingFenceElements;
+  total_block_elements_ += kRingFenceElements;
+  run_header_ = nullptr;
+
+  ring_fences_[ring_segment_] = fence;
+}
+
+void Pushbuffer::EnterRingSegment(uint32_t segment) {
+  // No block is open at this point, so an idle backend implies that every fence has been passed.
+  auto fence = ring_fences_[segment];
+  while (!FenceManager::IsSignaled(fence) && backend_->Busy()) {
+    /* Wait for the GPU to move past the segment... */
   }
 
-  if (current_block_elements_ >= kMaxElementsPerBlock) {
-    End();
-    Begin();
+  ring_segment_ = segment;
+  OpenBlock();
+}
+
+void Pushbuffer::ResetRing() {
+  ring_segment_ = 0;
+  for (auto &fence : ring_fences_) {
+    fence = Fence();
+  }
+}
+
+uint32_t *Pushbuffer::EmitMethod(uint32_t subchannel, uint32_t command, uint32_t num_params) {
+  bool extends_run = coalesce_writes_ && run_header_ && subchannel == run_subchannel_ &&
+                     command == run_next_command_ && run_num_params_ + num_params <= kMaxParamsPerMethod;
+
+  // Space for a header is always reserved, as Reserve may start a new block in which case the run cannot be extended.
+  Reserve(num_params + 1);
+
+  if (extends_run && run_header_) {
+    // The params are appended to the existing run, so the header dword is handed back.
+    --current_block_elements_;
+    --total_block_elements_;
+
+    *run_header_ += EncodeMethod(0, 0, num_params);
+    run_num_params_ += num_params;
+    if (!(command & kNonIncrementingFlag)) {
+      run_next_command_ += num_params * 4;
+    }
+
+    uint32_t *params = head_;
+    head_ += num_params;
+    PBKPP_STATS_RECORD_METHOD(subchannel, command, num_params);
+    return params;
+  }
+
+  uint32_t *params = head_ + 1;
+  *head_ = EncodeMethod(subchannel, command, num_params);
+
+  run_header_ = head_;
+  run_subchannel_ = subchannel;
+  run_num_params_ = num_params;
+  run_next_command_ = command & kNonIncrementingFlag ? command : command + num_params * 4;
+
+  head_ = params + num_params;
+  PBKPP_STATS_RECORD_METHOD(subchannel, command, MethodSize(num_params));
+  return params;
+}
+
+void Pushbuffer::Emit(uint32_t subchannel, uint32_t command, uint32_t num_params, const uint32_t *params) {
+  if (filter_redundant_writes_ && subchannel == SUBCH_3D) {
+    if (shadow_.IsRedundant(command, num_params, params)) {
+      return;
+    }
+    shadow_.Update(command, num_params, params);
+  }
+
+  memcpy(EmitMethod(subchannel, command, num_params), params, num_params * sizeof(uint32_t));
+}
+
+void Pushbuffer::PushRaw(const uint32_t *dwords, uint32_t num_dwords) {
+  PBKPP_ASSERT(singleton_->block_depth_ && "PushRaw must be called within a Begin/End block");
+  PBKPP_ASSERT(num_dwords <= kMaxRawDwords && "PushRaw called with too many dwords");
+
+  singleton_->Reserve(num_dwords);
+  singleton_->run_header_ = nullptr;
+
+  memcpy(singleton_->head_, dwords, num_dwords * sizeof(uint32_t));
+  singleton_->head_ += num_dwords;
+  PBKPP_STATS_RECORD_RAW_DWORDS(num_dwords);
+
+  // The backend is notified even when filtering is disabled, as it may track register values itself (e.g., in a
+  // capture).
+  InvalidateShadowRegisters();
+}
+
+void Pushbuffer::PushCall(const uint32_t *subroutine, bool modifies_state, uint32_t num_indices) {
+  // Flag that turns a 4-byte aligned pushbuffer address into a subroutine call command.
+  static constexpr uint32_t kCallFlag = 0x00000002;
+
+  PBKPP_ASSERT(singleton_->block_depth_ && "PushCall must be called within a Begin/End block");
+
+  singleton_->Reserve(1);
+  singleton_->run_header_ = nullptr;
+
+  *singleton_->head_ = (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(subroutine)) & 0x03FFFFFF) | kCallFlag;
+  singleton_->backend_->Call(singleton_->head_++, num_indices);
+  PBKPP_STATS_RECORD_RAW_DWORDS(1);
+
+  if (modifies_state) {
+    InvalidateShadowRegisters();
   }
 }
 
 void Pushbuffer::PushTo(uint32_t subchannel, uint32_t command, uint32_t param1) {
-  singleton_->Reserve(2);
-  singleton_->head_ = pb_push1_to(subchannel, singleton_->head_, command, param1);
+  singleton_->Emit(subchannel, command, 1, &param1);
 }
 
-//! Pushes the given command and params to the given subchannel, returning a pointer to the next pushbuffer index to
-//! facilitate chaining.
 void Pushbuffer::PushTo(uint32_t subchannel, uint32_t command, uint32_t param1, uint32_t param2) {
-  singleton_->Reserve(3);
-  singleton_->head_ = pb_push2_to(subchannel, singleton_->head_, command, param1, param2);
+  const uint32_t params[] = {param1, param2};
+  singleton_->Emit(subchannel, command, 2, params);
 }
 
 void Pushbuffer::PushTo(uint32_t subchannel, uint32_t command, uint32_t param1, uint32_t param2, uint32_t param3) {
-  singleton_->Reserve(4);
-  singleton_->head_ = pb_push3_to(subchannel, singleton_->head_, command, param1, param2, param3);
+  const uint32_t params[] = {param1, param2, param3};
+  singleton_->Emit(subchannel, command, 3, params);
 }
 
 void Pushbuffer::PushTo(uint32_t subchannel, uint32_t command, uint32_t param1, uint32_t param2, uint32_t param3,
                         uint32_t param4) {
-  singleton_->Reserve(5);
-  singleton_->head_ = pb_push4_to(subchannel, singleton_->head_, command, param1, param2, param3, param4);
+  const uint32_t params[] = {param1, param2, param3, param4};
+  singleton_->Emit(subchannel, command, 4, params);
 }
 
 void Pushbuffer::PushTo(uint32_t subchannel, uint32_t command, float param1, float param2, float param3, float param4) {
-  singleton_->Reserve(5);
-  singleton_->head_ = pb_push4f_to(subchannel, singleton_->head_, command, param1, param2, param3, param4);
+  const float params[] = {param1, param2, param3, param4};
+  singleton_->Emit(subchannel, command, 4, reinterpret_cast<const uint32_t *>(params));
 }
 
 void Pushbuffer::PushF(uint32_t command, float param1) {
-  singleton_->Reserve(2);
-  singleton_->head_ = pb_push1f(singleton_->head_, command, param1);
+  singleton_->Emit(SUBCH_3D, command, 1, reinterpret_cast<const uint32_t *>(&param1));
 }
 
 void Pushbuffer::PushF(uint32_t command, float param1, float param2) {
-  singleton_->Reserve(3);
-  singleton_->head_ = pb_push2f(singleton_->head_, command, param1, param2);
+  const float params[] = {param1, param2};
+  singleton_->Emit(SUBCH_3D, command, 2, reinterpret_cast<const uint32_t *>(params));
 }
 
 void Pushbuffer::PushF(uint32_t command, float param1, float param2, float param3) {
-  singleton_->Reserve(4);
-  singleton_->head_ = pb_push3f(singleton_->head_, command, param1, param2, param3);
+  const float params[] = {param1, param2, param3};
+  singleton_->Emit(SUBCH_3D, command, 3, reinterpret_cast<const uint32_t *>(params));
 }
 
 void Pushbuffer::PushF(uint32_t command, float param1, float param2, float param3, float param4) {
-  singleton_->Reserve(5);
-  singleton_->head_ = pb_push4f(singleton_->head_, command, param1, param2, param3, param4);
+  const float params[] = {param1, param2, param3, param4};
+  singleton_->Emit(SUBCH_3D, command, 4, reinterpret_cast<const uint32_t *>(params));
 }
 
-void Pushbuffer::Push(uint32_t command, uint32_t param1) {
-  singleton_->Reserve(2);
-  singleton_->head_ = pb_push1(singleton_->head_, command, param1);
-}
+void Pushbuffer::Push(uint32_t command, uint32_t param1) { singleton_->Emit(SUBCH_3D, command, 1, &param1); }
 
 void Pushbuffer::Push(uint32_t command, uint32_t param1, uint32_t param2) {
-  singleton_->Reserve(3);
-  singleton_->head_ = pb_push2(singleton_->head_, command, param1, param2);
+  const uint32_t params[] = {param1, param2};
+  singleton_->Emit(SUBCH_3D, command, 2, params);
 }
 
 void Pushbuffer::Push(uint32_t command, uint32_t param1, uint32_t param2, uint32_t param3) {
-  singleton_->Reserve(4);
-  singleton_->head_ = pb_push3(singleton_->head_, command, param1, param2, param3);
+  const uint32_t params[] = {param1, param2, param3};
+  singleton_->Emit(SUBCH_3D, command, 3, params);
 }
 
 void Pushbuffer::Push(uint32_t command, uint32_t param1, uint32_t param2, uint32_t param3, uint32_t param4) {
-  singleton_->Reserve(5);
-  singleton_->head_ = pb_push4(singleton_->head_, command, param1, param2, param3, param4);
+  const uint32_t params[] = {param1, param2, param3, param4};
+  singleton_->Emit(SUBCH_3D, command, 4, params);
 }
 
 void Pushbuffer::Push2F(uint32_t command, const float *vector2) {
-  singleton_->Reserve(3);
-  singleton_->head_ = pb_push2fv(singleton_->head_, command, vector2);
+  singleton_->Emit(SUBCH_3D, command, 2, reinterpret_cast<const uint32_t *>(vector2));
 }
 
 void Pushbuffer::Push3F(uint32_t command, const float *vector3) {
-  singleton_->Reserve(4);
-  singleton_->head_ = pb_push3fv(singleton_->head_, command, vector3);
+  singleton_->Emit(SUBCH_3D, command, 3, reinterpret_cast<const uint32_t *>(vector3));
 }
 
 void Pushbuffer::Push4F(uint32_t command, const float *vector4) {
-  singleton_->Reserve(5);
-  singleton_->head_ = pb_push4fv(singleton_->head_, command, vector4);
+  singleton_->Emit(SUBCH_3D, command, 4, reinterpret_cast<const uint32_t *>(vector4));
 }
 
 void Pushbuffer::Push2(uint32_t command, const DWORD *vector2) {
-  singleton_->Reserve(3);
-  singleton_->head_ = pb_push2v(singleton_->head_, command, vector2);
+  singleton_->Emit(SUBCH_3D, command, 2, reinterpret_cast<const uint32_t *>(vector2));
 }
 
 void Pushbuffer::Push3(uint32_t command, const DWORD *vector3) {
-  singleton_->Reserve(4);
-  singleton_->head_ = pb_push3v(singleton_->head_, command, vector3);
+  singleton_->Emit(SUBCH_3D, command, 3, reinterpret_cast<const uint32_t *>(vector3));
 }
 
 void Pushbuffer::Push4(uint32_t command, const DWORD *vector4) {
-  singleton_->Reserve(5);
-  singleton_->head_ = pb_push4v(singleton_->head_, command, vector4);
+  singleton_->Emit(SUBCH_3D, command, 4, reinterpret_cast<const uint32_t *>(vector4));
 }
 
 void Pushbuffer::PushN(uint32_t command, uint32_t num_values, const DWORD *values) {
-  singleton_->Reserve(num_values + 1);
-  pb_push(singleton_->head_++, command, num_values);
-  memcpy(singleton_->head_, values, num_values * 4);
-  singleton_->head_ += num_values;
+  singleton_->Emit(SUBCH_3D, command, num_values, reinterpret_cast<const uint32_t *>(values));
 }
 
 void Pushbuffer::PushTransposedMatrix(uint32_t command, const float *m) {
-  singleton_->Reserve(17);
-  singleton_->head_ = pb_push_transposed_matrix(singleton_->head_, command, m);
+  float transposed[16];
+  auto params = transposed;
+  for (auto column = 0; column < 4; ++column) {
+    for (auto row = 0; row < 4; ++row) {
+      *params++ = m[row * 4 + column];
+    }
+  }
+  singleton_->Emit(SUBCH_3D, command, 16, reinterpret_cast<const uint32_t *>(transposed));
 }
 
 void Pushbuffer::Push4x3Matrix(uint32_t command, const float *m) {
-  singleton_->Reserve(13);
-  singleton_->head_ = pb_push_4x3_matrix(singleton_->head_, command, m);
+  singleton_->Emit(SUBCH_3D, command, 12, reinterpret_cast<const uint32_t *>(m));
 }
 
 void Pushbuffer::Push4x4Matrix(uint32_t command, const float *m) {
-  singleton_->Reserve(17);
-  singleton_->head_ = pb_push_4x4_matrix(singleton_->head_, command, m);
+  singleton_->Emit(SUBCH_3D, command, 16, reinterpret_cast<const uint32_t *>(m));
 }
 
 }  // namespace PBKitPlusPlus
@@ -1,31 +1,204 @@
 #ifndef PUSHBUFFER_H
 #define PUSHBUFFER_H
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#ifdef XBOX
 #include <xboxkrnl/xboxdef.h>
+#else
+// Host builds (e.g., tests) do not have xboxkrnl.
+typedef uint32_t DWORD;
+#endif
 
-#include <cstdint>
+#include "fence.h"
+#include "pushbuffer_stats.h"
+#include "register_shadow.h"
 
 namespace PBKitPlusPlus {
 
+class CommandList;
+class PushbufferBackend;
+
 //! Manages pb_kit pushbuffers to prevent overflows and optimize resets.
 //!
 //! In particular, this class manages the underlying pbkit begin/end block to
 //! transparently break large logical blocks into chunks under the max size
 //! allowed by pbkit.
+//!
+//! Commands are written into storage provided by a PushbufferBackend, which submits them to pbkit by default.
+//!
+//! Logical blocks may be nested, in which case only the outermost Begin/End pair opens and commits a block. This allows
+//! many small operations that each wrap themselves in a Begin/End pair to share a single underlying block.
 class Pushbuffer {
  public:
+  //! Holds a logical pushbuffer block open for the lifetime of the object.
+  class ScopedBlock {
+   public:
+    ScopedBlock() { Begin(); }
+    ~ScopedBlock() { End(); }
+
+    ScopedBlock(const ScopedBlock &) = delete;
+    ScopedBlock &operator=(const ScopedBlock &) = delete;
+  };
+
+  //! Reserves space for a fixed number of dwords in the current block so that a batch of methods can be written
+  //! straight into the pushbuffer without per-push bookkeeping.
+  //!
+  //! Writes made through a Reservation are never coalesced or filtered. A Reservation may only be created within a
+  //! Begin/End block, may not exceed the maximum block size, and must be destroyed before any other push is made.
+  class Reservation {
+   public:
+    explicit Reservation(uint32_t num_dwords);
+    ~Reservation();
+
+    Reservation(const Reservation &) = delete;
+    Reservation &operator=(const Reservation &) = delete;
+
+    //! Pushes the given command and params to the subchannel assigned for 3D operations.
+    template <typename... Params>
+    void Push(uint32_t command, Params... params) {
+      const uint32_t values[] = {static_cast<uint32_t>(params)...};
+      PushN<sizeof...(Params)>(command, values);
+    }
+
+    //! Pushes the given command and floating point params to the subchannel assigned for 3D operations.
+    template <typename... Params>
+    void PushF(uint32_t command, Params... params) {
+      const float values[] = {static_cast<float>(params)...};
+      PushN<sizeof...(Params)>(command, values);
+    }
+
+    //! Pushes the given command and kNumValues dwords from values to the subchannel assigned for 3D operations.
+    template <uint32_t kNumValues>
+    void PushN(uint32_t command, const void *values) {
+      uint32_t *params = Emit(command, kNumValues);
+      memcpy(params, values, kNumValues * sizeof(uint32_t));
+      if (singleton_->filter_redundant_writes_) {
+        singleton_->shadow_.Update(command, kNumValues, params);
+      }
+    }
+
+    //! Writes a method header for the given command and returns a pointer to the num_params dwords that must be filled
+    //! in by the caller. The values written are not tracked by the redundant write filter.
+    uint32_t *Emit(uint32_t command, uint32_t num_params) {
+      uint32_t *params = head_ + 1;
+      *head_ = EncodeMethod(kSubchannel3D, command, num_params);
+      head_ = params + num_params;
+      PBKPP_STATS_RECORD_METHOD(kSubchannel3D, command, MethodSize(num_params));
+      if (singleton_->filter_redundant_writes_) {
+        singleton_->shadow_.Invalidate(command, num_params);
+      }
+      return params;
+    }
+
+   private:
+    uint32_t *head_;
+    uint32_t *end_;
+  };
+
+  //! The subchannel that pbkit binds to the 3D (NV097) class. Equal to pbkit's SUBCH_3D, which is not used here so that
+  //! this header does not depend on pbkit.
+  static constexpr uint32_t kSubchannel3D = 0;
+
+  //! The maximum number of dwords that may be passed to a single PushRaw call.
+  static constexpr uint32_t kMaxRawDwords = 95;
+
+  //! Returns the number of dwords needed to push a single method with the given number of params.
+  static constexpr uint32_t MethodSize(uint32_t num_params) { return num_params + 1; }
+
   //! Initializes the pushbuffer singleton.
   static void Initialize();
 
+  //! Replaces the backend that receives pushbuffer blocks. Passing nullptr restores the default pbkit backend.
+  //!
+  //! It is illegal to call this within a Begin/End block.
+  static void SetBackend(std::shared_ptr<PushbufferBackend> backend);
+
+  //! Returns the backend that currently receives pushbuffer blocks.
+  static const std::shared_ptr<PushbufferBackend> &GetBackend();
+
+  //! Returns the backend that submits pushbuffer blocks to the GPU. This is the same as GetBackend, except while a
+  //! CommandList is being recorded, in which case it is the backend that was active before recording started.
+  static const std::shared_ptr<PushbufferBackend> &GetSubmissionBackend();
+
+  //! Returns true while a CommandList is being recorded, during which pushes are captured rather than submitted.
+  static bool IsCapturing();
+
+  //! Enables or disables dropping of writes to 3D subchannel methods that would not change the value of the target
+  //! registers. Changing the mode invalidates all shadowed values.
+  static void SetRedundantWriteFilterEnabled(bool enabled);
+
+  //! Returns true if redundant 3D subchannel writes are being dropped.
+  static bool IsRedundantWriteFilterEnabled();
+
+  //! Enables or disables merging of pushes that target consecutive methods on the same subchannel (or repeated pushes
+  //! to the same non-incrementing method) into a single method header.
+  static void SetCoalescingEnabled(bool enabled);
+
+  //! Returns true if consecutive method pushes are being merged.
+  static bool IsCoalescingEnabled();
+
+  //! Enables or disables ring submission. When enabled, reaching the end of the pushbuffer jumps back to its start
+  //! instead of waiting for the GPU to become idle and resetting. The pushbuffer is divided into segments whose
+  //! consumption is tracked with fences, so writing only stalls if the GPU is still processing a segment that is about
+  //! to be overwritten. Changing the mode flushes the pushbuffer.
+  //!
+  //! FenceManager::Initialize must have been called before enabling ring submission. It is illegal to call this within
+  //! a Begin/End block or while a CommandList is being recorded.
+  static void SetRingSubmissionEnabled(bool enabled);
+
+  //! Returns true if the pushbuffer is wrapped rather than flushed when it fills up.
+  static bool IsRingSubmissionEnabled();
+
+  //! Forgets all shadowed register values so that the next write to every method is emitted.
+  //!
+  //! Must be called whenever nv2a state may have been modified without going through this class (e.g., by pbkit
+  //! functions such as pb_fill or pb_finished) or may have been lost.
+  static void InvalidateShadowRegisters();
+
   //! Starts a logical pushbuffer block.
   static void Begin();
 
-  //! Commits any outstanding pushbuffer messages.
+  //! Commits any outstanding pushbuffer messages. If this ends a nested block, the messages are not committed until the
+  //! outermost block is ended.
+  //!
+  //! It is illegal to request a flush when ending a nested block.
   static void End(bool flush = false);
 
-  //! Flushes and ressets the underlying pushbuffer.
+  //! Flushes and ressets the underlying pushbuffer. While a CommandList is being recorded, only the recording is reset
+  //! and the live pushbuffer is left untouched.
+  //!
+  //! It is illegal to call this within a Begin/End block.
   static void Flush();
 
+  //! Waits until the backend has consumed all submitted blocks. Unlike Flush, the pushbuffer is not reset.
+  static void WaitForIdle();
+
+  //! Returns true if a logical pushbuffer block is currently open.
+  static bool IsInBlock();
+
+  //! Appends pre-encoded method headers and parameters verbatim. The dwords must consist of whole methods and may not
+  //! exceed kMaxRawDwords.
+  //!
+  //! As the affected registers are not decoded, all shadowed register values are discarded as with
+  //! InvalidateShadowRegisters.
+  static void PushRaw(const uint32_t *dwords, uint32_t num_dwords);
+
+  //! Pushes a call to a pushbuffer subroutine in contiguous memory, which must end with kSubroutineReturn. The nv2a
+  //! does not support nested subroutines, so the subroutine must not itself contain calls.
+  //!
+  //! If `modifies_state` is true, all shadowed register values are discarded as with PushRaw. Subroutines that only
+  //! trigger work (e.g., element arrays) may pass false to preserve them.
+  //!
+  //! `num_indices` is the number of vertex indices submitted by the subroutine, if any. It is passed on to the backend
+  //! so that captures can account for draws whose indices are not part of the pushbuffer.
+  static void PushCall(const uint32_t *subroutine, bool modifies_state = true, uint32_t num_indices = 0);
+
+  //! Pushbuffer command that returns from a subroutine started by PushCall.
+  static constexpr uint32_t kSubroutineReturn = 0x00020000;
+
   //! Pushes the given command and param to the given subchannel.
   static void PushTo(uint32_t subchannel, uint32_t command, uint32_t param1);
 
@@ -101,20 +274,111 @@ class Pushbuffer {
   //! Pushes a 4x4 matrix without transposing it.
   static void Push4x4Matrix(uint32_t command, const float *m);
 
+#ifdef PBKPP_INSTRUMENTATION
+  //! Attributes subsequent pushes to the given call site, which must be a string with static storage duration. The
+  //! current method run is ended so that no method header spans more than one call site.
+  //!
+  //! Generally used via the PBKPP_TAG_CALL_SITE macro.
+  static void SetCallSiteTag(const char *tag);
+
+  //! Returns the tag most recently passed to SetCallSiteTag.
+  static const char *GetCallSiteTag();
+#endif
+
  private:
+  friend class CommandList;
+
+  //! State of the live pushbuffer that is set aside while commands are being captured.
+  struct CaptureState {
+    std::shared_ptr<PushbufferBackend> backend;
+    bool filter_redundant_writes;
+    bool ring_submission;
+    uint32_t ring_segment;
+    uint32_t total_block_elements;
+  };
+
   Pushbuffer() = default;
 
+  //! Redirects all pushes into the given backend until EndCapture is called. Redundant write filtering and ring
+  //! submission are suspended so that the captured stream does not depend on the current state of the pushbuffer.
+  static void BeginCapture(std::shared_ptr<PushbufferBackend> backend);
+
+  //! Restores the backend and state that were active when BeginCapture was called.
+  static void EndCapture();
+
+  //! Builds a method header in the same format as pbkit's pb_push_to.
+  static constexpr uint32_t EncodeMethod(uint32_t subchannel, uint32_t command, uint32_t num_params) {
+    return (num_params << 18) + (subchannel << 13) + command;
+  }
+
+  //! Opens an underlying backend block.
+  void OpenBlock();
+
+  //! Commits the current underlying backend block.
+  void CloseBlock();
+
   //! Ensures that at least num_dwords values may be added to the pushbuffer.
   void Reserve(uint32_t num_dwords);
 
+  //! Implements Reserve for ring submission mode, moving to the next segment or wrapping as necessary.
+  void ReserveRing(uint32_t num_dwords);
+
+  //! Writes a fence marking the end of the current ring segment into the current block.
+  void EmitRingFence();
+
+  //! Waits until the GPU has finished with the previous contents of the given ring segment, then opens a block in it.
+  void EnterRingSegment(uint32_t segment);
+
+  //! Forgets all ring segment fences, which must only be done once the GPU is idle.
+  void ResetRing();
+
+  //! Reserves space for and writes a method header, returning a pointer to the num_params parameter dwords that follow
+  //! it.
+  uint32_t *EmitMethod(uint32_t subchannel, uint32_t command, uint32_t num_params);
+
+  //! Writes the given command and params, unless redundant write filtering is enabled and the write would not change
+  //! any register.
+  void Emit(uint32_t subchannel, uint32_t command, uint32_t num_params, const uint32_t *params);
+
+  std::shared_ptr<PushbufferBackend> backend_;
+
+  bool coalesce_writes_ = false;
+  //! The header of the most recent method in the current block, which subsequent pushes may be merged into.
+  uint32_t *run_header_ = nullptr;
+  uint32_t run_subchannel_ = 0;
+  uint32_t run_num_params_ = 0;
+  //! The command that a push must target in order to be merged into run_header_.
+  uint32_t run_next_command_ = 0;
+
+  bool filter_redundant_writes_ = false;
+  RegisterShadow shadow_;
+
+  //! Number of segments the pushbuffer is divided into in ring submission mode.
+  static constexpr uint32_t kRingSegments = 4;
+  bool ring_submission_ = false;
+  //! The ring segment that is currently being written.
+  uint32_t ring_segment_ = 0;
+  //! Fences marking the end of the most recent contents of each ring segment.
+  Fence ring_fences_[kRingSegments];
+
   uint32_t *head_ = nullptr;
 
+  //! The number of logical blocks that are currently open.
+  uint32_t block_depth_ = 0;
+
   //! The number of dwords in the current begin/end block.
   uint32_t current_block_elements_ = 0;
 
   //! The total number of dwords submitted since the last flush/reset.
   uint32_t total_block_elements_ = 0;
 
+  bool capturing_ = false;
+  CaptureState capture_state_;
+
+#ifdef PBKPP_INSTRUMENTATION
+  const char *call_site_tag_ = nullptr;
+#endif
+
   static Pushbuffer *singleton_;
 };
 
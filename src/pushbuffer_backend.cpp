@@ -0,0 +1,19 @@
+#include "pushbuffer_backend.h"
+
+#include <pbkit/pbkit.h>
+
+namespace PBKitPlusPlus {
+
+uint32_t *PBKitPushbufferBackend::Begin() { return pb_begin(); }
+
+void PBKitPushbufferBackend::End(uint32_t *head) { pb_end(head); }
+
+bool PBKitPushbufferBackend::Busy() { return pb_busy() != 0; }
+
+void PBKitPushbufferBackend::Reset() { pb_reset(); }
+
+// pb_reset writes a jump back to the head of the pushbuffer and moves the put pointer there; it does not wait for the
+// GPU itself.
+void PBKitPushbufferBackend::Wrap() { pb_reset(); }
+
+}  // namespace PBKitPlusPlus
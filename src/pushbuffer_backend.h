@@ -0,0 +1,61 @@
+#ifndef PBKITPLUSPLUS_SRC_PUSHBUFFER_BACKEND_H_
+#define PBKITPLUSPLUS_SRC_PUSHBUFFER_BACKEND_H_
+
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+//! Provides the storage that `Pushbuffer` writes method headers and parameters into and consumes the resulting blocks.
+class PushbufferBackend {
+ public:
+  virtual ~PushbufferBackend() = default;
+
+  //! Opens a block and returns the address at which the first dword should be written.
+  virtual uint32_t *Begin() = 0;
+
+  //! Closes the block opened by `Begin`. `head` points just past the last dword that was written.
+  virtual void End(uint32_t *head) = 0;
+
+  //! Returns true if previously submitted blocks have not yet been fully consumed.
+  virtual bool Busy() = 0;
+
+  //! Rewinds the backend to the start of its storage. Only called once `Busy` has returned false.
+  virtual void Reset() = 0;
+
+  //! Rewinds the backend to the start of its storage without waiting for previously submitted blocks to be consumed.
+  //! The caller is responsible for ensuring that the consumer has moved past any storage that will be overwritten.
+  virtual void Wrap() = 0;
+
+  //! Called by NV2AState::FinishDraw once all commands for a frame have been submitted.
+  virtual void EndFrame() {}
+
+  //! Called after a subroutine call command has been written at `position` within the open block. `num_indices` is the
+  //! number of vertex indices submitted by the subroutine (e.g., the size of an IndexBuffer), or zero if it does not
+  //! submit indices.
+  virtual void Call(const uint32_t *position, uint32_t num_indices) {}
+
+  //! Called by Pushbuffer::InvalidateShadowRegisters when nv2a state may have been modified without going through the
+  //! pushbuffer.
+  virtual void InvalidateState() {}
+
+  //! Associates the dwords written from `position` onwards with a call site (e.g., the name of an NV2AState method).
+  //! `position` is null if no block is open, in which case the tag applies from the start of the next block. `tag` may
+  //! be null to indicate that subsequent dwords have no associated call site.
+  //!
+  //! Only called when PBKPP_INSTRUMENTATION is enabled.
+  virtual void Tag(const uint32_t *position, const char *tag) {}
+};
+
+//! Submits pushbuffer blocks to the nv2a via pbkit.
+class PBKitPushbufferBackend : public PushbufferBackend {
+ public:
+  uint32_t *Begin() override;
+  void End(uint32_t *head) override;
+  bool Busy() override;
+  void Reset() override;
+  void Wrap() override;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_PUSHBUFFER_BACKEND_H_
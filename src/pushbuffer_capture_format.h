@@ -0,0 +1,55 @@
+#ifndef PBKITPLUSPLUS_SRC_PUSHBUFFER_CAPTURE_FORMAT_H_
+#define PBKITPLUSPLUS_SRC_PUSHBUFFER_CAPTURE_FORMAT_H_
+
+// Describes the binary pushbuffer capture format written by CapturePushbufferBackend. This header has no dependencies
+// on the nxdk so that captures may be parsed on the host.
+//
+// A capture consists of a PushbufferCaptureFileHeader followed by any number of records. Each record is a
+// PushbufferCaptureRecordHeader followed by `num_dwords` little-endian dwords of payload. Readers must skip records with
+// unknown types.
+
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+//! 'PBCP' in little-endian byte order.
+constexpr uint32_t kPushbufferCaptureMagic = 0x50434250;
+constexpr uint32_t kPushbufferCaptureVersion = 1;
+
+enum PushbufferCaptureRecordType : uint32_t {
+  //! The contents of a single pushbuffer block, exactly as submitted.
+  CAPTURE_RECORD_BLOCK = 1,
+  //! The pushbuffer was drained and reset to its head. No payload.
+  CAPTURE_RECORD_FLUSH = 2,
+  //! The pushbuffer was wrapped back to its head without draining. No payload.
+  CAPTURE_RECORD_WRAP = 3,
+  //! All commands for a frame have been submitted. No payload.
+  CAPTURE_RECORD_FRAME_END = 4,
+  //! Attributes the dwords of the next block, starting at the dword offset given by the first payload dword, to a call
+  //! site. The remainder of the payload is a NUL terminated string, padded to a whole number of dwords. An empty string
+  //! indicates that subsequent dwords have no associated call site. Tag records precede the block they refer to.
+  CAPTURE_RECORD_TAG = 5,
+  //! nv2a state may have been modified without going through the pushbuffer (e.g., by pb_fill), so register values
+  //! written before this record may no longer be current. No payload.
+  CAPTURE_RECORD_INVALIDATE = 6,
+  //! Describes a subroutine call in the next block that submits vertex indices (e.g., an IndexBuffer draw), as the
+  //! contents of subroutines are not captured. The payload is the dword offset of the call command within the block
+  //! followed by the number of indices. Call index records precede the block they refer to.
+  CAPTURE_RECORD_CALL_INDICES = 7,
+};
+
+#pragma pack(push, 1)
+struct PushbufferCaptureFileHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct PushbufferCaptureRecordHeader {
+  uint32_t type;
+  uint32_t num_dwords;
+};
+#pragma pack(pop)
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_PUSHBUFFER_CAPTURE_FORMAT_H_
@@ -0,0 +1,57 @@
+#include "pushbuffer_stats.h"
+
+#ifdef PBKPP_INSTRUMENTATION
+
+#ifdef XBOX
+#include <pbkit/pbkit.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "nxdk_ext.h"
+#include "pbkpp_assert.h"
+#include "pushbuffer.h"
+
+// Counts every allocation made through operator new. The array and nothrow forms are implemented in terms of this one,
+// and the default operator delete releases memory with free.
+void *operator new(size_t size) {
+  PBKitPlusPlus::PushbufferStats::RecordHeapAllocation();
+  void *ptr = malloc(size ? size : 1);
+  PBKPP_ASSERT(ptr && "Out of memory.");
+  return ptr;
+}
+
+namespace PBKitPlusPlus {
+
+PushbufferFrameStats PushbufferStats::current_frame_ = {};
+PushbufferFrameStats PushbufferStats::last_frame_ = {};
+
+void PushbufferStats::EndFrame() {
+  last_frame_ = current_frame_;
+  memset(&current_frame_, 0, sizeof(current_frame_));
+}
+
+void PushbufferStats::RecordMethod(uint32_t subchannel, uint32_t command, uint32_t num_dwords) {
+  current_frame_.total_dwords += num_dwords;
+
+  if (subchannel != SUBCH_3D) {
+    current_frame_.other_subchannel_dwords += num_dwords;
+    return;
+  }
+
+  // Strip the non-incrementing flag and any subchannel bits.
+  auto index = (command & 0x1FFC) >> 2;
+  current_frame_.method_dwords[index] += num_dwords;
+}
+
+ScopedCallSiteTag::ScopedCallSiteTag(const char *tag) : previous_(Pushbuffer::GetCallSiteTag()) {
+  Pushbuffer::SetCallSiteTag(tag);
+}
+
+ScopedCallSiteTag::~ScopedCallSiteTag() { Pushbuffer::SetCallSiteTag(previous_); }
+
+}  // namespace PBKitPlusPlus
+
+#endif  // #ifdef PBKPP_INSTRUMENTATION
@@ -0,0 +1,147 @@
+#ifndef PBKITPLUSPLUS_SRC_PUSHBUFFER_STATS_H_
+#define PBKITPLUSPLUS_SRC_PUSHBUFFER_STATS_H_
+
+// Instrumentation is only compiled in when PBKPP_INSTRUMENTATION is defined (see the CMake option of the same name).
+// When disabled, the recording macros expand to nothing and the query API is not declared.
+#ifdef PBKPP_INSTRUMENTATION
+#include <cstdint>
+
+#include "register_shadow.h"
+
+namespace PBKitPlusPlus {
+
+//! Returns the current value of the CPU timestamp counter.
+inline uint64_t ReadTimestampCounter() {
+  uint32_t low;
+  uint32_t high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+//! Counters accumulated over the course of a single frame.
+struct PushbufferFrameStats {
+  //! Number of dwords (including method headers) emitted to each method of the 3D subchannel, indexed by method / 4.
+  uint32_t method_dwords[RegisterShadow::kNumRegisters];
+  //! Number of dwords emitted to subchannels other than the 3D subchannel.
+  uint32_t other_subchannel_dwords;
+  //! Number of pre-encoded dwords pushed via Pushbuffer::PushRaw (e.g., by replaying a CommandList).
+  uint32_t raw_dwords;
+  //! Total number of dwords emitted.
+  uint32_t total_dwords;
+  //! Number of outermost logical Begin/End blocks.
+  uint32_t logical_blocks;
+  //! Number of blocks submitted to the backend.
+  uint32_t backend_blocks;
+  //! Number of calls to Pushbuffer::Flush.
+  uint32_t flushes;
+  //! Cycles spent waiting for the GPU within Pushbuffer::Flush.
+  uint64_t flush_cycles;
+  //! Cycles spent within NV2AState::PBKitBusyWait.
+  uint64_t busy_wait_cycles;
+  //! Cycles spent within NV2AState::FinishDraw waiting for the buffer swap, excluding its PBKitBusyWait.
+  uint64_t finish_draw_cycles;
+  //! Number of heap allocations made anywhere in the program through operator new, plus those made by FrameArena
+  //! directly.
+  uint32_t heap_allocations;
+};
+
+//! Collects per-frame pushbuffer statistics.
+//!
+//! Heap allocations are counted by replacing the global operator new, so enabling instrumentation affects every
+//! allocation made by the program.
+class PushbufferStats {
+ public:
+  //! Returns the counters accumulated since the last call to EndFrame.
+  static const PushbufferFrameStats &GetCurrentFrame() { return current_frame_; }
+
+  //! Returns the counters of the most recently completed frame.
+  static const PushbufferFrameStats &GetLastFrame() { return last_frame_; }
+
+  //! Completes the current frame, making its counters available via GetLastFrame. Called by NV2AState::FinishDraw.
+  static void EndFrame();
+
+  //! Records num_dwords dwords emitted for the given method on the given subchannel.
+  static void RecordMethod(uint32_t subchannel, uint32_t command, uint32_t num_dwords);
+
+  //! Records num_dwords pre-encoded dwords that were pushed without being decoded.
+  static void RecordRawDwords(uint32_t num_dwords) {
+    current_frame_.raw_dwords += num_dwords;
+    current_frame_.total_dwords += num_dwords;
+  }
+
+  static void RecordLogicalBlock() { ++current_frame_.logical_blocks; }
+  static void RecordBackendBlock() { ++current_frame_.backend_blocks; }
+  static void RecordFlush() { ++current_frame_.flushes; }
+  static void RecordHeapAllocation() { ++current_frame_.heap_allocations; }
+
+  static uint64_t &FlushCycles() { return current_frame_.flush_cycles; }
+  static uint64_t &BusyWaitCycles() { return current_frame_.busy_wait_cycles; }
+  static uint64_t &FinishDrawCycles() { return current_frame_.finish_draw_cycles; }
+
+ private:
+  static PushbufferFrameStats current_frame_;
+  static PushbufferFrameStats last_frame_;
+};
+
+//! Attributes pushes made during its lifetime to a call site, restoring the enclosing call site on destruction.
+class ScopedCallSiteTag {
+ public:
+  explicit ScopedCallSiteTag(const char *tag);
+  ~ScopedCallSiteTag();
+
+  ScopedCallSiteTag(const ScopedCallSiteTag &) = delete;
+  ScopedCallSiteTag &operator=(const ScopedCallSiteTag &) = delete;
+
+ private:
+  const char *previous_;
+};
+
+//! Adds the number of cycles between construction and destruction to a counter.
+class ScopedCycleCounter {
+ public:
+  explicit ScopedCycleCounter(uint64_t &counter) : counter_(counter), start_(ReadTimestampCounter()) {}
+  ~ScopedCycleCounter() { counter_ += ReadTimestampCounter() - start_; }
+
+  ScopedCycleCounter(const ScopedCycleCounter &) = delete;
+  ScopedCycleCounter &operator=(const ScopedCycleCounter &) = delete;
+
+ private:
+  uint64_t &counter_;
+  uint64_t start_;
+};
+
+}  // namespace PBKitPlusPlus
+
+#define PBKPP_STATS_RECORD_METHOD(subchannel, command, num_dwords) \
+  PBKitPlusPlus::PushbufferStats::RecordMethod(subchannel, command, num_dwords)
+#define PBKPP_STATS_RECORD_RAW_DWORDS(num_dwords) PBKitPlusPlus::PushbufferStats::RecordRawDwords(num_dwords)
+#define PBKPP_STATS_RECORD(counter) PBKitPlusPlus::PushbufferStats::Record##counter()
+#define PBKPP_STATS_TIME_SCOPE(counter) \
+  PBKitPlusPlus::ScopedCycleCounter pbkpp_scoped_cycle_counter(PBKitPlusPlus::PushbufferStats::counter##Cycles())
+#define PBKPP_STATS_END_FRAME() PBKitPlusPlus::PushbufferStats::EndFrame()
+#define PBKPP_TAG_CALL_SITE(tag) PBKitPlusPlus::ScopedCallSiteTag pbkpp_scoped_call_site_tag(tag)
+
+#else
+
+#define PBKPP_STATS_RECORD_METHOD(subchannel, command, num_dwords) \
+  do {                                                             \
+  } while (false)
+#define PBKPP_STATS_RECORD_RAW_DWORDS(num_dwords) \
+  do {                                            \
+  } while (false)
+#define PBKPP_STATS_RECORD(counter) \
+  do {                              \
+  } while (false)
+#define PBKPP_STATS_TIME_SCOPE(counter) \
+  do {                                  \
+  } while (false)
+#define PBKPP_STATS_END_FRAME() \
+  do {                          \
+  } while (false)
+#define PBKPP_TAG_CALL_SITE(tag) \
+  do {                           \
+  } while (false)
+
+#endif  // #ifdef PBKPP_INSTRUMENTATION
+
+#endif  // PBKITPLUSPLUS_SRC_PUSHBUFFER_STATS_H_
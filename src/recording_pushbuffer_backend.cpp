@@ -0,0 +1,34 @@
+#include "recording_pushbuffer_backend.h"
+
+#include "pbkpp_assert.h"
+
+namespace PBKitPlusPlus {
+
+RecordingPushbufferBackend::RecordingPushbufferBackend() : block_(kMaxBlockDwords) {}
+
+uint32_t *RecordingPushbufferBackend::Begin() { return block_.data(); }
+
+void RecordingPushbufferBackend::End(uint32_t *head) {
+  auto num_dwords = static_cast<uint32_t>(head - block_.data());
+  PBKPP_ASSERT(num_dwords <= kMaxBlockDwords && "Recorded block overflowed its scratch buffer");
+
+  dwords_.insert(dwords_.end(), block_.data(), head);
+  block_sizes_.push_back(num_dwords);
+  ++block_count_;
+}
+
+void RecordingPushbufferBackend::Call(const uint32_t *position, uint32_t num_indices) {
+  calls_.push_back({GetRecordedOffset(position), num_indices});
+}
+
+void RecordingPushbufferBackend::Clear() {
+  dwords_.clear();
+  calls_.clear();
+  block_sizes_.clear();
+  block_count_ = 0;
+  reset_count_ = 0;
+  wrap_count_ = 0;
+  invalidate_count_ = 0;
+}
+
+}  // namespace PBKitPlusPlus
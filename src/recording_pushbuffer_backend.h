@@ -0,0 +1,83 @@
+#ifndef PBKITPLUSPLUS_SRC_RECORDING_PUSHBUFFER_BACKEND_H_
+#define PBKITPLUSPLUS_SRC_RECORDING_PUSHBUFFER_BACKEND_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "pushbuffer_backend.h"
+
+namespace PBKitPlusPlus {
+
+//! Captures the dword stream produced by `Pushbuffer` into host memory instead of submitting it to the GPU.
+//!
+//! This backend does not depend on any hardware and may be used to count or compare the exact commands generated by
+//! higher level calls.
+class RecordingPushbufferBackend : public PushbufferBackend {
+ public:
+  //! The maximum number of dwords that may be written within a single begin/end block.
+  static constexpr uint32_t kMaxBlockDwords = 1024;
+
+  //! A subroutine call command within the recorded dwords.
+  struct RecordedCall {
+    //! Offset of the call command within GetDwords().
+    uint32_t offset;
+    //! Number of vertex indices submitted by the subroutine.
+    uint32_t num_indices;
+  };
+
+  RecordingPushbufferBackend();
+
+  uint32_t *Begin() override;
+  void End(uint32_t *head) override;
+  bool Busy() override { return false; }
+  void Reset() override { ++reset_count_; }
+  void Wrap() override { ++wrap_count_; }
+  void Call(const uint32_t *position, uint32_t num_indices) override;
+  void InvalidateState() override { ++invalidate_count_; }
+
+  //! Returns every dword recorded since construction or the last call to `Clear`.
+  [[nodiscard]] const std::vector<uint32_t> &GetDwords() const { return dwords_; }
+
+  //! Returns the offset within GetDwords() at which the given pointer into the currently open block will be recorded.
+  [[nodiscard]] uint32_t GetRecordedOffset(const uint32_t *head) const {
+    return static_cast<uint32_t>(dwords_.size() + (head - block_.data()));
+  }
+
+  //! Returns the subroutine call commands that have been recorded, in order. As calls are not method headers, parsers of
+  //! GetDwords() must skip them.
+  [[nodiscard]] const std::vector<RecordedCall> &GetCalls() const { return calls_; }
+
+  //! Returns the number of begin/end blocks that have been recorded.
+  [[nodiscard]] uint32_t GetBlockCount() const { return block_count_; }
+
+  //! Returns the number of dwords in each recorded begin/end block.
+  [[nodiscard]] const std::vector<uint32_t> &GetBlockSizes() const { return block_sizes_; }
+
+  //! Returns the number of times the backend has been reset (i.e., the number of `Pushbuffer::Flush` calls).
+  [[nodiscard]] uint32_t GetResetCount() const { return reset_count_; }
+
+  //! Returns the number of times the backend has been wrapped without a reset.
+  [[nodiscard]] uint32_t GetWrapCount() const { return wrap_count_; }
+
+  //! Returns the number of times nv2a state has been invalidated (i.e., the number of
+  //! `Pushbuffer::InvalidateShadowRegisters` calls).
+  [[nodiscard]] uint32_t GetInvalidateCount() const { return invalidate_count_; }
+
+  //! Discards all recorded data.
+  void Clear();
+
+ private:
+  //! Scratch storage for the block currently being written.
+  std::vector<uint32_t> block_;
+  std::vector<uint32_t> dwords_;
+  std::vector<uint32_t> block_sizes_;
+  std::vector<RecordedCall> calls_;
+  uint32_t block_count_ = 0;
+  uint32_t reset_count_ = 0;
+  uint32_t wrap_count_ = 0;
+  uint32_t invalidate_count_ = 0;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_RECORDING_PUSHBUFFER_BACKEND_H_
@@ -0,0 +1,113 @@
+#include "register_shadow.h"
+
+#include <pbkit/nv_regs.h>
+
+#include <cstring>
+
+namespace PBKitPlusPlus {
+
+namespace {
+
+struct MethodRange {
+  uint32_t first;
+  //! One past the last byte offset of the range.
+  uint32_t end;
+};
+
+// Methods that trigger work or whose effect depends on more than the value written.
+constexpr MethodRange kVolatileMethods[] = {
+    // Object binding and other subchannel-level methods.
+    {0x0000, NV097_NO_OPERATION + 4},
+    {NV097_WAIT_FOR_IDLE, NV097_WAIT_FOR_IDLE + 4},
+    {NV097_SET_FLIP_READ, NV097_FLIP_STALL + 4},
+    // Writes advance the program/constant load pointers.
+    {NV097_SET_TRANSFORM_PROGRAM, NV097_SET_TRANSFORM_PROGRAM + 0x80},
+    {NV097_SET_TRANSFORM_CONSTANT, NV097_SET_TRANSFORM_CONSTANT + 0x80},
+    {NV097_SET_TRANSFORM_PROGRAM_LOAD, NV097_SET_TRANSFORM_PROGRAM_LOAD + 4},
+    {NV097_SET_TRANSFORM_CONSTANT_LOAD, NV097_SET_TRANSFORM_CONSTANT_LOAD + 4},
+    // Position writes emit a vertex.
+    {NV097_SET_VERTEX3F, NV097_SET_VERTEX3F + 12},
+    {NV097_SET_VERTEX4F, NV097_SET_VERTEX4F + 16},
+    {NV097_SET_VERTEX4S, NV097_SET_VERTEX4S + 8},
+    {NV097_SET_VERTEX_DATA2F_M, NV097_SET_VERTEX_DATA2F_M + 8},
+    {NV097_SET_VERTEX_DATA2S, NV097_SET_VERTEX_DATA2S + 4},
+    {NV097_SET_VERTEX_DATA4UB, NV097_SET_VERTEX_DATA4UB + 4},
+    {NV097_SET_VERTEX_DATA4S_M, NV097_SET_VERTEX_DATA4S_M + 8},
+    {NV097_SET_VERTEX_DATA4F_M, NV097_SET_VERTEX_DATA4F_M + 16},
+    {NV097_BREAK_VERTEX_BUFFER_CACHE, NV097_BREAK_VERTEX_BUFFER_CACHE + 4},
+    {NV097_CLEAR_REPORT_VALUE, NV097_CLEAR_REPORT_VALUE + 4},
+    {NV097_GET_REPORT, NV097_GET_REPORT + 4},
+    {NV097_SET_BEGIN_END, NV097_SET_BEGIN_END + 4},
+    {NV097_ARRAY_ELEMENT16, NV097_INLINE_ARRAY + 4},
+    {NV097_BACK_END_WRITE_SEMAPHORE_RELEASE, NV097_BACK_END_WRITE_SEMAPHORE_RELEASE + 4},
+    {NV097_CLEAR_SURFACE, NV097_CLEAR_SURFACE + 4},
+};
+
+struct VolatileMask {
+  uint32_t bits[RegisterShadow::kNumRegisters / 32] = {};
+
+  VolatileMask() {
+    for (auto &range : kVolatileMethods) {
+      for (auto method = range.first; method < range.end; method += 4) {
+        auto index = method >> 2;
+        bits[index >> 5] |= 1u << (index & 0x1F);
+      }
+    }
+  }
+};
+
+const VolatileMask kVolatileMask;
+
+inline bool TestBit(const uint32_t *bits, uint32_t index) { return bits[index >> 5] & (1u << (index & 0x1F)); }
+
+}  // namespace
+
+bool RegisterShadow::IsVolatileMethod(uint32_t method) {
+  if (method >= kNumRegisters * 4) {
+    return true;
+  }
+  return TestBit(kVolatileMask.bits, method >> 2);
+}
+
+bool RegisterShadow::IsRedundant(uint32_t method, uint32_t num_values, const uint32_t *values) const {
+  // Non-incrementing writes set bits above the method range and are never considered redundant.
+  auto index = method >> 2;
+  if (method & 0x03 || index + num_values > kNumRegisters) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < num_values; ++i, ++index) {
+    if (!TestBit(valid_, index) || TestBit(kVolatileMask.bits, index) || values_[index] != values[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void RegisterShadow::Update(uint32_t method, uint32_t num_values, const uint32_t *values) {
+  auto index = method >> 2;
+  if (method & 0x03 || index + num_values > kNumRegisters) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < num_values; ++i, ++index) {
+    values_[index] = values[i];
+    valid_[index >> 5] |= 1u << (index & 0x1F);
+  }
+}
+
+void RegisterShadow::Invalidate() { memset(valid_, 0, sizeof(valid_)); }
+
+void RegisterShadow::Invalidate(uint32_t method, uint32_t num_values) {
+  auto index = method >> 2;
+  if (method & 0x03 || index + num_values > kNumRegisters) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < num_values; ++i, ++index) {
+    valid_[index >> 5] &= ~(1u << (index & 0x1F));
+  }
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,41 @@
+#ifndef PBKITPLUSPLUS_SRC_REGISTER_SHADOW_H_
+#define PBKITPLUSPLUS_SRC_REGISTER_SHADOW_H_
+
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+//! Tracks the last value written to each method of the 3D (NV097) subchannel.
+class RegisterShadow {
+ public:
+  //! The number of dword registers addressable by a single subchannel.
+  static constexpr uint32_t kNumRegisters = 0x2000 / 4;
+
+  RegisterShadow() { Invalidate(); }
+
+  //! Returns true if writing to the given method has side effects beyond latching a value (e.g., it triggers a draw,
+  //! advances a load pointer, or releases a semaphore). Such methods are never considered redundant.
+  static bool IsVolatileMethod(uint32_t method);
+
+  //! Returns true if writing num_values incrementing values starting at the given method would leave every affected
+  //! register unchanged.
+  [[nodiscard]] bool IsRedundant(uint32_t method, uint32_t num_values, const uint32_t *values) const;
+
+  //! Records num_values incrementing values written starting at the given method.
+  void Update(uint32_t method, uint32_t num_values, const uint32_t *values);
+
+  //! Forgets all tracked values.
+  void Invalidate();
+
+  //! Forgets the values of num_values incrementing registers starting at the given method.
+  void Invalidate(uint32_t method, uint32_t num_values);
+
+ private:
+  uint32_t values_[kNumRegisters];
+  //! Bitmask of the registers in values_ that hold a known value.
+  uint32_t valid_[kNumRegisters / 32];
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_REGISTER_SHADOW_H_
@@ -2,8 +2,11 @@
 
 #include <pbkit/pbkit.h>
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
+#include "frame_arena.h"
 #include "nv2astate.h"
 #include "pushbuffer.h"
 
@@ -37,6 +40,7 @@ void VertexShaderProgram::LoadShaderProgram(const uint32_t *shader, uint32_t sha
 }
 
 void VertexShaderProgram::Activate() {
+  PBKPP_TAG_CALL_SITE("VertexShaderProgram::Activate");
   OnActivate();
 
   if (shader_) {
@@ -47,6 +51,7 @@ void VertexShaderProgram::Activate() {
 }
 
 void VertexShaderProgram::PrepareDraw() {
+  PBKPP_TAG_CALL_SITE("VertexShaderProgram::PrepareDraw");
   OnLoadConstants();
 
   if (uniform_upload_required_) {
@@ -55,50 +60,50 @@ void VertexShaderProgram::PrepareDraw() {
 }
 
 void VertexShaderProgram::UploadConstants() {
-  auto load_constants = [](int start_offset, const std::map<uint32_t, TransformConstant> &constants) {
-    if (constants.empty()) {
-      return;
-    }
-
-    auto first_index = constants.begin()->first;
-    auto last_index = constants.rbegin()->first;
-    auto num_items = last_index - first_index + 1;
-
-    std::vector<uint32_t> transform_constants(num_items * 4, 0);
-    for (auto &entry : constants) {
-      auto index = (entry.first - first_index) * 4;
-      transform_constants[index++] = entry.second.x;
-      transform_constants[index++] = entry.second.y;
-      transform_constants[index++] = entry.second.z;
-      transform_constants[index] = entry.second.w;
-    }
-
-    Pushbuffer::Begin();
-    Pushbuffer::Push(NV097_SET_TRANSFORM_CONSTANT_LOAD, start_offset + first_index);
-
-    auto *uniforms = reinterpret_cast<DWORD *>(transform_constants.data());
-    uint32_t values_remaining = transform_constants.size();
-    while (values_remaining > 16) {
-      Pushbuffer::PushN(NV097_SET_TRANSFORM_CONSTANT, 16, uniforms);
-      uniforms += 16;
-      values_remaining -= 16;
-    }
+  // Overwriting the lower constants will break the fixed function pipeline, so only the user constants are loaded.
+  if (base_transform_constants_.empty() && uniforms_.empty()) {
+    uniform_upload_required_ = false;
+    return;
+  }
 
-    if (values_remaining) {
-      Pushbuffer::PushN(NV097_SET_TRANSFORM_CONSTANT, values_remaining, uniforms);
+  uint32_t first_index = UINT32_MAX;
+  uint32_t last_index = 0;
+  for (auto *constants : {&base_transform_constants_, &uniforms_}) {
+    if (!constants->empty()) {
+      first_index = std::min(first_index, constants->begin()->first);
+      last_index = std::max(last_index, constants->rbegin()->first);
     }
+  }
+  auto num_items = last_index - first_index + 1;
+
+  // The uniforms overwrite or extend the base values. They are merged in frame scratch memory rather than in a copy of
+  // the base map to avoid heap allocations on every upload.
+  ScopedFrameArenaMarker arena_marker;
+  auto transform_constants = FrameArena::Allocate<TransformConstant>(num_items);
+  memset(transform_constants, 0, num_items * sizeof(*transform_constants));
+  for (auto &entry : base_transform_constants_) {
+    transform_constants[entry.first - first_index] = entry.second;
+  }
+  for (auto &entry : uniforms_) {
+    transform_constants[entry.first - first_index] = entry.second;
+  }
 
-    Pushbuffer::End();
-  };
-
-  // Overwriting the lower constants will break the fixed function pipeline.
-  // load_constants(0, base_96_transform_constants_);
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_TRANSFORM_CONSTANT_LOAD, kShaderUserConstantOffset + first_index);
+
+  auto *uniforms = reinterpret_cast<const DWORD *>(transform_constants);
+  uint32_t values_remaining = num_items * 4;
+  while (values_remaining > 16) {
+    Pushbuffer::PushN(NV097_SET_TRANSFORM_CONSTANT, 16, uniforms);
+    uniforms += 16;
+    values_remaining -= 16;
+  }
 
-  auto merged = base_transform_constants_;
-  for (auto &entry : uniforms_) {
-    merged[entry.first] = entry.second;
+  if (values_remaining) {
+    Pushbuffer::PushN(NV097_SET_TRANSFORM_CONSTANT, values_remaining, uniforms);
   }
-  load_constants(kShaderUserConstantOffset, merged);
+
+  Pushbuffer::End();
 
   uniform_upload_required_ = false;
 }
@@ -0,0 +1,185 @@
+#include "stripifier.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "pbkpp_assert.h"
+#include "vertex_buffer.h"
+
+namespace PBKitPlusPlus {
+
+// Maps each directed edge (a -> b) to the triangle corner at which it begins (triangle * 3 + corner).
+typedef std::vector<std::pair<uint64_t, uint32_t>> EdgeTable;
+
+static inline uint64_t EdgeKey(uint32_t a, uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; }
+
+// Returns the corner at which the directed edge (a -> b) begins in a triangle that is not yet claimed by the current
+// strip or by an emitted strip, or -1 if there is none.
+static int64_t FindCorner(const EdgeTable &edges, uint32_t a, uint32_t b, const std::vector<uint32_t> &marks,
+                          uint32_t emitted_mark, uint32_t trial_mark) {
+  auto key = EdgeKey(a, b);
+  auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, 0u));
+  for (; it != edges.end() && it->first == key; ++it) {
+    auto mark = marks[it->second / 3];
+    if (mark != emitted_mark && mark != trial_mark) {
+      return it->second;
+    }
+  }
+  return -1;
+}
+
+// Grows a strip beginning with the given rotation of the start triangle, following shared edges for as long as the
+// winding of the next triangle matches its position in the strip. Triangles are marked with `trial_mark` as they are
+// added; triangles already marked with `emitted_mark` are never added.
+static void GrowStrip(const uint32_t *indices, const EdgeTable &edges, uint32_t start, uint32_t rotation,
+                      std::vector<uint32_t> &marks, uint32_t emitted_mark, uint32_t trial_mark,
+                      std::vector<uint32_t> &strip, std::vector<uint32_t> &triangles) {
+  auto tri = indices + start * 3;
+  strip = {tri[rotation], tri[(rotation + 1) % 3], tri[(rotation + 2) % 3]};
+  triangles = {start};
+  marks[start] = trial_mark;
+
+  while (true) {
+    auto p = strip[strip.size() - 2];
+    auto q = strip[strip.size() - 1];
+
+    // Even triangles of a strip are wound (p, q, r) and odd triangles (q, p, r).
+    bool even = !(strip.size() & 1);
+    auto corner = even ? FindCorner(edges, p, q, marks, emitted_mark, trial_mark)
+                       : FindCorner(edges, q, p, marks, emitted_mark, trial_mark);
+    if (corner < 0) {
+      break;
+    }
+
+    auto triangle = static_cast<uint32_t>(corner / 3);
+    auto base = triangle * 3;
+    strip.push_back(indices[base + (corner - base + 2) % 3]);
+    triangles.push_back(triangle);
+    marks[triangle] = trial_mark;
+  }
+}
+
+std::vector<uint32_t> Stripifier::Stripify(const uint32_t *indices, uint32_t num_indices, uint32_t num_vertices,
+                                           Stats *stats) {
+  PBKPP_ASSERT(!(num_indices % 3) && "num_indices must be a multiple of 3.");
+
+  // Drop degenerate input triangles, they would otherwise end strips prematurely.
+  std::vector<uint32_t> triangle_list;
+  triangle_list.reserve(num_indices);
+  for (uint32_t i = 0; i < num_indices; i += 3) {
+    auto a = indices[i];
+    auto b = indices[i + 1];
+    auto c = indices[i + 2];
+    PBKPP_ASSERT(a < num_vertices && b < num_vertices && c < num_vertices && "Index exceeds num_vertices.");
+    if (a != b && b != c && a != c) {
+      triangle_list.insert(triangle_list.end(), {a, b, c});
+    }
+  }
+  auto num_triangles = static_cast<uint32_t>(triangle_list.size() / 3);
+
+  EdgeTable edges;
+  edges.reserve(triangle_list.size());
+  for (uint32_t corner = 0; corner < triangle_list.size(); ++corner) {
+    auto next = corner - corner % 3 + (corner + 1) % 3;
+    edges.emplace_back(EdgeKey(triangle_list[corner], triangle_list[next]), corner);
+  }
+  std::sort(edges.begin(), edges.end());
+
+  // Start strips at the triangles with the fewest neighbors, which are the hardest to pick up later and would otherwise
+  // end up as isolated single-triangle strips.
+  std::vector<uint32_t> start_order(num_triangles);
+  {
+    std::vector<uint32_t> neighbors(num_triangles, 0);
+    for (uint32_t corner = 0; corner < triangle_list.size(); ++corner) {
+      auto next = corner - corner % 3 + (corner + 1) % 3;
+      auto key = EdgeKey(triangle_list[next], triangle_list[corner]);
+      auto range = std::equal_range(edges.begin(), edges.end(), std::make_pair(key, 0u),
+                                    [](const auto &a, const auto &b) { return a.first < b.first; });
+      if (range.first != range.second) {
+        ++neighbors[corner / 3];
+      }
+    }
+
+    for (uint32_t t = 0; t < num_triangles; ++t) {
+      start_order[t] = t;
+    }
+    std::stable_sort(start_order.begin(), start_order.end(),
+                     [&neighbors](uint32_t a, uint32_t b) { return neighbors[a] < neighbors[b]; });
+  }
+
+  // Marks are either kEmitted or the ID of the trial strip that most recently claimed the triangle.
+  static constexpr uint32_t kEmitted = 0xFFFFFFFF;
+  std::vector<uint32_t> marks(num_triangles, 0);
+  uint32_t trial = 0;
+
+  std::vector<uint32_t> ret;
+  ret.reserve(triangle_list.size());
+  uint32_t num_strips = 0;
+
+  std::vector<uint32_t> strip;
+  std::vector<uint32_t> strip_triangles;
+  std::vector<uint32_t> best_strip;
+  std::vector<uint32_t> best_triangles;
+  for (auto start : start_order) {
+    if (marks[start] == kEmitted) {
+      continue;
+    }
+
+    // Try each rotation of the starting triangle and keep the longest strip.
+    best_strip.clear();
+    for (uint32_t rotation = 0; rotation < 3; ++rotation) {
+      GrowStrip(triangle_list.data(), edges, start, rotation, marks, kEmitted, ++trial, strip, strip_triangles);
+      if (strip.size() > best_strip.size()) {
+        std::swap(strip, best_strip);
+        std::swap(strip_triangles, best_triangles);
+      }
+    }
+
+    for (auto t : best_triangles) {
+      marks[t] = kEmitted;
+    }
+
+    if (!ret.empty()) {
+      // Join with degenerate triangles. The first triangle of the new strip must land on an even position to keep its
+      // winding, so an extra vertex is repeated if the strip so far has an odd length.
+      if (ret.size() & 1) {
+        ret.push_back(ret.back());
+      }
+      ret.push_back(ret.back());
+      ret.push_back(best_strip.front());
+    }
+    ret.insert(ret.end(), best_strip.begin(), best_strip.end());
+    ++num_strips;
+  }
+
+  if (stats) {
+    stats->triangles = num_triangles;
+    stats->list_vertices = num_triangles * 3;
+    stats->strip_vertices = ret.size();
+    stats->strips = num_strips;
+    stats->degenerate_triangles = ret.size() < 3 ? 0 : ret.size() - 2 - num_triangles;
+  }
+
+  return ret;
+}
+
+IndexedMesh Stripifier::Stripify(const IndexedMesh &mesh, Stats *stats) {
+  PBKPP_ASSERT(mesh.vertices && "IndexedMesh has no vertices.");
+
+  IndexedMesh ret;
+  ret.vertices = mesh.vertices;
+  ret.indices = Stripify(mesh.indices.data(), mesh.indices.size(), mesh.vertices->GetNumVertices(), stats);
+  return ret;
+}
+
+IndexedMesh Stripifier::Stripify(const VertexBuffer &triangles, Stats *stats, uint32_t attribute_mask) {
+  return Stripify(MeshOptimizer::WeldVertices(triangles, attribute_mask), stats);
+}
+
+std::shared_ptr<VertexBuffer> Stripifier::StripifyToVertexBuffer(const VertexBuffer &triangles, Stats *stats,
+                                                                 uint32_t attribute_mask) {
+  auto strip = Stripify(triangles, stats, attribute_mask);
+  return strip.vertices->Gather(strip.indices.data(), strip.indices.size());
+}
+
+}  // namespace PBKitPlusPlus
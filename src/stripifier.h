@@ -0,0 +1,62 @@
+#ifndef PBKITPLUSPLUS_SRC_STRIPIFIER_H_
+#define PBKITPLUSPLUS_SRC_STRIPIFIER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "mesh_optimizer.h"
+
+namespace PBKitPlusPlus {
+
+class VertexBuffer;
+
+//! Offline utilities that convert triangle lists into a single triangle strip for drawing with
+//! NV2AState::PRIMITIVE_TRIANGLE_STRIP, the reverse of VertexBuffer::ConvertFromTriangleStripToTriangles.
+//!
+//! Triangles are greedily chained across shared edges, preserving winding. Since the nv2a has no primitive restart
+//! index, separate strips are joined with degenerate (zero area) triangles, which are rejected by the hardware before
+//! rasterization.
+//!
+//! E.g., to draw a ModelBuilder mesh as an indexed strip:
+//!   Stripifier::Stats stats;
+//!   auto strip = Stripifier::Stripify(*triangles, &stats, NV2AState::kDefaultVertexFields);
+//!   host.SetVertexBuffer(strip.vertices);
+//!   host.DrawElements(*strip.CreateIndexBuffer(), NV2AState::kDefaultVertexFields, NV2AState::PRIMITIVE_TRIANGLE_STRIP);
+class Stripifier {
+ public:
+  //! Describes the effect of stripification.
+  struct Stats {
+    //! Number of non-degenerate triangles in the input.
+    uint32_t triangles;
+    //! Number of vertices that would be submitted to draw the input as a triangle list.
+    uint32_t list_vertices;
+    //! Number of vertices submitted to draw the resulting strip.
+    uint32_t strip_vertices;
+    //! Number of strips that were joined together.
+    uint32_t strips;
+    //! Number of zero area triangles added to join strips.
+    uint32_t degenerate_triangles;
+  };
+
+  //! Converts triangle list indices into triangle strip indices. `num_vertices` must be greater than every index.
+  //! Input triangles that reference the same vertex more than once are discarded.
+  static std::vector<uint32_t> Stripify(const uint32_t *indices, uint32_t num_indices, uint32_t num_vertices,
+                                        Stats *stats = nullptr);
+
+  //! Converts an indexed triangle list into an indexed triangle strip sharing the same vertices.
+  static IndexedMesh Stripify(const IndexedMesh &mesh, Stats *stats = nullptr);
+
+  //! Welds the vertices of an unindexed triangle list (see MeshOptimizer::WeldVertices) and converts it into an indexed
+  //! triangle strip, suitable for NV2AState::DrawElements.
+  static IndexedMesh Stripify(const VertexBuffer &triangles, Stats *stats = nullptr,
+                              uint32_t attribute_mask = 0xFFFFFFFF);
+
+  //! As Stripify, but expands the result into an unindexed VertexBuffer suitable for NV2AState::DrawArrays.
+  static std::shared_ptr<VertexBuffer> StripifyToVertexBuffer(const VertexBuffer &triangles, Stats *stats = nullptr,
+                                                              uint32_t attribute_mask = 0xFFFFFFFF);
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_STRIPIFIER_H_
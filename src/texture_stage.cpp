@@ -25,6 +25,7 @@ bool TextureStage::RequiresColorspaceConversion() const {
 }
 
 void TextureStage::Commit(uint32_t memory_dma_offset, uint32_t palette_dma_offset) const {
+  PBKPP_TAG_CALL_SITE("TextureStage::Commit");
   if (!enabled_) {
     Pushbuffer::Begin();
     // NV097_SET_TEXTURE_CONTROL0
@@ -36,21 +37,13 @@ void TextureStage::Commit(uint32_t memory_dma_offset, uint32_t palette_dma_offse
   PBKPP_ASSERT(format_.xbox_bpp &&
                "No texture format specified. This will cause an invalid pgraph state exception and a crash.");
 
+  // Registers are written in ascending order so that they may be coalesced into a single method header.
   Pushbuffer::Begin();
   uint32_t offset = reinterpret_cast<uint32_t>(memory_dma_offset) + texture_memory_offset_;
   uint32_t texture_addr = offset & 0x03ffffff;
   // NV097_SET_TEXTURE_OFFSET
   Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_OFFSET(stage_), texture_addr);
 
-  // NV097_SET_TEXTURE_CONTROL0
-  Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_ENABLE(stage_),
-                   NV097_SET_TEXTURE_CONTROL0_ENABLE |
-                       MASK(NV097_SET_TEXTURE_CONTROL0_ANISOTROPY, anisotropy_power_of_two_) |
-                       MASK(NV097_SET_TEXTURE_CONTROL0_ALPHA_KILL_ENABLE, alpha_kill_enable_) |
-                       MASK(NV097_SET_TEXTURE_CONTROL0_MIN_LOD_CLAMP, lod_min_) |
-                       MASK(NV097_SET_TEXTURE_CONTROL0_MAX_LOD_CLAMP, lod_max_) |
-                       MASK(NV097_SET_TEXTURE_CONTROL0_COLOR_KEY_MODE, color_key_mode_));
-
   uint32_t dimensionality = GetDimensionality();
 
   uint32_t size_u = bsf((int)size_u_);
@@ -76,14 +69,6 @@ void TextureStage::Commit(uint32_t memory_dma_offset, uint32_t palette_dma_offse
   // NV097_SET_TEXTURE_FORMAT
   Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_FORMAT(stage_), format);
 
-  uint32_t pitch_param = (format_.xbox_bpp * width_ / 8) << 16;
-  // NV097_SET_TEXTURE_CONTROL1
-  Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_NPOT_PITCH(stage_), pitch_param);
-
-  uint32_t size_param = (width_ << 16) | (height_ & 0xFFFF);
-  // NV097_SET_TEXTURE_IMAGE_RECT
-  Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_NPOT_SIZE(stage_), size_param);
-
   // NV097_SET_TEXTURE_ADDRESS
   uint32_t texture_address = MASK(NV097_SET_TEXTURE_ADDRESS_U, wrap_modes_[0]) |
                              MASK(NV097_SET_TEXTURE_ADDRESS_CYLINDERWRAP_U, cylinder_wrap_[0]) |
@@ -94,9 +79,26 @@ void TextureStage::Commit(uint32_t memory_dma_offset, uint32_t palette_dma_offse
                              MASK(NV097_SET_TEXTURE_ADDRESS_CYLINDERWRAP_Q, cylinder_wrap_[3]);
   Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_WRAP(stage_), texture_address);
 
+  // NV097_SET_TEXTURE_CONTROL0
+  Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_ENABLE(stage_),
+                   NV097_SET_TEXTURE_CONTROL0_ENABLE |
+                       MASK(NV097_SET_TEXTURE_CONTROL0_ANISOTROPY, anisotropy_power_of_two_) |
+                       MASK(NV097_SET_TEXTURE_CONTROL0_ALPHA_KILL_ENABLE, alpha_kill_enable_) |
+                       MASK(NV097_SET_TEXTURE_CONTROL0_MIN_LOD_CLAMP, lod_min_) |
+                       MASK(NV097_SET_TEXTURE_CONTROL0_MAX_LOD_CLAMP, lod_max_) |
+                       MASK(NV097_SET_TEXTURE_CONTROL0_COLOR_KEY_MODE, color_key_mode_));
+
+  uint32_t pitch_param = (format_.xbox_bpp * width_ / 8) << 16;
+  // NV097_SET_TEXTURE_CONTROL1
+  Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_NPOT_PITCH(stage_), pitch_param);
+
   // NV097_SET_TEXTURE_FILTER
   Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_FILTER(stage_), texture_filter_);
 
+  uint32_t size_param = (width_ << 16) | (height_ & 0xFFFF);
+  // NV097_SET_TEXTURE_IMAGE_RECT
+  Pushbuffer::Push(NV20_TCL_PRIMITIVE_3D_TX_NPOT_SIZE(stage_), size_param);
+
   uint32_t palette_config = 0;
   if (format_.xbox_format == NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8) {
     PBKPP_ASSERT(palette_length_ <= 3 && "Invalid attempt to use paletted format without setting palette.");
@@ -416,8 +418,8 @@ int TextureStage::SetTexture(const SDL_Surface *surface, uint8_t *memory_base) c
       PBKPP_ASSERT(converted && "Swizzle source buffer not populated");
       SetRawTexture((const uint8_t *)converted, swizzle_w, swizzle_h, swizzle_depth, swizzle_pitch, swizzle_bpp,
                     format_.xbox_swizzled, memory_base);
-      delete[] converted;
     }
+    delete[] converted;
 
     return 0;
   }
@@ -1,11 +1,17 @@
 #include "vertex_buffer.h"
 
+#ifdef XBOX
 #include <pbkit/pbkit.h>
+#endif
 #include <xboxkrnl/xboxkrnl.h>
 
+#include <cstddef>
+#include <cstdlib>
 #include <memory>
 
+#include "nxdk_ext.h"
 #include "pbkpp_assert.h"
+#include "vertex_memory_pool.h"
 
 namespace PBKitPlusPlus {
 
@@ -18,38 +24,212 @@ void Vertex::Translate(float x, float y, float z, float w) {
 
 VertexBuffer::VertexBuffer(uint32_t num_vertices) : num_vertices_(num_vertices) {
   uint32_t buffer_size = sizeof(Vertex) * num_vertices;
-  normalized_vertex_buffer_ = static_cast<Vertex *>(
-      MmAllocateContiguousMemoryEx(buffer_size, 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE));
+  AllocateStorage(buffer_size);
+  MarkDirty(0, num_vertices);
 }
 
-VertexBuffer::~VertexBuffer() {
-  if (linear_vertex_buffer_) {
-    MmFreeContiguousMemory(linear_vertex_buffer_);
+VertexBuffer::VertexBuffer(uint32_t num_vertices, const VertexFormat &format, Layout layout)
+    : num_vertices_(num_vertices), compact_(true), layout_(layout), source_format_(format), format_(format) {
+  PBKPP_ASSERT(format.GetStride() && "VertexFormat must contain at least one attribute.");
+
+  if (layout == LAYOUT_SEPARATE) {
+    // Each attribute array follows the previous one. Attribute sizes are dword multiples, so every array starts on a
+    // dword boundary.
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < VertexFormat::kNumAttributes; ++i) {
+      auto &attribute = format.GetAttribute(i);
+      if (!attribute.count) {
+        continue;
+      }
+      format_.SetFixedAttribute(i, attribute.count, attribute.type, offset, attribute.size);
+      offset += attribute.size * num_vertices;
+    }
   }
-  if (normalized_vertex_buffer_) {
-    MmFreeContiguousMemory(normalized_vertex_buffer_);
+
+  uint32_t buffer_size = format.GetStride() * num_vertices;
+  AllocateStorage(buffer_size);
+  MarkDirty(0, num_vertices);
+}
+
+void VertexBuffer::AllocateStorage(uint32_t buffer_size) {
+  if (!buffer_size) {
+    return;
   }
+
+  normalized_vertex_buffer_ = static_cast<Vertex *>(VertexMemoryPool::Allocate(buffer_size));
+  PBKPP_ASSERT(normalized_vertex_buffer_ && "Failed to allocate vertex buffer.");
+  staging_vertex_buffer_ = static_cast<Vertex *>(calloc(1, buffer_size));
+  PBKPP_ASSERT(staging_vertex_buffer_ && "Failed to allocate vertex staging buffer.");
 }
 
-Vertex *VertexBuffer::Lock() {
-  cache_valid_ = false;
-  return normalized_vertex_buffer_;
+VertexBuffer::~VertexBuffer() {
+  VertexMemoryPool::Free(linear_vertex_buffer_);
+  VertexMemoryPool::Free(normalized_vertex_buffer_);
+  free(staging_vertex_buffer_);
+}
+
+Vertex *VertexBuffer::Lock(uint32_t first, uint32_t count) {
+  PBKPP_ASSERT(!compact_ && "Compact vertex buffers must be accessed via LockData.");
+  MarkDirty(first, count);
+  return staging_vertex_buffer_ + first;
+}
+
+const Vertex *VertexBuffer::LockReadOnly() const {
+  PBKPP_ASSERT(!compact_ && "Compact vertex buffers must be accessed via LockDataReadOnly.");
+  return staging_vertex_buffer_;
+}
+
+uint8_t *VertexBuffer::LockData(uint32_t first, uint32_t count) {
+  MarkDirty(first, count);
+  return reinterpret_cast<uint8_t *>(staging_vertex_buffer_);
+}
+
+const uint8_t *VertexBuffer::LockDataReadOnly() const {
+  return reinterpret_cast<const uint8_t *>(staging_vertex_buffer_);
+}
+
+uint8_t *VertexBuffer::LockAttribute(uint32_t attribute_index, uint32_t first, uint32_t count) {
+  PBKPP_ASSERT(compact_ && "LockAttribute is only valid for compact vertex buffers.");
+  PBKPP_ASSERT(format_.HasAttribute(attribute_index) && "Attribute is not present in the vertex format.");
+  auto &attribute = format_.GetAttribute(attribute_index);
+  return LockData(first, count) + attribute.offset + first * attribute.stride;
 }
 
 void VertexBuffer::Unlock() {}
 
+void VertexBuffer::MarkDirty(uint32_t first, uint32_t count) {
+  PBKPP_ASSERT(first + count <= num_vertices_ && "Vertex range exceeds the size of the buffer.");
+  ++generation_;
+  gpu_dirty_.Add(first, count);
+  cache_dirty_.Add(first, count);
+  linear_dirty_.Add(first, count);
+}
+
+void VertexBuffer::SetCacheValid(bool valid) {
+  if (valid) {
+    cache_dirty_.Clear();
+  } else {
+    cache_dirty_.Add(0, num_vertices_);
+  }
+}
+
+VertexFormat VertexBuffer::GetFormat() const {
+  if (compact_) {
+    return format_;
+  }
+
+  VertexFormat ret;
+  auto set = [&ret](uint32_t index, uint32_t count, uint32_t offset) {
+    ret.SetFixedAttribute(index, count, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F, offset, sizeof(Vertex));
+  };
+  set(NV2A_VERTEX_ATTR_POSITION, position_count_, offsetof(Vertex, pos));
+  set(NV2A_VERTEX_ATTR_WEIGHT, weight_count_, offsetof(Vertex, weight));
+  set(NV2A_VERTEX_ATTR_NORMAL, normal_count_, offsetof(Vertex, normal));
+  set(NV2A_VERTEX_ATTR_DIFFUSE, diffuse_count_, offsetof(Vertex, diffuse));
+  set(NV2A_VERTEX_ATTR_SPECULAR, specular_count_, offsetof(Vertex, specular));
+  set(NV2A_VERTEX_ATTR_FOG_COORD, fog_coord_count_, offsetof(Vertex, fog_coord));
+  set(NV2A_VERTEX_ATTR_POINT_SIZE, point_size_count_, offsetof(Vertex, point_size));
+  set(NV2A_VERTEX_ATTR_BACK_DIFFUSE, back_diffuse_count_, offsetof(Vertex, back_diffuse));
+  set(NV2A_VERTEX_ATTR_BACK_SPECULAR, back_specular_count_, offsetof(Vertex, back_specular));
+  set(NV2A_VERTEX_ATTR_TEXTURE0, tex0_coord_count_, offsetof(Vertex, texcoord0));
+  set(NV2A_VERTEX_ATTR_TEXTURE1, tex1_coord_count_, offsetof(Vertex, texcoord1));
+  set(NV2A_VERTEX_ATTR_TEXTURE2, tex2_coord_count_, offsetof(Vertex, texcoord2));
+  set(NV2A_VERTEX_ATTR_TEXTURE3, tex3_coord_count_, offsetof(Vertex, texcoord3));
+  ret.stride_ = sizeof(Vertex);
+  return ret;
+}
+
+void VertexBuffer::SetAttribute(uint32_t vertex_index, uint32_t attribute_index, const float *values) {
+  PBKPP_ASSERT(compact_ && "SetAttribute is only valid for compact vertex buffers.");
+  PBKPP_ASSERT(vertex_index < num_vertices_ && "Invalid vertex_index.");
+  PBKPP_ASSERT(format_.HasAttribute(attribute_index) && "Attribute is not present in the vertex format.");
+
+  auto &attribute = format_.GetAttribute(attribute_index);
+
+  MarkDirty(vertex_index, 1);
+  auto dst = reinterpret_cast<uint8_t *>(staging_vertex_buffer_) + attribute.offset + vertex_index * attribute.stride;
+  VertexFormat::PackAttribute(attribute, values, dst);
+}
+
+void VertexBuffer::Commit() {
+  if (gpu_dirty_.IsEmpty()) {
+    return;
+  }
+
+  CopyFromStaging(normalized_vertex_buffer_, gpu_dirty_.begin, gpu_dirty_.end - gpu_dirty_.begin);
+  gpu_dirty_.Clear();
+
+  FlushWriteCombinedStores();
+}
+
 void VertexBuffer::Linearize(float texture_width, float texture_height) {
-  uint32_t buffer_size = sizeof(Vertex) * num_vertices_;
-  if (!linear_vertex_buffer_) {
-    linear_vertex_buffer_ = static_cast<Vertex *>(
-        MmAllocateContiguousMemoryEx(buffer_size, 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE));
+  if (!linear_vertex_buffer_ && num_vertices_) {
+    linear_vertex_buffer_ = static_cast<Vertex *>(VertexMemoryPool::Allocate(GetStride() * num_vertices_));
+    PBKPP_ASSERT(linear_vertex_buffer_ && "Failed to allocate linear vertex buffer.");
+    linear_dirty_.Add(0, num_vertices_);
+  }
+
+  if (texture_width != linear_texture_width_ || texture_height != linear_texture_height_) {
+    linear_texture_width_ = texture_width;
+    linear_texture_height_ = texture_height;
+    linear_dirty_.Add(0, num_vertices_);
+  }
+
+  if (linear_dirty_.IsEmpty()) {
+    return;
   }
 
-  memcpy(linear_vertex_buffer_, normalized_vertex_buffer_, buffer_size);
+  auto first = linear_dirty_.begin;
+  auto count = linear_dirty_.end - linear_dirty_.begin;
+  linear_dirty_.Clear();
+  CopyFromStaging(linear_vertex_buffer_, first, count);
 
-  for (int i = 0; i < num_vertices_; i++) {
-    linear_vertex_buffer_[i].texcoord0[0] *= static_cast<float>(texture_width);
-    linear_vertex_buffer_[i].texcoord0[1] *= static_cast<float>(texture_height);
+  // The linear data may be the source of the next draw, so the HW cache must be told about the change.
+  cache_dirty_.Add(first, count);
+
+  // Scaled texcoords are calculated from the staging copy so that the write combined linear data is never read.
+  if (!compact_) {
+    for (uint32_t i = first; i < first + count; ++i) {
+      linear_vertex_buffer_[i].texcoord0[0] = staging_vertex_buffer_[i].texcoord0[0] * texture_width;
+      linear_vertex_buffer_[i].texcoord0[1] = staging_vertex_buffer_[i].texcoord0[1] * texture_height;
+    }
+  } else {
+    auto &texcoord = format_.GetAttribute(NV2A_VERTEX_ATTR_TEXTURE0);
+    if (texcoord.count && texcoord.type == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F) {
+      auto offset = texcoord.offset + first * texcoord.stride;
+      auto src = reinterpret_cast<const uint8_t *>(staging_vertex_buffer_) + offset;
+      auto dst = reinterpret_cast<uint8_t *>(linear_vertex_buffer_) + offset;
+      for (uint32_t i = 0; i < count; ++i, src += texcoord.stride, dst += texcoord.stride) {
+        auto src_uv = reinterpret_cast<const float *>(src);
+        auto dst_uv = reinterpret_cast<float *>(dst);
+        dst_uv[0] = src_uv[0] * texture_width;
+        if (texcoord.count > 1) {
+          dst_uv[1] = src_uv[1] * texture_height;
+        }
+      }
+    }
+  }
+
+  FlushWriteCombinedStores();
+}
+
+void VertexBuffer::CopyFromStaging(Vertex *gpu_buffer, uint32_t first, uint32_t count) const {
+  auto src = reinterpret_cast<const uint8_t *>(staging_vertex_buffer_);
+  auto dst = reinterpret_cast<uint8_t *>(gpu_buffer);
+
+  if (layout_ != LAYOUT_SEPARATE) {
+    auto stride = GetStride();
+    memcpy(dst + first * stride, src + first * stride, count * stride);
+    return;
+  }
+
+  for (uint32_t i = 0; i < VertexFormat::kNumAttributes; ++i) {
+    auto &attribute = format_.GetAttribute(i);
+    if (!attribute.count) {
+      continue;
+    }
+    auto offset = attribute.offset + first * attribute.stride;
+    memcpy(dst + offset, src + offset, count * attribute.stride);
   }
 }
 
@@ -83,7 +263,7 @@ void VertexBuffer::DefineTriangleCCW(uint32_t start_index, const float *one, con
                                      uint32_t normal_one_size, uint32_t normal_two_size, uint32_t normal_three_size) {
   DefineTriangle(start_index, one, two, three, normal_one, normal_two, normal_three, diffuse_one, diffuse_two,
                  diffuse_three, one_size, two_size, three_size, normal_one_size, normal_two_size, normal_three_size);
-  Vertex *vb = normalized_vertex_buffer_ + (start_index * 3);
+  Vertex *vb = staging_vertex_buffer_ + (start_index * 3);
   Vertex temp = vb[2];
   vb[2] = vb[1];
   vb[1] = temp;
@@ -117,12 +297,13 @@ void VertexBuffer::DefineTriangle(uint32_t start_index, const float *one, const
                                   const Color &diffuse_one, const Color &diffuse_two, const Color &diffuse_three,
                                   uint32_t one_size, uint32_t two_size, uint32_t three_size, uint32_t normal_one_size,
                                   uint32_t normal_two_size, uint32_t normal_three_size) {
+  PBKPP_ASSERT(!compact_ && "DefineTriangle is not supported for compact vertex buffers.");
   PBKPP_ASSERT(start_index <= (num_vertices_ - 3) &&
                "Invalid start_index, need at least 3 vertices to define triangle.");
 
-  cache_valid_ = false;
+  MarkDirty(start_index * 3, 3);
 
-  Vertex *vb = normalized_vertex_buffer_ + (start_index * 3);
+  Vertex *vb = staging_vertex_buffer_ + (start_index * 3);
 
   auto set = [vb](int index, const float *pos, const float *normal, const Color &diffuse, uint32_t pos_size,
                   uint32_t normal_size) {
@@ -166,11 +347,12 @@ void VertexBuffer::DefineBiTriCCW(uint32_t start_index, float left, float top, f
                                   float ll_z, float lr_z, float ur_z, const Color &ul_diffuse, const Color &ll_diffuse,
                                   const Color &lr_diffuse, const Color &ur_diffuse, const Color &ul_specular,
                                   const Color &ll_specular, const Color &lr_specular, const Color &ur_specular) {
+  PBKPP_ASSERT(!compact_ && "DefineBiTri is not supported for compact vertex buffers.");
   PBKPP_ASSERT(start_index <= (num_vertices_ - 6) && "Invalid start_index, need at least 6 vertices to define quad.");
 
-  cache_valid_ = false;
+  MarkDirty(start_index * 6, 6);
 
-  Vertex *vb = normalized_vertex_buffer_ + (start_index * 6);
+  Vertex *vb = staging_vertex_buffer_ + (start_index * 6);
 
   auto set = [vb](int index, float x, float y, float z, float u, float v, const Color &diffuse, const Color &specular) {
     vb[index].pos[0] = x;
@@ -250,7 +432,7 @@ void VertexBuffer::DefineBiTri(uint32_t start_index, float left, float top, floa
                                const Color &ll_specular, const Color &lr_specular, const Color &ur_specular) {
   DefineBiTriCCW(start_index, left, top, right, bottom, ul_z, ll_z, lr_z, ur_z, ul_diffuse, ll_diffuse, lr_diffuse,
                  ur_diffuse, ul_specular, ll_specular, lr_specular, ur_specular);
-  Vertex *vb = normalized_vertex_buffer_ + (start_index * 6);
+  Vertex *vb = staging_vertex_buffer_ + (start_index * 6);
   Vertex temp = vb[2];
   vb[2] = vb[1];
   vb[1] = temp;
@@ -265,11 +447,12 @@ void VertexBuffer::DefineBiTri(uint32_t start_index, const vector_t ul, const ve
                                const Color &lr_diffuse, const Color &ur_diffuse, const Color &ul_specular,
                                const Color &ll_specular, const Color &lr_specular, const Color &ur_specular,
                                uint32_t ul_size, uint32_t ll_size, uint32_t lr_size, uint32_t ur_size) {
+  PBKPP_ASSERT(!compact_ && "DefineBiTri is not supported for compact vertex buffers.");
   PBKPP_ASSERT(start_index <= (num_vertices_ - 6) && "Invalid start_index, need at least 6 vertices to define quad.");
 
-  cache_valid_ = false;
+  MarkDirty(start_index * 6, 6);
 
-  Vertex *vb = normalized_vertex_buffer_ + (start_index * 6);
+  Vertex *vb = staging_vertex_buffer_ + (start_index * 6);
 
   auto set = [vb](int index, const float *pos, uint32_t pos_size, float u, float v, const Color &diffuse,
                   const Color &specular) {
@@ -320,59 +503,118 @@ void VertexBuffer::DefineBiTri(uint32_t start_index, const vector_t ul, const ve
 }
 
 void VertexBuffer::SetDiffuse(uint32_t vertex_index, const Color &color) {
-  cache_valid_ = false;
+  PBKPP_ASSERT(!compact_ && "SetDiffuse is not supported for compact vertex buffers.");
   PBKPP_ASSERT(vertex_index < num_vertices_ && "Invalid vertex_index.");
-  normalized_vertex_buffer_[vertex_index].diffuse[0] = color.r;
-  normalized_vertex_buffer_[vertex_index].diffuse[1] = color.g;
-  normalized_vertex_buffer_[vertex_index].diffuse[2] = color.b;
-  normalized_vertex_buffer_[vertex_index].diffuse[3] = color.a;
+  MarkDirty(vertex_index, 1);
+  staging_vertex_buffer_[vertex_index].diffuse[0] = color.r;
+  staging_vertex_buffer_[vertex_index].diffuse[1] = color.g;
+  staging_vertex_buffer_[vertex_index].diffuse[2] = color.b;
+  staging_vertex_buffer_[vertex_index].diffuse[3] = color.a;
 }
 
 void VertexBuffer::SetSpecular(uint32_t vertex_index, const Color &color) {
-  cache_valid_ = false;
+  PBKPP_ASSERT(!compact_ && "SetSpecular is not supported for compact vertex buffers.");
   PBKPP_ASSERT(vertex_index < num_vertices_ && "Invalid vertex_index.");
-  normalized_vertex_buffer_[vertex_index].specular[0] = color.r;
-  normalized_vertex_buffer_[vertex_index].specular[1] = color.g;
-  normalized_vertex_buffer_[vertex_index].specular[2] = color.b;
-  normalized_vertex_buffer_[vertex_index].specular[3] = color.a;
+  MarkDirty(vertex_index, 1);
+  staging_vertex_buffer_[vertex_index].specular[0] = color.r;
+  staging_vertex_buffer_[vertex_index].specular[1] = color.g;
+  staging_vertex_buffer_[vertex_index].specular[2] = color.b;
+  staging_vertex_buffer_[vertex_index].specular[3] = color.a;
 }
 
 std::shared_ptr<VertexBuffer> VertexBuffer::ConvertFromTriangleStripToTriangles() const {
   auto num_triangles = num_vertices_ - 2;
-  auto ret = std::make_shared<VertexBuffer>(num_triangles * 3);
-
-  auto src = normalized_vertex_buffer_;
-  auto dst = ret->normalized_vertex_buffer_;
+  std::vector<uint32_t> indices;
+  indices.reserve(num_triangles * 3);
+  indices.insert(indices.end(), {0, 1, 2});
 
-  memcpy(dst, src, sizeof(*dst) * 3);
-  dst += 3;
-  src += 2;
-
-  auto copy_triangle = [&src, &dst](bool is_odd) {
-    if (is_odd) {
-      memcpy(dst++, src, sizeof(*dst));
-      memcpy(dst++, src - 1, sizeof(*dst));
-      ++src;
-      memcpy(dst++, src, sizeof(*dst));
+  for (uint32_t i = 1; i < num_triangles; ++i) {
+    if (i & 0x01) {
+      indices.insert(indices.end(), {i + 1, i, i + 2});
     } else {
-      memcpy(dst++, src - 1, sizeof(*dst));
-      memcpy(dst++, src, sizeof(*dst));
-      ++src;
-      memcpy(dst++, src, sizeof(*dst));
+      indices.insert(indices.end(), {i, i + 1, i + 2});
     }
-  };
+  }
+
+  return Gather(indices.data(), static_cast<uint32_t>(indices.size()));
+}
 
-  for (auto i = 1; i < num_triangles; ++i) {
-    copy_triangle(i & 0x01);
+std::shared_ptr<VertexBuffer> VertexBuffer::Gather(const uint32_t *indices, uint32_t count) const {
+  auto ret = compact_ ? std::make_shared<VertexBuffer>(count, source_format_, layout_)
+                      : std::make_shared<VertexBuffer>(count);
+  if (!compact_) {
+    ret->position_count_ = position_count_;
+    ret->weight_count_ = weight_count_;
+    ret->normal_count_ = normal_count_;
+    ret->diffuse_count_ = diffuse_count_;
+    ret->specular_count_ = specular_count_;
+    ret->fog_coord_count_ = fog_coord_count_;
+    ret->point_size_count_ = point_size_count_;
+    ret->back_diffuse_count_ = back_diffuse_count_;
+    ret->back_specular_count_ = back_specular_count_;
+    ret->tex0_coord_count_ = tex0_coord_count_;
+    ret->tex1_coord_count_ = tex1_coord_count_;
+    ret->tex2_coord_count_ = tex2_coord_count_;
+    ret->tex3_coord_count_ = tex3_coord_count_;
   }
 
+  auto src = reinterpret_cast<const uint8_t *>(staging_vertex_buffer_);
+  auto dst = reinterpret_cast<uint8_t *>(ret->staging_vertex_buffer_);
+
+  if (layout_ != LAYOUT_SEPARATE) {
+    auto stride = GetStride();
+    for (uint32_t i = 0; i < count; ++i, dst += stride) {
+      PBKPP_ASSERT(indices[i] < num_vertices_ && "Invalid vertex index.");
+      memcpy(dst, src + indices[i] * stride, stride);
+    }
+    return ret;
+  }
+
+  // The attribute arrays of the two buffers begin at different offsets since they hold different vertex counts.
+  for (uint32_t a = 0; a < VertexFormat::kNumAttributes; ++a) {
+    auto &src_attribute = format_.GetAttribute(a);
+    auto &dst_attribute = ret->format_.GetAttribute(a);
+    if (!src_attribute.count) {
+      continue;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      PBKPP_ASSERT(indices[i] < num_vertices_ && "Invalid vertex index.");
+      memcpy(dst + dst_attribute.offset + i * dst_attribute.stride,
+             src + src_attribute.offset + indices[i] * src_attribute.stride, src_attribute.size);
+    }
+  }
   return ret;
 }
 
+void VertexBuffer::ReadAttribute(uint32_t vertex_index, uint32_t attribute_index, void *dst) const {
+  PBKPP_ASSERT(vertex_index < num_vertices_ && "Invalid vertex_index.");
+  auto format = compact_ ? format_ : GetFormat();
+  auto &attribute = format.GetAttribute(attribute_index);
+  auto src = reinterpret_cast<const uint8_t *>(staging_vertex_buffer_);
+  memcpy(dst, src + attribute.offset + vertex_index * attribute.stride, attribute.size);
+}
+
 void VertexBuffer::Translate(float x, float y, float z, float w) {
-  auto vertex = Lock();
-  for (auto i = 0; i < num_vertices_; ++i, ++vertex) {
-    vertex->Translate(x, y, z, w);
+  if (!compact_) {
+    auto vertex = Lock();
+    for (auto i = 0; i < num_vertices_; ++i, ++vertex) {
+      vertex->Translate(x, y, z, w);
+    }
+    Unlock();
+    return;
+  }
+
+  auto &position = format_.GetAttribute(NV2A_VERTEX_ATTR_POSITION);
+  PBKPP_ASSERT(position.count && position.type == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F &&
+               "Translate requires a float position attribute.");
+
+  const float delta[4] = {x, y, z, w};
+  auto vertex = LockAttribute(NV2A_VERTEX_ATTR_POSITION);
+  for (uint32_t i = 0; i < num_vertices_; ++i, vertex += position.stride) {
+    auto pos = reinterpret_cast<float *>(vertex);
+    for (uint32_t c = 0; c < position.count; ++c) {
+      pos[c] += delta[c];
+    }
   }
   Unlock();
 }
@@ -2,8 +2,11 @@
 #define PBKITPLUSPLUS__VERTEX_BUFFER_H_
 
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <vector>
 
+#include "vertex_format.h"
 #include "xbox_math_types.h"
 
 using namespace XboxMath;
@@ -226,23 +229,106 @@ struct Color {
 
 class NV2AState;
 
+//! Holds vertex data in contiguous memory for use by NV2AState draw calls.
+//!
+//! By default each vertex is a full Vertex struct, which allows every attribute to be set via Lock() and the Define*
+//! helpers at the cost of 208 bytes per vertex. Buffers constructed with a VertexFormat are "compact": they store only
+//! the attributes in the format and are accessed via LockData(), LockAttribute() and SetAttribute().
+//!
+//! Writes are tracked as a range of dirty vertices and a generation counter that advances on every modification.
+//! Locking only the vertices that will be written (e.g., Lock(first, count)) allows Linearize to update just those
+//! vertices, and read-only locks (e.g., LockReadOnly()) leave the buffer clean so that draws do not need to break the
+//! hardware vertex cache.
+//!
+//! Locks and the Define* helpers operate on a CPU cached staging copy of the vertex data, as reads from the write
+//! combined memory that the GPU fetches from are extremely slow. Commit streams the dirty vertices into GPU memory; it
+//! is called automatically by NV2AState draws.
 class VertexBuffer {
  public:
+  //! Determines how the attributes of a compact buffer are arranged in memory.
+  enum Layout {
+    //! Attributes are interleaved, with each vertex stored contiguously.
+    LAYOUT_INTERLEAVED,
+    //! Each attribute is stored in its own tightly packed array, so updates to one attribute do not touch the others.
+    LAYOUT_SEPARATE,
+  };
+
+  //! Constructs a buffer holding `num_vertices` Vertex instances. `num_vertices` may be zero.
   explicit VertexBuffer(uint32_t num_vertices);
+  //! Constructs a compact buffer holding vertices in the given format.
+  VertexBuffer(uint32_t num_vertices, const VertexFormat& format, Layout layout = LAYOUT_INTERLEAVED);
   ~VertexBuffer();
 
   // Returns a new VertexBuffer containing vertices suitable for rendering as triangles by treating the contents of this
   // buffer as a triangle strip.
   [[nodiscard]] std::shared_ptr<VertexBuffer> ConvertFromTriangleStripToTriangles() const;
 
-  Vertex* Lock();
+  //! Returns a new VertexBuffer with the same format whose vertex `i` is a copy of vertex `indices[i]` of this buffer.
+  [[nodiscard]] std::shared_ptr<VertexBuffer> Gather(const uint32_t* indices, uint32_t count) const;
+
+  //! Copies the stored bytes of a single attribute (GetFormat().GetAttribute(attribute_index).size bytes) into `dst`.
+  void ReadAttribute(uint32_t vertex_index, uint32_t attribute_index, void* dst) const;
+
+  //! Returns the Vertex array of a non-compact buffer for modification.
+  Vertex* Lock() { return Lock(0, num_vertices_); }
+  //! Returns a pointer to vertex `first` of a non-compact buffer, marking only `count` vertices as modified.
+  Vertex* Lock(uint32_t first, uint32_t count);
+  //! Returns the Vertex array of a non-compact buffer without marking it as modified.
+  [[nodiscard]] const Vertex* LockReadOnly() const;
+
+  //! Returns the raw vertex data of a compact buffer for modification. See GetFormat for the layout.
+  uint8_t* LockData() { return LockData(0, num_vertices_); }
+  //! Returns the raw vertex data of a compact buffer, marking only vertices [first, first + count) as modified. Note
+  //! that the returned pointer is always the start of the data so that GetFormat offsets apply in either layout.
+  uint8_t* LockData(uint32_t first, uint32_t count);
+  //! Returns the raw vertex data of a compact buffer without marking it as modified.
+  [[nodiscard]] const uint8_t* LockDataReadOnly() const;
+
+  //! Returns the given attribute of the first vertex in a compact buffer for modification. The attribute of subsequent
+  //! vertices is found at multiples of GetFormat().GetAttribute(attribute_index).stride.
+  uint8_t* LockAttribute(uint32_t attribute_index) { return LockAttribute(attribute_index, 0, num_vertices_); }
+  //! Returns the given attribute of vertex `first` in a compact buffer, marking only `count` vertices as modified.
+  uint8_t* LockAttribute(uint32_t attribute_index, uint32_t first, uint32_t count);
   void Unlock();
 
+  //! Returns a counter that advances whenever the contents of the buffer are modified, allowing consumers that keep
+  //! derived copies of the data to cheaply detect changes.
+  [[nodiscard]] uint32_t GetGeneration() const { return generation_; }
+
+  //! Marks vertices [first, first + count) as modified, e.g., after writing through a pointer that was obtained from a
+  //! read-only lock or with a stale range.
+  void MarkDirty(uint32_t first, uint32_t count);
+
+  //! Copies vertices modified since the previous call from the staging copy into GPU memory, in a single sequential pass
+  //! per attribute array.
+  void Commit();
+
   [[nodiscard]] uint32_t GetNumVertices() const { return num_vertices_; }
 
-  void SetCacheValid(bool valid = true) { cache_valid_ = valid; }
-  [[nodiscard]] bool IsCacheValid() const { return cache_valid_; }
+  //! Returns true if this buffer stores vertices in a caller-supplied VertexFormat rather than as Vertex structs.
+  [[nodiscard]] bool IsCompact() const { return compact_; }
+
+  [[nodiscard]] Layout GetLayout() const { return layout_; }
+
+  //! Returns the location of each attribute. For non-compact buffers this describes the Vertex struct, using the
+  //! currently configured component counts.
+  [[nodiscard]] VertexFormat GetFormat() const;
+
+  //! Returns the number of bytes occupied by each vertex. For interleaved buffers this is also the distance between the
+  //! start of consecutive vertices.
+  [[nodiscard]] uint32_t GetStride() const { return compact_ ? format_.GetStride() : sizeof(Vertex); }
 
+  //! Sets the value of a single attribute of a compact buffer vertex, packing it into the attribute's type. `values`
+  //! must contain VertexFormat::GetUnpackedCount values (e.g., 3 for a TYPE_CMP normal).
+  void SetAttribute(uint32_t vertex_index, uint32_t attribute_index, const float* values);
+
+  //! Marks the hardware vertex cache as in sync with (or, if `valid` is false, stale relative to) this buffer.
+  void SetCacheValid(bool valid = true);
+  [[nodiscard]] bool IsCacheValid() const { return cache_dirty_.IsEmpty(); }
+
+  //! Updates the copy of the vertex data whose texcoord0 is scaled by the given texture dimensions, for use with linear
+  //! textures. Only vertices modified since the previous call are processed unless the dimensions change. The copy is
+  //! written directly to GPU memory and does not require a Commit.
   void Linearize(float texture_width, float texture_height);
 
   //! Defines a triangle with the given vertices.
@@ -346,9 +432,54 @@ class VertexBuffer {
  private:
   friend class NV2AState;
 
+  //! A half open range of vertex indices.
+  struct DirtyRange {
+    uint32_t begin{0};
+    uint32_t end{0};
+
+    [[nodiscard]] bool IsEmpty() const { return begin >= end; }
+    void Add(uint32_t first, uint32_t count) {
+      if (!count) {
+        return;
+      }
+      if (IsEmpty()) {
+        begin = first;
+        end = first + count;
+        return;
+      }
+      begin = first < begin ? first : begin;
+      end = first + count > end ? first + count : end;
+    }
+    void Clear() { begin = end = 0; }
+  };
+
+  //! Allocates the GPU and staging copies of the vertex data. Empty buffers (e.g., gathered from an empty mesh) hold no
+  //! storage.
+  void AllocateStorage(uint32_t buffer_size);
+
+  //! Copies vertices [first, first + count) from the staging copy to the given GPU buffer.
+  void CopyFromStaging(Vertex* gpu_buffer, uint32_t first, uint32_t count) const;
+
+  //! Returns the start of the staging copy, for draws that read vertices on the CPU.
+  [[nodiscard]] const uint8_t* GetStagingData() const { return reinterpret_cast<const uint8_t*>(staging_vertex_buffer_); }
+
+  //! Returns the start of the linearized or normalized vertex data.
+  [[nodiscard]] const uint8_t* GetVertexData(bool linear) const {
+    return reinterpret_cast<const uint8_t*>(linear ? linear_vertex_buffer_ : normalized_vertex_buffer_);
+  }
+
   uint32_t num_vertices_;
+  // Note: For compact buffers these hold GetStride() bytes per vertex and must not be indexed as Vertex.
   Vertex* linear_vertex_buffer_ = nullptr;      // texcoords 0 to kFramebufferWidth/kFramebufferHeight
   Vertex* normalized_vertex_buffer_ = nullptr;  // texcoords normalized 0 to 1
+  Vertex* staging_vertex_buffer_ = nullptr;     // CPU cached copy of normalized_vertex_buffer_
+
+  bool compact_{false};
+  Layout layout_{LAYOUT_INTERLEAVED};
+  // The format the buffer was constructed with.
+  VertexFormat source_format_;
+  // Location of each attribute in a compact buffer, in the layout given by layout_.
+  VertexFormat format_;
 
   // Number of components in the vertex position (3 or 4).
   uint32_t position_count_ = 3;
@@ -367,7 +498,16 @@ class VertexBuffer {
   uint32_t tex2_coord_count_ = 2;
   uint32_t tex3_coord_count_ = 2;
 
-  bool cache_valid_{false};  // Indicates whether the HW should be forced to reload this buffer.
+  uint32_t generation_{0};
+  // Vertices modified since the staging copy was last committed.
+  DirtyRange gpu_dirty_;
+  // Vertices modified since the HW vertex cache was last broken for this buffer.
+  DirtyRange cache_dirty_;
+  // Vertices modified since the linear data was last updated.
+  DirtyRange linear_dirty_;
+  // The texture dimensions used by the last call to Linearize.
+  float linear_texture_width_{0.0f};
+  float linear_texture_height_{0.0f};
 };
 
 }  // namespace PBKitPlusPlus
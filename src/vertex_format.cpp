@@ -0,0 +1,197 @@
+#include "vertex_format.h"
+
+#include <cstring>
+
+#include "pbkpp_assert.h"
+#include "vertex_packing.h"
+
+namespace PBKitPlusPlus {
+
+static inline uint32_t AlignToDword(uint32_t value) { return (value + 3) & ~3; }
+
+VertexFormat &VertexFormat::SetAttribute(uint32_t index, uint32_t count, uint32_t type) {
+  PBKPP_ASSERT(index < kNumAttributes && "Invalid vertex attribute index");
+  PBKPP_ASSERT(count >= 1 && count <= 4 && "Invalid attribute count");
+  PBKPP_ASSERT((type != NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D || count == 4) &&
+               "TYPE_UB_D3D attributes must have 4 components");
+  PBKPP_ASSERT((type != NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP || count == 1) &&
+               "TYPE_CMP attributes must have a count of 1");
+
+  attributes_[index].type = type;
+  attributes_[index].count = count;
+  Layout();
+  return *this;
+}
+
+VertexFormat &VertexFormat::ClearAttribute(uint32_t index) {
+  PBKPP_ASSERT(index < kNumAttributes && "Invalid vertex attribute index");
+  attributes_[index] = {};
+  Layout();
+  return *this;
+}
+
+uint32_t VertexFormat::GetAttributeMask() const {
+  uint32_t ret = 0;
+  for (uint32_t i = 0; i < kNumAttributes; ++i) {
+    if (attributes_[i].count) {
+      ret |= 1 << i;
+    }
+  }
+  return ret;
+}
+
+uint32_t VertexFormat::GetComponentSize(uint32_t type) {
+  switch (type) {
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F:
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP:
+      return 4;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1:
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K:
+      return 2;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D:
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL:
+      return 1;
+
+    default:
+      PBKPP_ASSERT(!"Unsupported vertex attribute type");
+      return 0;
+  }
+}
+
+uint32_t VertexFormat::GetUnpackedCount(const Attribute &attribute) {
+  return attribute.type == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP ? 3 : attribute.count;
+}
+
+void VertexFormat::PackAttribute(const Attribute &attribute, const float *values, void *dst) {
+  using namespace VertexPacking;
+
+  switch (attribute.type) {
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F:
+      memcpy(dst, values, attribute.count * sizeof(float));
+      break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP: {
+      uint32_t packed = PackNormalCMP(values[0], values[1], values[2]);
+      memcpy(dst, &packed, sizeof(packed));
+    } break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D: {
+      uint32_t packed = PackColorD3D(values[0], values[1], values[2], values[3]);
+      memcpy(dst, &packed, sizeof(packed));
+    } break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL: {
+      uint8_t packed[4] = {0};
+      for (uint32_t i = 0; i < attribute.count; ++i) {
+        packed[i] = PackUnorm8(values[i]);
+      }
+      memcpy(dst, packed, sizeof(packed));
+    } break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1:
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K: {
+      int16_t packed[4] = {0};
+      bool normalized = attribute.type == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1;
+      for (uint32_t i = 0; i < attribute.count; ++i) {
+        packed[i] = normalized ? PackS1(values[i]) : PackS32K(values[i]);
+      }
+      memcpy(dst, packed, attribute.size);
+    } break;
+
+    default:
+      PBKPP_ASSERT(!"Unsupported vertex attribute type");
+  }
+}
+
+void VertexFormat::UnpackAttribute(const Attribute &attribute, const void *src, float *values) {
+  using namespace VertexPacking;
+
+  switch (attribute.type) {
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F:
+      memcpy(values, src, attribute.count * sizeof(float));
+      break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP: {
+      uint32_t packed;
+      memcpy(&packed, src, sizeof(packed));
+      UnpackNormalCMP(packed, values);
+    } break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D: {
+      auto bgra = static_cast<const uint8_t *>(src);
+      values[0] = UnpackUnorm8(bgra[2]);
+      values[1] = UnpackUnorm8(bgra[1]);
+      values[2] = UnpackUnorm8(bgra[0]);
+      values[3] = UnpackUnorm8(bgra[3]);
+    } break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL: {
+      auto rgba = static_cast<const uint8_t *>(src);
+      for (uint32_t i = 0; i < attribute.count; ++i) {
+        values[i] = UnpackUnorm8(rgba[i]);
+      }
+    } break;
+
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1:
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K: {
+      int16_t packed[4];
+      memcpy(packed, src, attribute.count * sizeof(int16_t));
+      bool normalized = attribute.type == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1;
+      for (uint32_t i = 0; i < attribute.count; ++i) {
+        values[i] = normalized ? UnpackS1(packed[i]) : static_cast<float>(packed[i]);
+      }
+    } break;
+
+    default:
+      PBKPP_ASSERT(!"Unsupported vertex attribute type");
+  }
+}
+
+bool VertexFormat::operator==(const VertexFormat &other) const {
+  if (stride_ != other.stride_) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < kNumAttributes; ++i) {
+    auto &a = attributes_[i];
+    auto &b = other.attributes_[i];
+    if (a.count != b.count || (a.count && (a.type != b.type || a.offset != b.offset || a.stride != b.stride))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void VertexFormat::SetFixedAttribute(uint32_t index, uint32_t count, uint32_t type, uint32_t offset,
+                                     uint32_t stride) {
+  auto &attribute = attributes_[index];
+  attribute.type = type;
+  attribute.count = count;
+  attribute.offset = offset;
+  attribute.size = count ? AlignToDword(count * GetComponentSize(type)) : 0;
+  attribute.stride = stride;
+}
+
+void VertexFormat::Layout() {
+  stride_ = 0;
+  for (auto &attribute : attributes_) {
+    if (!attribute.count) {
+      attribute = {};
+      continue;
+    }
+
+    attribute.offset = stride_;
+    attribute.size = AlignToDword(attribute.count * GetComponentSize(attribute.type));
+    stride_ += attribute.size;
+  }
+
+  for (auto &attribute : attributes_) {
+    if (attribute.count) {
+      attribute.stride = stride_;
+    }
+  }
+}
+
+}  // namespace PBKitPlusPlus
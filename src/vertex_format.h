@@ -0,0 +1,100 @@
+#ifndef PBKITPLUSPLUS_SRC_VERTEX_FORMAT_H_
+#define PBKITPLUSPLUS_SRC_VERTEX_FORMAT_H_
+
+#include <pbkit/nv_regs.h>
+
+#include <cstdint>
+
+#include "nxdk_ext.h"
+
+namespace PBKitPlusPlus {
+
+class VertexBuffer;
+
+//! Describes the attributes stored for each vertex of a VertexBuffer and how they are laid out in memory.
+//!
+//! Attributes are identified by their NV2A_VERTEX_ATTR_* index. Present attributes are tightly interleaved in index
+//! order, each padded to a dword boundary as required by NV097_INLINE_ARRAY. VertexBuffer may instead store each
+//! attribute in its own array (see VertexBuffer::LAYOUT_SEPARATE), in which case GetFormat() reports per-attribute
+//! offsets and strides.
+//!
+//! Besides floats, attributes may use the packed hardware types, which are expanded to floats by the vertex fetch:
+//!   TYPE_UB_D3D: 4 unsigned normalized bytes in D3DCOLOR (BGRA) order. Count must be 4.
+//!   TYPE_UB_OGL: 1-4 unsigned normalized bytes in RGBA order.
+//!   TYPE_S1: 1-4 signed normalized shorts.
+//!   TYPE_S32K: 1-4 unnormalized signed shorts.
+//!   TYPE_CMP: A normal packed as 11:11:10 signed normalized values in one dword. Count must be 1.
+//! See vertex_packing.h for helpers to produce these values.
+//!
+//! E.g., a vertex with a position, normal, diffuse color and texcoord:
+//!   VertexFormat format;
+//!   format.SetAttribute(NV2A_VERTEX_ATTR_POSITION, 3)
+//!       .SetAttribute(NV2A_VERTEX_ATTR_NORMAL, 1, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP)
+//!       .SetAttribute(NV2A_VERTEX_ATTR_DIFFUSE, 4, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D)
+//!       .SetAttribute(NV2A_VERTEX_ATTR_TEXTURE0, 2, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1);
+//!   auto buffer = host.AllocateVertexBuffer(num_vertices, format);  // 24 bytes per vertex rather than 208.
+class VertexFormat {
+ public:
+  static constexpr uint32_t kNumAttributes = 16;
+
+  struct Attribute {
+    //! The NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_* of each component.
+    uint32_t type;
+    //! The number of components, or 0 if the attribute is not present.
+    uint32_t count;
+    //! The offset of the first vertex's attribute from the start of the vertex data, in bytes.
+    uint32_t offset;
+    //! The number of bytes occupied by the attribute, including padding.
+    uint32_t size;
+    //! The distance between the attribute in consecutive vertices, in bytes.
+    uint32_t stride;
+  };
+
+  //! Adds the given attribute to the format, replacing any previous definition, and recalculates the layout.
+  VertexFormat &SetAttribute(uint32_t index, uint32_t count, uint32_t type = NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F);
+
+  //! Removes the given attribute from the format and recalculates the layout.
+  VertexFormat &ClearAttribute(uint32_t index);
+
+  [[nodiscard]] bool HasAttribute(uint32_t index) const { return index < kNumAttributes && attributes_[index].count; }
+  [[nodiscard]] const Attribute &GetAttribute(uint32_t index) const { return attributes_[index]; }
+
+  //! Returns a bitmask of the present attributes, suitable for use as the `enabled_vertex_fields` of a draw call.
+  [[nodiscard]] uint32_t GetAttributeMask() const;
+
+  //! Returns the number of bytes occupied by each vertex. For interleaved layouts this is also the distance between
+  //! consecutive vertices.
+  [[nodiscard]] uint32_t GetStride() const { return stride_; }
+
+  //! Returns the size in bytes of a single component of the given NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_*.
+  static uint32_t GetComponentSize(uint32_t type);
+
+  //! Returns the number of float values that make up the given attribute once expanded by the hardware.
+  static uint32_t GetUnpackedCount(const Attribute &attribute);
+
+  //! Converts GetUnpackedCount(attribute) float values into the attribute's storage type, writing attribute.size bytes
+  //! to `dst`.
+  static void PackAttribute(const Attribute &attribute, const float *values, void *dst);
+
+  //! Expands an attribute stored in `src` into GetUnpackedCount(attribute) float values.
+  static void UnpackAttribute(const Attribute &attribute, const void *src, float *values);
+
+  bool operator==(const VertexFormat &other) const;
+  bool operator!=(const VertexFormat &other) const { return !(*this == other); }
+
+ private:
+  friend class VertexBuffer;
+
+  //! Sets an attribute at an explicit offset and stride without recalculating the layout.
+  void SetFixedAttribute(uint32_t index, uint32_t count, uint32_t type, uint32_t offset, uint32_t stride);
+
+  //! Assigns attribute offsets in index order and recalculates the stride.
+  void Layout();
+
+  Attribute attributes_[kNumAttributes]{};
+  uint32_t stride_{0};
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_VERTEX_FORMAT_H_
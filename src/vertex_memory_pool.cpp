@@ -0,0 +1,167 @@
+#include "vertex_memory_pool.h"
+
+#ifdef XBOX
+#include <pbkit/pbkit.h>
+#endif
+#include <xboxkrnl/xboxkrnl.h>
+
+#include "nxdk_ext.h"
+#include "pbkpp_assert.h"
+
+namespace PBKitPlusPlus {
+
+uint8_t *VertexMemoryPool::region_ = nullptr;
+uint32_t VertexMemoryPool::region_size_ = 0;
+std::vector<VertexMemoryPool::Slab> VertexMemoryPool::slabs_;
+std::unordered_map<void *, uint32_t> VertexMemoryPool::allocations_;
+
+static_assert((VertexMemoryPool::kMinBlockSize << 7) == VertexMemoryPool::kMaxBlockSize,
+              "kNumSizeClasses must cover kMinBlockSize to kMaxBlockSize");
+
+void VertexMemoryPool::Initialize(uint32_t region_size) {
+  if (region_) {
+    return;
+  }
+
+  region_size = region_size / kSlabSize * kSlabSize;
+  if (!region_size) {
+    return;
+  }
+
+  region_ = static_cast<uint8_t *>(
+      MmAllocateContiguousMemoryEx(region_size, 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE));
+  if (!region_) {
+    // Not fatal, every request will use an individual allocation.
+    return;
+  }
+
+  region_size_ = region_size;
+  slabs_.resize(region_size / kSlabSize);
+}
+
+uint32_t VertexMemoryPool::GetSizeClass(uint32_t size) {
+  uint32_t size_class = 0;
+  while (GetBlockSize(size_class) < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+void *VertexMemoryPool::Allocate(uint32_t size) {
+  PBKPP_ASSERT(size && "Allocation size must be non-zero.");
+
+  void *ret = nullptr;
+  if (region_ && size <= kMaxBlockSize) {
+    ret = AllocateBlock(GetSizeClass(size));
+  }
+  if (!ret) {
+    ret = AllocateLarge(size);
+  }
+
+  if (ret) {
+    allocations_[ret] = size;
+  }
+  return ret;
+}
+
+void *VertexMemoryPool::AllocateBlock(uint32_t size_class) {
+  // Prefer a slab of the same class with a free block, so that empty slabs remain available to any class.
+  Slab *target = nullptr;
+  for (auto &slab : slabs_) {
+    if (slab.size_class == size_class && !slab.free_blocks.empty()) {
+      target = &slab;
+      break;
+    }
+  }
+
+  if (!target) {
+    for (auto &slab : slabs_) {
+      if (slab.size_class == kUnassigned) {
+        target = &slab;
+        break;
+      }
+    }
+    if (!target) {
+      return nullptr;
+    }
+
+    // Blocks are handed out in address order.
+    uint32_t num_blocks = kSlabSize / GetBlockSize(size_class);
+    target->size_class = static_cast<uint8_t>(size_class);
+    target->free_blocks.resize(num_blocks);
+    for (uint32_t i = 0; i < num_blocks; ++i) {
+      target->free_blocks[i] = static_cast<uint16_t>(num_blocks - 1 - i);
+    }
+  }
+
+  auto block = target->free_blocks.back();
+  target->free_blocks.pop_back();
+  ++target->used_blocks;
+
+  auto slab_index = static_cast<uint32_t>(target - slabs_.data());
+  return region_ + slab_index * kSlabSize + block * GetBlockSize(size_class);
+}
+
+void *VertexMemoryPool::AllocateLarge(uint32_t size) {
+  return MmAllocateContiguousMemoryEx(size, 0, MAXRAM, 0, PAGE_WRITECOMBINE | PAGE_READWRITE);
+}
+
+void VertexMemoryPool::Free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  auto it = allocations_.find(ptr);
+  PBKPP_ASSERT(it != allocations_.end() && "Attempt to free memory that was not allocated by VertexMemoryPool.");
+  allocations_.erase(it);
+
+  auto address = static_cast<uint8_t *>(ptr);
+  if (address < region_ || address >= region_ + region_size_) {
+    MmFreeContiguousMemory(ptr);
+    return;
+  }
+
+  auto offset = static_cast<uint32_t>(address - region_);
+  auto &slab = slabs_[offset / kSlabSize];
+  PBKPP_ASSERT(slab.size_class != kUnassigned && slab.used_blocks);
+  slab.free_blocks.push_back(static_cast<uint16_t>((offset % kSlabSize) / GetBlockSize(slab.size_class)));
+  if (!--slab.used_blocks) {
+    slab.size_class = kUnassigned;
+    slab.free_blocks.clear();
+    slab.free_blocks.shrink_to_fit();
+  }
+}
+
+VertexMemoryPool::Stats VertexMemoryPool::GetStats() {
+  Stats ret{};
+  ret.region_bytes = region_size_;
+
+  for (auto &slab : slabs_) {
+    if (slab.size_class != kUnassigned) {
+      ret.slab_bytes += kSlabSize;
+      ret.pooled_block_bytes += slab.used_blocks * GetBlockSize(slab.size_class);
+    }
+  }
+
+  for (auto &allocation : allocations_) {
+    auto address = static_cast<uint8_t *>(allocation.first);
+    if (address >= region_ && address < region_ + region_size_) {
+      ++ret.pooled_allocations;
+      ret.pooled_requested_bytes += allocation.second;
+    } else {
+      ++ret.large_allocations;
+      ret.large_bytes += allocation.second;
+    }
+  }
+
+  if (ret.pooled_block_bytes) {
+    ret.internal_fragmentation =
+        1.0f - static_cast<float>(ret.pooled_requested_bytes) / static_cast<float>(ret.pooled_block_bytes);
+  }
+  if (ret.slab_bytes) {
+    ret.slab_fragmentation = 1.0f - static_cast<float>(ret.pooled_block_bytes) / static_cast<float>(ret.slab_bytes);
+  }
+  return ret;
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,88 @@
+#ifndef PBKITPLUSPLUS_SRC_VERTEX_MEMORY_POOL_H_
+#define PBKITPLUSPLUS_SRC_VERTEX_MEMORY_POOL_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace PBKitPlusPlus {
+
+//! Sub-allocates contiguous, write combined memory for vertex data.
+//!
+//! MmAllocateContiguousMemoryEx works in whole pages, so giving each small VertexBuffer its own allocation wastes most
+//! of a page and, over a long session, fragments physical memory. Instead, a single region is reserved up front and
+//! divided into fixed size slabs. Each slab is dedicated to one power of two size class while any of its blocks are in
+//! use, and returns to the region once they are all freed. Requests larger than the largest size class, or that cannot
+//! be satisfied once the region is exhausted, fall back to individual contiguous allocations.
+//!
+//! NV2AState initializes the pool (see its `vertex_memory_pool_size` parameter), after which every VertexBuffer allocates
+//! through it.
+class VertexMemoryPool {
+ public:
+  static constexpr uint32_t kDefaultRegionSize = 4 * 1024 * 1024;
+  static constexpr uint32_t kSlabSize = 64 * 1024;
+  static constexpr uint32_t kMinBlockSize = 256;
+  static constexpr uint32_t kMaxBlockSize = 32 * 1024;
+
+  struct Stats {
+    //! Size of the pooled region.
+    uint32_t region_bytes;
+    //! Bytes of the region assigned to a size class.
+    uint32_t slab_bytes;
+    //! Number of live allocations served from slabs.
+    uint32_t pooled_allocations;
+    //! Bytes requested by live allocations served from slabs.
+    uint32_t pooled_requested_bytes;
+    //! Bytes of the blocks handed out for live allocations served from slabs.
+    uint32_t pooled_block_bytes;
+    //! Number of live individual (large block) allocations.
+    uint32_t large_allocations;
+    //! Bytes requested by live individual allocations.
+    uint32_t large_bytes;
+    //! Fraction of handed out block bytes lost to rounding requests up to a size class.
+    float internal_fragmentation;
+    //! Fraction of assigned slab bytes that are not handed out, i.e., free blocks stranded in partially used slabs.
+    float slab_fragmentation;
+  };
+
+  //! Reserves the pooled region. Must be called after pbkit has been initialized. Allocations made before the pool is
+  //! initialized (or if the region cannot be reserved) use individual contiguous allocations. Has no effect once a
+  //! region has been reserved, and a `region_size` smaller than kSlabSize leaves pooling disabled.
+  static void Initialize(uint32_t region_size = kDefaultRegionSize);
+
+  //! Returns `size` bytes of contiguous write combined memory, or nullptr on failure.
+  static void *Allocate(uint32_t size);
+
+  //! Releases memory returned by Allocate.
+  static void Free(void *ptr);
+
+  //! Returns a snapshot of the pool's usage.
+  static Stats GetStats();
+
+ private:
+  static constexpr uint32_t kNumSizeClasses = 8;
+  static constexpr uint8_t kUnassigned = 0xFF;
+
+  //! Bookkeeping for one slab, kept in cached memory to avoid reading back from the write combined region.
+  struct Slab {
+    uint8_t size_class{kUnassigned};
+    uint16_t used_blocks{0};
+    std::vector<uint16_t> free_blocks;
+  };
+
+  static uint32_t GetSizeClass(uint32_t size);
+  static uint32_t GetBlockSize(uint32_t size_class) { return kMinBlockSize << size_class; }
+
+  static void *AllocateBlock(uint32_t size_class);
+  static void *AllocateLarge(uint32_t size);
+
+  static uint8_t *region_;
+  static uint32_t region_size_;
+  static std::vector<Slab> slabs_;
+  //! Requested size of each live allocation.
+  static std::unordered_map<void *, uint32_t> allocations_;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_VERTEX_MEMORY_POOL_H_
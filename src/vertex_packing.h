@@ -0,0 +1,75 @@
+#ifndef PBKITPLUSPLUS_SRC_VERTEX_PACKING_H_
+#define PBKITPLUSPLUS_SRC_VERTEX_PACKING_H_
+
+#include <cstdint>
+
+namespace PBKitPlusPlus {
+
+//! Helpers to convert float vertex data into the packed NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_* representations.
+//! See VertexFormat::PackAttribute to convert entire attributes.
+namespace VertexPacking {
+
+inline float Clamp(float value, float min, float max) {
+  if (value < min) {
+    return min;
+  }
+  if (value > max) {
+    return max;
+  }
+  return value;
+}
+
+inline int32_t Round(float value) { return static_cast<int32_t>(value < 0.0f ? value - 0.5f : value + 0.5f); }
+
+//! Converts a [0, 1] float to an unsigned byte.
+inline uint8_t PackUnorm8(float value) { return static_cast<uint8_t>(Round(Clamp(value, 0.0f, 1.0f) * 255.0f)); }
+
+//! Packs a color for TYPE_UB_D3D (D3DCOLOR, B in the low byte).
+inline uint32_t PackColorD3D(float r, float g, float b, float a = 1.0f) {
+  return PackUnorm8(b) | (PackUnorm8(g) << 8) | (PackUnorm8(r) << 16) | (static_cast<uint32_t>(PackUnorm8(a)) << 24);
+}
+
+//! Packs a color for TYPE_UB_OGL (R in the low byte).
+inline uint32_t PackColorOGL(float r, float g, float b, float a = 1.0f) {
+  return PackUnorm8(r) | (PackUnorm8(g) << 8) | (PackUnorm8(b) << 16) | (static_cast<uint32_t>(PackUnorm8(a)) << 24);
+}
+
+//! Packs a [-1, 1] float for TYPE_S1.
+inline int16_t PackS1(float value) { return static_cast<int16_t>(Round(Clamp(value, -1.0f, 1.0f) * 32767.0f)); }
+
+//! Packs a float for TYPE_S32K, which is read as an unnormalized integer in [-32768, 32767]. Positions and texcoords
+//! stored this way are typically prescaled, with the inverse scale folded into a matrix or texture transform.
+inline int16_t PackS32K(float value) { return static_cast<int16_t>(Round(Clamp(value, -32768.0f, 32767.0f))); }
+
+//! Packs a normal with [-1, 1] components for TYPE_CMP, as 11:11:10 signed fixed point values (X in the low bits).
+inline uint32_t PackNormalCMP(float x, float y, float z) {
+  auto pack = [](float value, uint32_t bits) {
+    auto max = static_cast<float>((1 << (bits - 1)) - 1);
+    return static_cast<uint32_t>(Round(Clamp(value, -1.0f, 1.0f) * max)) & ((1 << bits) - 1);
+  };
+  return pack(x, 11) | (pack(y, 11) << 11) | (pack(z, 10) << 22);
+}
+
+//! Converts an unsigned byte to a [0, 1] float.
+inline float UnpackUnorm8(uint8_t value) { return static_cast<float>(value) / 255.0f; }
+
+//! Converts a TYPE_S1 value to a [-1, 1] float.
+inline float UnpackS1(int16_t value) { return Clamp(static_cast<float>(value) / 32767.0f, -1.0f, 1.0f); }
+
+//! Converts a TYPE_CMP value to its three [-1, 1] components.
+inline void UnpackNormalCMP(uint32_t value, float *xyz) {
+  auto unpack = [](uint32_t packed, uint32_t bits) {
+    auto sign_shift = 32 - bits;
+    auto signed_value = static_cast<int32_t>(packed << sign_shift) >> sign_shift;
+    return Clamp(static_cast<float>(signed_value) / static_cast<float>((1 << (bits - 1)) - 1), -1.0f, 1.0f);
+  };
+  xyz[0] = unpack(value & 0x7FF, 11);
+  xyz[1] = unpack((value >> 11) & 0x7FF, 11);
+  xyz[2] = unpack(value >> 22, 10);
+}
+
+}  // namespace VertexPacking
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_SRC_VERTEX_PACKING_H_
@@ -0,0 +1,126 @@
+// Checks the dwords saved by Pushbuffer's coalescing of consecutive method pushes, and that coalesced runs are
+// accounted for correctly when they are split across blocks.
+
+#include <pbkit/nv_regs.h>
+
+#include <memory>
+#include <vector>
+
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "pushbuffer.h"
+#include "recording_pushbuffer_backend.h"
+
+using namespace PBKitPlusPlus;
+
+// pbkit rejects blocks of this many dwords or more.
+static constexpr uint32_t kMaxBlockDwords = 96;
+
+static uint32_t Header(uint32_t command, uint32_t num_params) {
+  return (num_params << 18) | (SUBCH_3D << 13) | command;
+}
+
+static std::shared_ptr<RecordingPushbufferBackend> InstallRecorder(bool coalesce) {
+  auto recorder = std::make_shared<RecordingPushbufferBackend>();
+  Pushbuffer::SetBackend(recorder);
+  Pushbuffer::SetCoalescingEnabled(coalesce);
+  Pushbuffer::SetRedundantWriteFilterEnabled(false);
+  return recorder;
+}
+
+// Pushes three 3-component colors to consecutive registers, as Light::Commit does for its ambient, diffuse and
+// specular colors.
+static void PushLightColors() {
+  const float ambient[3] = {0.1f, 0.2f, 0.3f};
+  const float diffuse[3] = {0.4f, 0.5f, 0.6f};
+  const float specular[3] = {0.7f, 0.8f, 0.9f};
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push3F(NV097_SET_PROJECTION_MATRIX, ambient);
+  Pushbuffer::Push3F(NV097_SET_PROJECTION_MATRIX + 12, diffuse);
+  Pushbuffer::Push3F(NV097_SET_PROJECTION_MATRIX + 24, specular);
+  Pushbuffer::End();
+}
+
+static void TestConsecutiveMethodsShareHeader() {
+  auto uncoalesced = InstallRecorder(false);
+  PushLightColors();
+  auto coalesced = InstallRecorder(true);
+  PushLightColors();
+
+  HOST_CHECK_EQ(uncoalesced->GetDwords().size(), 12u);
+  HOST_CHECK_EQ(coalesced->GetDwords().size(), 10u);
+
+  // The same params follow a single header.
+  std::vector<uint32_t> params;
+  auto &separate = uncoalesced->GetDwords();
+  for (uint32_t i = 0; i < separate.size(); i += 4) {
+    params.insert(params.end(), separate.begin() + i + 1, separate.begin() + i + 4);
+  }
+  auto &dwords = coalesced->GetDwords();
+  HOST_CHECK_EQ(dwords[0], Header(NV097_SET_PROJECTION_MATRIX, 9));
+  HOST_CHECK(std::vector<uint32_t>(dwords.begin() + 1, dwords.end()) == params);
+}
+
+static void TestNonConsecutiveMethodsAreNotMerged() {
+  auto recorder = InstallRecorder(true);
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_PROJECTION_MATRIX, 1);
+  Pushbuffer::Push(NV097_SET_PROJECTION_MATRIX + 8, 2);
+  Pushbuffer::End();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_PROJECTION_MATRIX + 12, 3);
+  Pushbuffer::End();
+
+  const std::vector<uint32_t> expected = {
+      Header(NV097_SET_PROJECTION_MATRIX, 1),      1,
+      Header(NV097_SET_PROJECTION_MATRIX + 8, 1),  2,
+      Header(NV097_SET_PROJECTION_MATRIX + 12, 1), 3,
+  };
+  HOST_CHECK(recorder->GetDwords() == expected);
+}
+
+static void TestRunsSplitAcrossBlocks() {
+  static constexpr uint32_t kNumValues = 1000;
+  const uint32_t command = NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY);
+
+  auto recorder = InstallRecorder(true);
+  Pushbuffer::Begin();
+  for (uint32_t i = 0; i < kNumValues; ++i) {
+    Pushbuffer::Push(command, i);
+  }
+  Pushbuffer::End();
+
+  // A run that is split must start again with a fresh header, which has to fit in the block as well.
+  auto &sizes = recorder->GetBlockSizes();
+  HOST_CHECK(sizes.size() > 1);
+  for (auto size : sizes) {
+    HOST_CHECK(size < kMaxBlockDwords);
+  }
+
+  // One header per block rather than one per value.
+  auto &dwords = recorder->GetDwords();
+  HOST_CHECK_EQ(dwords.size(), kNumValues + sizes.size());
+
+  uint32_t offset = 0;
+  uint32_t expected_value = 0;
+  for (auto size : sizes) {
+    HOST_CHECK_EQ(dwords[offset], Header(command, size - 1));
+    for (uint32_t i = 1; i < size; ++i) {
+      HOST_CHECK_EQ(dwords[offset + i], expected_value++);
+    }
+    offset += size;
+  }
+  HOST_CHECK_EQ(expected_value, kNumValues);
+}
+
+int main() {
+  Pushbuffer::Initialize();
+
+  TestConsecutiveMethodsShareHeader();
+  TestNonConsecutiveMethodsAreNotMerged();
+  TestRunsSplitAcrossBlocks();
+
+  return HostTestResult("coalescing_test");
+}
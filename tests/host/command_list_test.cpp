@@ -0,0 +1,120 @@
+// Checks CommandList recording and replay against a RecordingPushbufferBackend.
+
+#include <pbkit/nv_regs.h>
+
+#include <memory>
+#include <vector>
+
+#include "command_list.h"
+#include "fence.h"
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "pushbuffer.h"
+#include "recording_pushbuffer_backend.h"
+
+using namespace PBKitPlusPlus;
+
+static uint32_t Header(uint32_t command, uint32_t num_params) {
+  return (num_params << 18) | (SUBCH_3D << 13) | command;
+}
+
+// Counts how often the pushbuffer polls the backend, which it only does when waiting for the GPU.
+class PollCountingBackend : public RecordingPushbufferBackend {
+ public:
+  bool Busy() override {
+    ++busy_polls;
+    return false;
+  }
+
+  uint32_t busy_polls = 0;
+};
+
+template <typename Backend>
+static std::shared_ptr<Backend> InstallRecorder() {
+  auto recorder = std::make_shared<Backend>();
+  Pushbuffer::SetBackend(recorder);
+  Pushbuffer::SetCoalescingEnabled(false);
+  Pushbuffer::SetRedundantWriteFilterEnabled(false);
+  return recorder;
+}
+
+// Pushes runs of the largest raw size within a single block until `done` returns true.
+template <typename Predicate>
+static void PushRunsUntil(Predicate done) {
+  std::vector<uint32_t> run(Pushbuffer::kMaxRawDwords, 0);
+  run[0] = Header(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_NO_OPERATION), Pushbuffer::kMaxRawDwords - 1);
+
+  Pushbuffer::Begin();
+  while (!done()) {
+    Pushbuffer::PushRaw(run.data(), Pushbuffer::kMaxRawDwords);
+  }
+  Pushbuffer::End();
+}
+
+static void TestReplayMatchesRecording() {
+  auto recorder = InstallRecorder<RecordingPushbufferBackend>();
+
+  CommandList list;
+  list.BeginRecording();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::Push(NV097_SET_CLIP_MIN, 2, 3);
+  Pushbuffer::End();
+  list.EndRecording();
+
+  HOST_CHECK(recorder->GetDwords().empty());
+
+  list.Replay();
+  list.Replay();
+
+  const std::vector<uint32_t> expected = {
+      Header(NV097_SET_BLEND_ENABLE, 1), 1, Header(NV097_SET_CLIP_MIN, 2), 2, 3,
+  };
+  HOST_CHECK(list.GetDwords() == expected);
+  auto &dwords = recorder->GetDwords();
+  HOST_CHECK(std::vector<uint32_t>(dwords.begin(), dwords.begin() + 5) == expected);
+  HOST_CHECK(std::vector<uint32_t>(dwords.begin() + 5, dwords.end()) == expected);
+}
+
+static void TestFlushWhileRecordingPreservesRing() {
+  auto recorder = InstallRecorder<PollCountingBackend>();
+  Pushbuffer::SetRingSubmissionEnabled(true);
+
+  // Wrap once so that every segment is guarded by a fence.
+  PushRunsUntil([&]() { return recorder->GetWrapCount() == 1; });
+  auto num_resets = recorder->GetResetCount();
+
+  // Flushes issued while recording (e.g., by NV2AState::DrawInlineBuffer) must only reset the recording.
+  CommandList list;
+  list.BeginRecording();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::End();
+  Pushbuffer::Flush();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 0);
+  Pushbuffer::End();
+  list.EndRecording();
+
+  HOST_CHECK_EQ(recorder->GetResetCount(), num_resets);
+  HOST_CHECK_EQ(list.GetDwords().size(), 4u);
+
+  // Moving into the next segment must still wait on the fence left there before the wrap.
+  recorder->busy_polls = 0;
+  auto num_blocks = recorder->GetBlockCount();
+  const uint32_t segment_blocks = (PBKIT_PUSHBUFFER_SIZE / 5) / 4 / Pushbuffer::kMaxRawDwords + 1;
+  PushRunsUntil([&]() { return recorder->GetBlockCount() - num_blocks > segment_blocks; });
+  HOST_CHECK(recorder->busy_polls > 0);
+
+  Pushbuffer::SetRingSubmissionEnabled(false);
+}
+
+int main() {
+  Pushbuffer::Initialize();
+  FenceManager::Initialize();
+
+  TestReplayMatchesRecording();
+  TestFlushWhileRecordingPreservesRing();
+
+  return HostTestResult("command_list_test");
+}
@@ -0,0 +1,48 @@
+// Checks FrameArena's heap usage across frames and the per-frame heap allocation count reported by PushbufferStats.
+
+#include "frame_arena.h"
+#include "host_test.h"
+#include "pushbuffer_stats.h"
+
+using namespace PBKitPlusPlus;
+
+// Simulates a frame that needs the given amount of scratch memory, ending it the way NV2AState does.
+static void RunFrame(size_t scratch_bytes) {
+  FrameArena::Allocate(scratch_bytes);
+  FrameArena::Reset();
+  PushbufferStats::EndFrame();
+}
+
+static void TestSteadyStateMakesNoHeapAllocations() {
+  FrameArena::Initialize(1024);
+  FrameArena::Reset();
+  PushbufferStats::EndFrame();
+
+  // The first frame spills to the heap and grows the buffer on Reset. The second then fits within it.
+  RunFrame(4096);
+  HOST_CHECK(FrameArena::GetLastFrameHeapAllocations() > 0);
+  HOST_CHECK(PushbufferStats::GetLastFrame().heap_allocations >= FrameArena::GetLastFrameHeapAllocations());
+
+  RunFrame(4096);
+  HOST_CHECK_EQ(FrameArena::GetLastFrameHeapAllocations(), 0u);
+  HOST_CHECK_EQ(PushbufferStats::GetLastFrame().heap_allocations, 0u);
+}
+
+static void TestOperatorNewIsCounted() {
+  PushbufferStats::EndFrame();
+
+  delete new int(1);
+  delete[] new char[16];
+  HOST_CHECK_EQ(PushbufferStats::GetCurrentFrame().heap_allocations, 2u);
+
+  PushbufferStats::EndFrame();
+  HOST_CHECK_EQ(PushbufferStats::GetLastFrame().heap_allocations, 2u);
+  HOST_CHECK_EQ(PushbufferStats::GetCurrentFrame().heap_allocations, 0u);
+}
+
+int main() {
+  TestSteadyStateMakesNoHeapAllocations();
+  TestOperatorNewIsCounted();
+
+  return HostTestResult("frame_arena_test");
+}
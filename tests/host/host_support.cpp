@@ -0,0 +1,103 @@
+// Host replacements for the parts of the library that talk to pbkit or the kernel directly. Only the pieces needed to
+// link the code under test are provided.
+
+#include <pbkit/nv_regs.h>
+
+#include <xboxkrnl/xboxkrnl.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "fence.h"
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "pbkpp_assert.h"
+#include "pushbuffer.h"
+#include "pushbuffer_backend.h"
+
+// Contiguous memory is only ever read back by the CPU on the host, so the heap stands in for it.
+void *MmAllocateContiguousMemoryEx(size_t NumberOfBytes, uintptr_t LowestAcceptableAddress,
+                                   uintptr_t HighestAcceptableAddress, size_t Alignment, uint32_t Protect) {
+  return malloc(NumberOfBytes);
+}
+
+void MmFreeContiguousMemory(void *BaseAddress) { free(BaseAddress); }
+
+namespace PBKitPlusPlus {
+
+uint32_t host_test_failures = 0;
+
+int HostTestResult(const char *test_name) {
+  if (host_test_failures) {
+    fprintf(stderr, "%s: %u check(s) failed\n", test_name, host_test_failures);
+    return 1;
+  }
+  printf("%s: passed\n", test_name);
+  return 0;
+}
+
+#ifndef NDEBUG
+[[noreturn]] void PBKPP_PrintAssertAndWaitForever(const char *assert_code, const char *filename, uint32_t line) {
+  fprintf(stderr, "ASSERT FAILED: '%s' at %s:%u\n", assert_code, filename, line);
+  abort();
+}
+#endif
+
+// The pbkit backend is the default until a test installs its own, but must never receive any commands.
+[[noreturn]] static void NoPBKit() {
+  fprintf(stderr, "PBKitPushbufferBackend is not available on the host\n");
+  abort();
+}
+
+uint32_t *PBKitPushbufferBackend::Begin() { NoPBKit(); }
+void PBKitPushbufferBackend::End(uint32_t *head) { NoPBKit(); }
+bool PBKitPushbufferBackend::Busy() { return false; }
+void PBKitPushbufferBackend::Reset() {}
+void PBKitPushbufferBackend::Wrap() { NoPBKit(); }
+
+// Fences are backed by a plain word that nothing ever writes, so they are only considered signaled once the backend is
+// idle (which host backends always are).
+static uint32_t host_semaphore = 0;
+volatile uint32_t *FenceManager::semaphore_ = nullptr;
+uint32_t FenceManager::last_inserted_value_ = 0;
+
+void FenceManager::Initialize() { semaphore_ = &host_semaphore; }
+
+Fence FenceManager::Allocate() {
+  Fence fence{++last_inserted_value_};
+  if (!fence.value) {
+    fence.value = ++last_inserted_value_;
+  }
+  return fence;
+}
+
+uint32_t FenceManager::GetSemaphoreOffset() { return 0; }
+
+Fence FenceManager::Insert() {
+  PBKPP_ASSERT(!Pushbuffer::IsCapturing() && "Fences must not be inserted while recording a CommandList");
+  auto fence = Allocate();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_CONTEXT_DMA_SEMAPHORE, kSemaphoreDMAChannel);
+  Pushbuffer::Push(NV097_SET_SEMAPHORE_OFFSET, GetSemaphoreOffset());
+  Pushbuffer::Push(NV097_BACK_END_WRITE_SEMAPHORE_RELEASE, fence.value);
+  Pushbuffer::End();
+  return fence;
+}
+
+bool FenceManager::IsSignaled(Fence fence) {
+  if (Pushbuffer::IsCapturing()) {
+    return !fence.value || !Pushbuffer::GetSubmissionBackend()->Busy();
+  }
+  return !fence.value || (!Pushbuffer::IsInBlock() && !Pushbuffer::GetBackend()->Busy());
+}
+
+void FenceManager::Wait(Fence fence) {
+  PBKPP_ASSERT(!Pushbuffer::IsCapturing() && "Wait must not be called while recording a CommandList");
+  PBKPP_ASSERT(IsSignaled(fence) && "Host fences can only be waited on once the backend is idle");
+}
+
+uint32_t FenceManager::GetCompletedValue() { return host_semaphore; }
+
+uint32_t FenceManager::GetLastInsertedValue() { return last_inserted_value_; }
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,39 @@
+#ifndef PBKITPLUSPLUS_TESTS_HOST_HOST_TEST_H_
+#define PBKITPLUSPLUS_TESTS_HOST_HOST_TEST_H_
+
+// Minimal helpers for host tests, which are plain executables that return non-zero if any check fails.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace PBKitPlusPlus {
+
+//! Number of checks that have failed in the current test executable.
+extern uint32_t host_test_failures;
+
+//! Returns the exit code for a test executable, reporting the number of failures.
+int HostTestResult(const char *test_name);
+
+}  // namespace PBKitPlusPlus
+
+#define HOST_CHECK(c)                                                            \
+  do {                                                                           \
+    if (!(c)) {                                                                  \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #c);     \
+      ++PBKitPlusPlus::host_test_failures;                                       \
+    }                                                                            \
+  } while (false)
+
+#define HOST_CHECK_EQ(a, b)                                                                                      \
+  do {                                                                                                           \
+    auto _a = (a);                                                                                               \
+    auto _b = (b);                                                                                               \
+    if (!(_a == _b)) {                                                                                           \
+      fprintf(stderr, "%s:%d: check failed: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b,              \
+              static_cast<long long>(_a), static_cast<long long>(_b));                                           \
+      ++PBKitPlusPlus::host_test_failures;                                                                       \
+    }                                                                                                            \
+  } while (false)
+
+#endif  // PBKITPLUSPLUS_TESTS_HOST_HOST_TEST_H_
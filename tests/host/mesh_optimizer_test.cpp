@@ -0,0 +1,93 @@
+// Checks the index reordering performed by MeshOptimizer.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "host_test.h"
+#include "mesh_optimizer.h"
+
+using namespace PBKitPlusPlus;
+
+typedef std::array<uint32_t, 3> Triangle;
+
+// Returns the triangle list indices of a grid of `size` x `size` quads, in row order.
+static std::vector<uint32_t> MakeGrid(uint32_t size) {
+  std::vector<uint32_t> indices;
+  const uint32_t row_vertices = size + 1;
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      uint32_t ul = y * row_vertices + x;
+      uint32_t ll = ul + row_vertices;
+      indices.insert(indices.end(), {ul, ll, ul + 1, ul + 1, ll, ll + 1});
+    }
+  }
+  return indices;
+}
+
+// Returns the triangles of a list, each rotated so that its smallest index comes first (preserving winding), sorted.
+static std::vector<Triangle> CanonicalTriangles(const std::vector<uint32_t> &indices) {
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    Triangle triangle = {indices[i], indices[i + 1], indices[i + 2]};
+    std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+static void TestACMROfGrid() {
+  // Walking an 8x8 grid in row order keeps the previous row in the 24 entry cache, so each of the 81 vertices misses
+  // exactly once across the 128 triangles.
+  auto grid = MakeGrid(8);
+  float acmr = MeshOptimizer::CalculateACMR(grid.data(), static_cast<uint32_t>(grid.size()));
+  HOST_CHECK(std::fabs(acmr - 81.0f / 128.0f) < 1e-5f);
+
+  // Unshared triangles miss on every corner.
+  const uint32_t separate[] = {0, 1, 2, 3, 4, 5};
+  acmr = MeshOptimizer::CalculateACMR(separate, 6);
+  HOST_CHECK(std::fabs(acmr - 3.0f) < 1e-5f);
+}
+
+static void TestOptimizeVertexCacheDoesNotRegress() {
+  auto grid = MakeGrid(16);
+  const auto num_vertices = 17u * 17u;
+  const auto num_triangles = static_cast<uint32_t>(grid.size() / 3);
+
+  // Scatter the triangles with a fixed permutation so that the input order has little locality.
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < num_triangles; ++i) {
+    uint32_t triangle = (i * 97) % num_triangles;
+    indices.insert(indices.end(), grid.begin() + triangle * 3, grid.begin() + triangle * 3 + 3);
+  }
+  const auto num_indices = static_cast<uint32_t>(indices.size());
+  float before = MeshOptimizer::CalculateACMR(indices.data(), num_indices);
+
+  auto original = CanonicalTriangles(indices);
+  MeshOptimizer::OptimizeVertexCache(indices.data(), num_indices, num_vertices);
+  float after = MeshOptimizer::CalculateACMR(indices.data(), num_indices);
+
+  HOST_CHECK(after <= before);
+  HOST_CHECK(after < 1.0f);
+  HOST_CHECK(CanonicalTriangles(indices) == original);
+}
+
+static void TestOptimizeVertexFetchRenumbers() {
+  std::vector<uint32_t> indices = {5, 3, 7, 3, 5, 9};
+
+  auto new_to_old = MeshOptimizer::OptimizeVertexFetch(indices.data(), static_cast<uint32_t>(indices.size()), 10);
+
+  // Vertices are numbered in order of first use and unreferenced ones are dropped.
+  HOST_CHECK(indices == (std::vector<uint32_t>{0, 1, 2, 1, 0, 3}));
+  HOST_CHECK(new_to_old == (std::vector<uint32_t>{5, 3, 7, 9}));
+}
+
+int main() {
+  TestACMROfGrid();
+  TestOptimizeVertexCacheDoesNotRegress();
+  TestOptimizeVertexFetchRenumbers();
+
+  return HostTestResult("mesh_optimizer_test");
+}
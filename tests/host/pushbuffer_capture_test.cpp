@@ -0,0 +1,182 @@
+// Checks the pushbuffer capture decoder and the round trip from CapturePushbufferBackend to PushbufferCaptureReader.
+
+#include <pbkit/nv_regs.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "capture_pushbuffer_backend.h"
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "pushbuffer.h"
+#include "pushbuffer_capture_reader.h"
+#include "recording_pushbuffer_backend.h"
+
+using namespace PBKitPlusPlus;
+
+using Entry = PushbufferCaptureEntry;
+
+static constexpr const char kCapturePath[] = "pushbuffer_capture_test.pbc";
+
+static uint32_t Header(uint32_t command, uint32_t num_params) {
+  return (num_params << 18) | (SUBCH_3D << 13) | command;
+}
+
+static void TestDecodeCommands() {
+  const uint32_t dwords[] = {
+      0x20000000 | 0x1000,  // Old style jump.
+      0x00002000 | 0x1,     // Jump.
+      0x00003000 | 0x2,     // Call.
+      Pushbuffer::kSubroutineReturn,
+      Header(NV097_SET_BEGIN_END, 1),
+      NV097_SET_BEGIN_END_OP_TRIANGLES,
+      Header(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), 3),
+      10,
+      11,
+      12,
+      Header(NV097_SET_VERTEX_DATA4UB, 2),
+      20,
+      21,
+  };
+
+  PushbufferCaptureReader reader;
+  reader.ParseDwords(dwords, sizeof(dwords) / sizeof(dwords[0]));
+
+  auto &entries = reader.GetEntries();
+  HOST_CHECK_EQ(reader.GetBlockCount(), 1u);
+  HOST_CHECK_EQ(entries.size(), 8u);
+  if (entries.size() != 8) {
+    return;
+  }
+
+  HOST_CHECK_EQ(entries[0].type, Entry::BLOCK);
+  HOST_CHECK_EQ(entries[0].value, 13u);
+  HOST_CHECK_EQ(entries[1].type, Entry::JUMP);
+  HOST_CHECK_EQ(entries[1].value, 0x1000u);
+  HOST_CHECK_EQ(entries[2].type, Entry::JUMP);
+  HOST_CHECK_EQ(entries[2].value, 0x2000u);
+  HOST_CHECK_EQ(entries[3].type, Entry::CALL);
+  HOST_CHECK_EQ(entries[3].value, 0x3000u);
+  HOST_CHECK_EQ(entries[4].type, Entry::RETURN);
+
+  HOST_CHECK_EQ(entries[5].type, Entry::METHOD);
+  HOST_CHECK_EQ(entries[5].method, static_cast<uint32_t>(NV097_SET_BEGIN_END));
+  HOST_CHECK(!entries[5].non_incrementing);
+  HOST_CHECK(entries[5].params == std::vector<uint32_t>{NV097_SET_BEGIN_END_OP_TRIANGLES});
+
+  // Every parameter of a non-incrementing run targets the same method.
+  HOST_CHECK_EQ(entries[6].type, Entry::METHOD);
+  HOST_CHECK(entries[6].non_incrementing);
+  HOST_CHECK_EQ(entries[6].method, static_cast<uint32_t>(NV097_INLINE_ARRAY));
+  HOST_CHECK_EQ(entries[6].GetParamMethod(2), static_cast<uint32_t>(NV097_INLINE_ARRAY));
+  HOST_CHECK(entries[6].params == (std::vector<uint32_t>{10, 11, 12}));
+
+  HOST_CHECK_EQ(entries[7].type, Entry::METHOD);
+  HOST_CHECK_EQ(entries[7].GetParamMethod(1), static_cast<uint32_t>(NV097_SET_VERTEX_DATA4UB + 4));
+}
+
+static void TestDecodeTruncatedMethod() {
+  const uint32_t dwords[] = {Header(NV097_SET_VERTEX_DATA4UB, 4), 1, 2};
+
+  PushbufferCaptureReader reader;
+  reader.ParseDwords(dwords, sizeof(dwords) / sizeof(dwords[0]));
+
+  auto &entries = reader.GetEntries();
+  HOST_CHECK_EQ(entries.size(), 2u);
+  if (entries.size() == 2) {
+    HOST_CHECK_EQ(entries[1].type, Entry::UNKNOWN);
+    HOST_CHECK_EQ(entries[1].value, dwords[0]);
+  }
+}
+
+static void TestCaptureRoundTrip() {
+  auto recorder = std::make_shared<RecordingPushbufferBackend>();
+  {
+    CapturePushbufferBackend capture(recorder, kCapturePath);
+    HOST_CHECK(capture.IsOpen());
+
+    uint32_t *head = capture.Begin();
+    capture.Tag(head, "first");
+    head[0] = Header(NV097_SET_BEGIN_END, 1);
+    head[1] = NV097_SET_BEGIN_END_OP_TRIANGLES;
+    capture.Tag(head + 2, "second");
+    head[2] = 0x00004000 | 0x2;
+    capture.Call(head + 2, 36);
+    head[3] = Header(NV097_SET_BEGIN_END, 1);
+    head[4] = NV097_SET_BEGIN_END_OP_END;
+    capture.End(head + 5);
+
+    capture.InvalidateState();
+    capture.Wrap();
+    capture.Reset();
+    capture.EndFrame();
+
+    // Tags left at the end of a block carry over to the blocks that follow.
+    head = capture.Begin();
+    head[0] = Header(NV097_NO_OPERATION, 1);
+    head[1] = 0;
+    capture.End(head + 2);
+    HOST_CHECK(capture.IsOpen());
+  }
+
+  // The target still sees everything that was captured.
+  HOST_CHECK_EQ(recorder->GetBlockCount(), 2u);
+  HOST_CHECK_EQ(recorder->GetCalls().size(), 1u);
+  HOST_CHECK_EQ(recorder->GetInvalidateCount(), 1u);
+  HOST_CHECK_EQ(recorder->GetWrapCount(), 1u);
+  HOST_CHECK_EQ(recorder->GetResetCount(), 1u);
+
+  PushbufferCaptureReader reader;
+  HOST_CHECK(reader.LoadFile(kCapturePath));
+  remove(kCapturePath);
+
+  const std::vector<Entry::Type> expected_types = {
+      Entry::BLOCK, Entry::METHOD, Entry::CALL,      Entry::METHOD, Entry::INVALIDATE,
+      Entry::WRAP,  Entry::FLUSH,  Entry::FRAME_END, Entry::BLOCK,  Entry::METHOD,
+  };
+  auto &entries = reader.GetEntries();
+  HOST_CHECK_EQ(reader.GetBlockCount(), 2u);
+  HOST_CHECK_EQ(entries.size(), expected_types.size());
+  if (entries.size() != expected_types.size()) {
+    return;
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    HOST_CHECK_EQ(entries[i].type, expected_types[i]);
+  }
+
+  HOST_CHECK(reader.GetTagName(entries[1].tag) == "first");
+  HOST_CHECK(reader.GetTagName(entries[2].tag) == "second");
+  HOST_CHECK_EQ(entries[2].value, 0x4000u);
+  HOST_CHECK_EQ(entries[2].num_indices, 36u);
+  HOST_CHECK(reader.GetTagName(entries[3].tag) == "second");
+  HOST_CHECK_EQ(entries[4].block, 0u);
+  HOST_CHECK(reader.GetTagName(entries[9].tag) == "second");
+  HOST_CHECK_EQ(entries[9].block, 1u);
+}
+
+static void TestCaptureReportsWriteFailure() {
+  // Writes to /dev/full fail once the stdio buffer is flushed. Skipped on hosts without it.
+  auto recorder = std::make_shared<RecordingPushbufferBackend>();
+  CapturePushbufferBackend capture(recorder, "/dev/full");
+  if (!capture.IsOpen()) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < 4096 && capture.IsOpen(); ++i) {
+    uint32_t *head = capture.Begin();
+    head[0] = Header(NV097_NO_OPERATION, 1);
+    head[1] = i;
+    capture.End(head + 2);
+  }
+  HOST_CHECK(!capture.IsOpen());
+}
+
+int main() {
+  TestDecodeCommands();
+  TestDecodeTruncatedMethod();
+  TestCaptureRoundTrip();
+  TestCaptureReportsWriteFailure();
+
+  return HostTestResult("pushbuffer_capture_test");
+}
@@ -0,0 +1,220 @@
+// Checks the exact dwords that Pushbuffer produces when writing into a RecordingPushbufferBackend.
+
+#include <pbkit/nv_regs.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "fence.h"
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "pushbuffer.h"
+#include "recording_pushbuffer_backend.h"
+
+using namespace PBKitPlusPlus;
+
+static uint32_t Header(uint32_t command, uint32_t num_params) {
+  return (num_params << 18) | (SUBCH_3D << 13) | command;
+}
+
+static std::shared_ptr<RecordingPushbufferBackend> InstallRecorder() {
+  auto recorder = std::make_shared<RecordingPushbufferBackend>();
+  Pushbuffer::SetBackend(recorder);
+  Pushbuffer::SetCoalescingEnabled(false);
+  Pushbuffer::SetRedundantWriteFilterEnabled(false);
+  return recorder;
+}
+
+static void TestPushEncoding() {
+  auto recorder = InstallRecorder();
+
+  float color[3] = {0.25f, 0.5f, 1.f};
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::Push3F(NV097_SET_BLEND_COLOR, color);
+  Pushbuffer::Push(NV097_SET_CLIP_MIN, 2, 3);
+  Pushbuffer::End();
+
+  uint32_t color_bits[3];
+  memcpy(color_bits, color, sizeof(color));
+  const std::vector<uint32_t> expected = {
+      Header(NV097_SET_BLEND_ENABLE, 1), 1,
+      Header(NV097_SET_BLEND_COLOR, 3),  color_bits[0], color_bits[1], color_bits[2],
+      Header(NV097_SET_CLIP_MIN, 2),     2,             3,
+  };
+  HOST_CHECK(recorder->GetDwords() == expected);
+  HOST_CHECK_EQ(recorder->GetBlockCount(), 1u);
+}
+
+static void TestRedundantWritesAreFiltered() {
+  auto recorder = InstallRecorder();
+  Pushbuffer::SetRedundantWriteFilterEnabled(true);
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 0);
+  Pushbuffer::End();
+
+  const std::vector<uint32_t> expected = {
+      Header(NV097_SET_BLEND_ENABLE, 1), 1,
+      Header(NV097_SET_BLEND_ENABLE, 1), 0,
+  };
+  HOST_CHECK(recorder->GetDwords() == expected);
+
+  // Once the shadow is invalidated, the next write must be emitted even if it matches the last value.
+  recorder->Clear();
+  Pushbuffer::InvalidateShadowRegisters();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 0);
+  Pushbuffer::End();
+  HOST_CHECK_EQ(recorder->GetDwords().size(), 2u);
+}
+
+static void TestNestedBlocksShareOneBackendBlock() {
+  auto recorder = InstallRecorder();
+
+  Pushbuffer::Begin();
+  for (uint32_t i = 0; i < 4; ++i) {
+    Pushbuffer::Begin();
+    Pushbuffer::Push(NV097_NO_OPERATION, i);
+    Pushbuffer::End();
+  }
+  Pushbuffer::End();
+
+  HOST_CHECK_EQ(recorder->GetBlockCount(), 1u);
+  HOST_CHECK_EQ(recorder->GetDwords().size(), 8u);
+}
+
+static void TestLargeBlocksAreSplit() {
+  auto recorder = InstallRecorder();
+
+  // Each matrix is 17 dwords, so 20 of them cannot fit in a single pbkit block.
+  float matrix[16] = {};
+  Pushbuffer::Begin();
+  for (uint32_t i = 0; i < 20; ++i) {
+    Pushbuffer::Push4x4Matrix(NV097_SET_PROJECTION_MATRIX, matrix);
+  }
+  Pushbuffer::End();
+
+  auto &dwords = recorder->GetDwords();
+  HOST_CHECK_EQ(dwords.size(), 20u * 17u);
+  HOST_CHECK(recorder->GetBlockCount() > 1);
+  for (uint32_t i = 0; i < 20; ++i) {
+    HOST_CHECK_EQ(dwords[i * 17], Header(NV097_SET_PROJECTION_MATRIX, 16));
+  }
+}
+
+static void TestFlushResetsBackend() {
+  auto recorder = InstallRecorder();
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_NO_OPERATION, 0);
+  Pushbuffer::End(true);
+  Pushbuffer::Flush();
+
+  HOST_CHECK_EQ(recorder->GetResetCount(), 2u);
+  HOST_CHECK_EQ(recorder->GetDwords().size(), 2u);
+}
+
+static void TestInvalidateShadowRegistersNotifiesBackend() {
+  auto recorder = InstallRecorder();
+  Pushbuffer::SetRedundantWriteFilterEnabled(true);
+
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::End();
+  Pushbuffer::InvalidateShadowRegisters();
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BLEND_ENABLE, 1);
+  Pushbuffer::End();
+
+  HOST_CHECK_EQ(recorder->GetInvalidateCount(), 1u);
+  HOST_CHECK_EQ(recorder->GetDwords().size(), 4u);
+}
+
+static void TestRawPushesAndCallsNotifyBackend() {
+  auto recorder = InstallRecorder();
+
+  // Raw dwords and state-modifying subroutines are opaque, so the backend must be told even without filtering.
+  const uint32_t raw[] = {Header(NV097_SET_BLEND_ENABLE, 1), 1};
+  alignas(4) static uint32_t subroutine[] = {Pushbuffer::kSubroutineReturn};
+  Pushbuffer::Begin();
+  Pushbuffer::PushRaw(raw, 2);
+  Pushbuffer::PushCall(subroutine);
+  Pushbuffer::PushCall(subroutine, false);
+  Pushbuffer::End();
+
+  HOST_CHECK_EQ(recorder->GetInvalidateCount(), 2u);
+}
+
+static void TestPushCallIsReportedToBackend() {
+  auto recorder = InstallRecorder();
+
+  alignas(4) static uint32_t subroutine[] = {Pushbuffer::kSubroutineReturn};
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_TRIANGLES);
+  Pushbuffer::PushCall(subroutine, false, 36);
+  Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
+  Pushbuffer::End();
+
+  auto &calls = recorder->GetCalls();
+  HOST_CHECK_EQ(recorder->GetDwords().size(), 5u);
+  HOST_CHECK_EQ(calls.size(), 1u);
+  if (calls.size() == 1) {
+    HOST_CHECK_EQ(calls[0].offset, 2u);
+    HOST_CHECK_EQ(calls[0].num_indices, 36u);
+    HOST_CHECK_EQ(recorder->GetDwords()[2] & 0x3, 2u);
+  }
+}
+
+static void TestRingSubmissionFencesSegments() {
+  auto recorder = InstallRecorder();
+  Pushbuffer::SetRingSubmissionEnabled(true);
+
+  // Runs of the largest raw size leave no room in their block for a segment fence, and enough of them are pushed to
+  // wrap the ring once.
+  std::vector<uint32_t> run(Pushbuffer::kMaxRawDwords, 0);
+  run[0] = Header(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_NO_OPERATION), Pushbuffer::kMaxRawDwords - 1);
+  const uint32_t num_runs = (PBKIT_PUSHBUFFER_SIZE / 5) / Pushbuffer::kMaxRawDwords + 1;
+  Pushbuffer::Begin();
+  for (uint32_t i = 0; i < num_runs; ++i) {
+    Pushbuffer::PushRaw(run.data(), Pushbuffer::kMaxRawDwords);
+  }
+  Pushbuffer::End();
+  Pushbuffer::SetRingSubmissionEnabled(false);
+
+  HOST_CHECK_EQ(recorder->GetWrapCount(), 1u);
+  for (auto size : recorder->GetBlockSizes()) {
+    HOST_CHECK(size < 96);
+  }
+
+  // Every segment, including the last one before the wrap, must end with a fence.
+  auto &dwords = recorder->GetDwords();
+  uint32_t num_fences = 0;
+  for (uint32_t i = 0; i < dwords.size(); i += ((dwords[i] >> 18) & 0x7FF) + 1) {
+    if (dwords[i] == Header(NV097_SET_SEMAPHORE_OFFSET, 2)) {
+      ++num_fences;
+    }
+  }
+  HOST_CHECK_EQ(num_fences, 4u);
+  HOST_CHECK_EQ(dwords.size(), num_runs * Pushbuffer::kMaxRawDwords + num_fences * 5);
+}
+
+int main() {
+  Pushbuffer::Initialize();
+  FenceManager::Initialize();
+
+  TestPushEncoding();
+  TestRedundantWritesAreFiltered();
+  TestNestedBlocksShareOneBackendBlock();
+  TestLargeBlocksAreSplit();
+  TestFlushResetsBackend();
+  TestInvalidateShadowRegistersNotifiesBackend();
+  TestRawPushesAndCallsNotifyBackend();
+  TestPushCallIsReportedToBackend();
+  TestRingSubmissionFencesSegments();
+
+  return HostTestResult("pushbuffer_test");
+}
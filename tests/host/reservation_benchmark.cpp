@@ -0,0 +1,124 @@
+// Compares the cost of writing inline vertex data and array elements through Pushbuffer::Reservation against the
+// equivalent Pushbuffer::Push* calls. Both paths write into a RecordingPushbufferBackend, so the absolute numbers
+// include the cost of recording each block and are only meaningful relative to each other.
+//
+// Usage: reservation_benchmark [iterations]
+
+#include <pbkit/nv_regs.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "pushbuffer.h"
+#include "recording_pushbuffer_backend.h"
+
+using namespace PBKitPlusPlus;
+
+// Number of vertices (and index pairs) written by each iteration.
+static constexpr uint32_t kNumVertices = 4096;
+// Position + diffuse + texcoord, matching a typical DrawInlineArray vertex.
+static constexpr uint32_t kVertexDwords = 4 + 4 + 2;
+static constexpr uint32_t kElementsPerReservation = 32;
+
+static void PushInlineArray(const std::vector<uint32_t> &vertices) {
+  Pushbuffer::Begin();
+  for (uint32_t i = 0; i < kNumVertices; ++i) {
+    Pushbuffer::PushN(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY), kVertexDwords,
+                      vertices.data() + i * kVertexDwords);
+  }
+  Pushbuffer::End();
+}
+
+static void ReserveInlineArray(const std::vector<uint32_t> &vertices) {
+  Pushbuffer::Begin();
+  for (uint32_t i = 0; i < kNumVertices; ++i) {
+    Pushbuffer::Reservation reservation(Pushbuffer::MethodSize(kVertexDwords));
+    reservation.PushN<kVertexDwords>(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_INLINE_ARRAY),
+                                     vertices.data() + i * kVertexDwords);
+  }
+  Pushbuffer::End();
+}
+
+static void PushElements(const std::vector<uint32_t> &index_pairs) {
+  Pushbuffer::Begin();
+  for (auto pair : index_pairs) {
+    Pushbuffer::Push(NV097_ARRAY_ELEMENT16, pair);
+  }
+  Pushbuffer::End();
+}
+
+static void ReserveElements(const std::vector<uint32_t> &index_pairs) {
+  Pushbuffer::Begin();
+  auto next = index_pairs.begin();
+  while (next != index_pairs.end()) {
+    auto batch_size = std::min<uint32_t>(index_pairs.end() - next, kElementsPerReservation);
+    Pushbuffer::Reservation reservation(batch_size * Pushbuffer::MethodSize(1));
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      reservation.Push(NV097_ARRAY_ELEMENT16, *next++);
+    }
+  }
+  Pushbuffer::End();
+}
+
+// Runs the given writer `iterations` times and returns the average time per iteration in microseconds. The dwords
+// produced by the final iteration are left in the recorder.
+template <typename Writer>
+static double Measure(RecordingPushbufferBackend &recorder, uint32_t iterations, Writer writer) {
+  std::chrono::steady_clock::duration total{};
+  for (uint32_t i = 0; i < iterations; ++i) {
+    recorder.Clear();
+    auto start = std::chrono::steady_clock::now();
+    writer();
+    total += std::chrono::steady_clock::now() - start;
+  }
+  return std::chrono::duration<double, std::micro>(total).count() / iterations;
+}
+
+// Benchmarks both writers, checking that they produce identical dwords.
+template <typename PushWriter, typename ReserveWriter>
+static void Compare(const char *name, RecordingPushbufferBackend &recorder, uint32_t iterations, PushWriter push,
+                    ReserveWriter reserve) {
+  auto push_us = Measure(recorder, iterations, push);
+  auto push_dwords = recorder.GetDwords();
+  auto reserve_us = Measure(recorder, iterations, reserve);
+  HOST_CHECK(recorder.GetDwords() == push_dwords);
+
+  printf("%-14s Push*: %9.1f us  Reservation: %9.1f us  (%.2fx)\n", name, push_us, reserve_us, push_us / reserve_us);
+}
+
+int main(int argc, char **argv) {
+  uint32_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 0) : 1000;
+  if (!iterations) {
+    iterations = 1;
+  }
+
+  Pushbuffer::Initialize();
+  auto recorder = std::make_shared<RecordingPushbufferBackend>();
+  Pushbuffer::SetBackend(recorder);
+  Pushbuffer::SetCoalescingEnabled(false);
+  Pushbuffer::SetRedundantWriteFilterEnabled(false);
+
+  std::vector<uint32_t> vertices(kNumVertices * kVertexDwords);
+  for (uint32_t i = 0; i < vertices.size(); ++i) {
+    vertices[i] = i * 0x9E3779B9;
+  }
+  std::vector<uint32_t> index_pairs(kNumVertices);
+  for (uint32_t i = 0; i < kNumVertices; ++i) {
+    index_pairs[i] = ((i * 2 + 1) << 16) | (i * 2);
+  }
+
+  printf("%u iterations of %u vertices\n", iterations, kNumVertices);
+  Compare(
+      "InlineArray", *recorder, iterations, [&vertices] { PushInlineArray(vertices); },
+      [&vertices] { ReserveInlineArray(vertices); });
+  Compare(
+      "ArrayElement16", *recorder, iterations, [&index_pairs] { PushElements(index_pairs); },
+      [&index_pairs] { ReserveElements(index_pairs); });
+
+  return HostTestResult("reservation_benchmark");
+}
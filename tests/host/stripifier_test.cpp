@@ -0,0 +1,104 @@
+// Checks that Stripifier produces strips that draw exactly the input triangles with their original winding.
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "host_test.h"
+#include "stripifier.h"
+
+using namespace PBKitPlusPlus;
+
+typedef std::array<uint32_t, 3> Triangle;
+
+// Rotates a triangle so that its smallest index comes first, which preserves its winding.
+static Triangle Canonical(Triangle triangle) {
+  std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+  return triangle;
+}
+
+static bool IsDegenerate(const Triangle &t) { return t[0] == t[1] || t[1] == t[2] || t[0] == t[2]; }
+
+// Returns the sorted, canonical triangles of a triangle list.
+static std::vector<Triangle> ListTriangles(const std::vector<uint32_t> &indices) {
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    triangles.push_back(Canonical({indices[i], indices[i + 1], indices[i + 2]}));
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+// Expands a strip the way the nv2a draws it, with every odd triangle's first two vertices swapped to keep the winding
+// consistent. Degenerate triangles are counted but not returned.
+static std::vector<Triangle> StripTriangles(const std::vector<uint32_t> &strip, uint32_t *num_degenerate) {
+  std::vector<Triangle> triangles;
+  *num_degenerate = 0;
+  for (size_t i = 0; i + 2 < strip.size(); ++i) {
+    Triangle triangle = i & 1 ? Triangle{strip[i + 1], strip[i], strip[i + 2]}
+                              : Triangle{strip[i], strip[i + 1], strip[i + 2]};
+    if (IsDegenerate(triangle)) {
+      ++*num_degenerate;
+      continue;
+    }
+    triangles.push_back(Canonical(triangle));
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+static void TestGridWindingIsPreserved() {
+  // A 4x4 grid of quads, with the two triangles of each quad wound in opposite directions through the strip.
+  std::vector<uint32_t> indices;
+  for (uint32_t y = 0; y < 4; ++y) {
+    for (uint32_t x = 0; x < 4; ++x) {
+      uint32_t ul = y * 5 + x;
+      uint32_t ll = ul + 5;
+      indices.insert(indices.end(), {ul, ll, ul + 1, ul + 1, ll, ll + 1});
+    }
+  }
+
+  Stripifier::Stats stats;
+  auto strip = Stripifier::Stripify(indices.data(), static_cast<uint32_t>(indices.size()), 25, &stats);
+
+  uint32_t num_degenerate;
+  HOST_CHECK(StripTriangles(strip, &num_degenerate) == ListTriangles(indices));
+  HOST_CHECK_EQ(num_degenerate, stats.degenerate_triangles);
+  HOST_CHECK_EQ(stats.triangles, 32u);
+  HOST_CHECK_EQ(stats.list_vertices, 96u);
+  HOST_CHECK_EQ(stats.strip_vertices, static_cast<uint32_t>(strip.size()));
+  HOST_CHECK(stats.strip_vertices < stats.list_vertices);
+}
+
+static void TestSeparateStripsAreJoinedWithDegenerates() {
+  // Two triangles that share no edge, the second of which would be drawn at an odd position if simply appended.
+  const std::vector<uint32_t> indices = {0, 1, 2, 3, 4, 5};
+
+  Stripifier::Stats stats;
+  auto strip = Stripifier::Stripify(indices.data(), static_cast<uint32_t>(indices.size()), 6, &stats);
+
+  uint32_t num_degenerate;
+  HOST_CHECK(StripTriangles(strip, &num_degenerate) == ListTriangles(indices));
+  HOST_CHECK_EQ(stats.strips, 2u);
+  HOST_CHECK(stats.degenerate_triangles > 0);
+  HOST_CHECK_EQ(num_degenerate, stats.degenerate_triangles);
+  HOST_CHECK_EQ(stats.degenerate_triangles, static_cast<uint32_t>(strip.size()) - 2 - 2);
+}
+
+static void TestDegenerateInputIsDropped() {
+  const std::vector<uint32_t> indices = {0, 1, 2, 2, 2, 3};
+
+  Stripifier::Stats stats;
+  auto strip = Stripifier::Stripify(indices.data(), static_cast<uint32_t>(indices.size()), 4, &stats);
+
+  HOST_CHECK_EQ(stats.triangles, 1u);
+  HOST_CHECK(strip == (std::vector<uint32_t>{0, 1, 2}));
+}
+
+int main() {
+  TestGridWindingIsPreserved();
+  TestSeparateStripsAreJoinedWithDegenerates();
+  TestDegenerateInputIsDropped();
+
+  return HostTestResult("stripifier_test");
+}
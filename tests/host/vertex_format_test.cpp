@@ -0,0 +1,101 @@
+// Checks the packed vertex attribute encodings in vertex_packing.h and the resulting VertexFormat layouts.
+
+#include <cmath>
+#include <cstring>
+
+#include "host_test.h"
+#include "nxdk_ext.h"
+#include "vertex_format.h"
+#include "vertex_packing.h"
+
+using namespace PBKitPlusPlus;
+using namespace VertexPacking;
+
+static bool Near(float a, float b) { return std::fabs(a - b) < 1.0f / 256.0f; }
+
+static void TestPackNormalCMP() {
+  // X occupies the low 11 bits, Y the next 11 and Z the top 10.
+  HOST_CHECK_EQ(PackNormalCMP(1.0f, 0.0f, 0.0f), 0x3FFu);
+  HOST_CHECK_EQ(PackNormalCMP(0.0f, 1.0f, 0.0f), 0x3FFu << 11);
+  HOST_CHECK_EQ(PackNormalCMP(0.0f, 0.0f, 1.0f), 0x1FFu << 22);
+  HOST_CHECK_EQ(PackNormalCMP(-1.0f, 0.0f, 0.0f), 0x401u);
+  HOST_CHECK_EQ(PackNormalCMP(0.0f, 0.0f, -1.0f), 0x201u << 22);
+  HOST_CHECK_EQ(PackNormalCMP(2.0f, -2.0f, 0.0f), PackNormalCMP(1.0f, -1.0f, 0.0f));
+
+  // Negative components must be sign extended from their field width.
+  float xyz[3];
+  UnpackNormalCMP(0x401u | (0x401u << 11) | (0x201u << 22), xyz);
+  HOST_CHECK(xyz[0] == -1.0f && xyz[1] == -1.0f && xyz[2] == -1.0f);
+
+  UnpackNormalCMP(PackNormalCMP(-0.5f, 0.25f, -0.75f), xyz);
+  HOST_CHECK(Near(xyz[0], -0.5f) && Near(xyz[1], 0.25f) && Near(xyz[2], -0.75f));
+}
+
+static void TestPackColor() {
+  // D3DCOLOR has B in the low byte, whereas OGL has R there.
+  HOST_CHECK_EQ(PackColorD3D(0.0f, 0.0f, 1.0f, 0.0f), 0x000000FFu);
+  HOST_CHECK_EQ(PackColorD3D(1.0f, 0.0f, 0.0f, 0.0f), 0x00FF0000u);
+  HOST_CHECK_EQ(PackColorD3D(0.0f, 1.0f, 0.0f), 0xFF00FF00u);
+  HOST_CHECK_EQ(PackColorOGL(1.0f, 0.0f, 0.0f, 0.0f), 0x000000FFu);
+  HOST_CHECK_EQ(PackColorOGL(0.0f, 0.0f, 1.0f, 0.0f), 0x00FF0000u);
+  HOST_CHECK_EQ(PackUnorm8(-1.0f), 0);
+  HOST_CHECK_EQ(PackUnorm8(2.0f), 255);
+}
+
+static void TestPackShorts() {
+  HOST_CHECK_EQ(PackS1(1.0f), 32767);
+  HOST_CHECK_EQ(PackS1(2.0f), 32767);
+  HOST_CHECK_EQ(PackS1(-2.0f), -32767);
+  HOST_CHECK_EQ(PackS1(0.5f), 16384);
+  HOST_CHECK(UnpackS1(-32768) == -1.0f);
+
+  HOST_CHECK_EQ(PackS32K(40000.0f), 32767);
+  HOST_CHECK_EQ(PackS32K(-40000.0f), -32768);
+  HOST_CHECK_EQ(PackS32K(-3.6f), -4);
+  HOST_CHECK_EQ(PackS32K(3.4f), 3);
+}
+
+static void TestLayoutPadsToDwords() {
+  VertexFormat format;
+  format.SetAttribute(NV2A_VERTEX_ATTR_POSITION, 3, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K)
+      .SetAttribute(NV2A_VERTEX_ATTR_DIFFUSE, 3, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL)
+      .SetAttribute(NV2A_VERTEX_ATTR_TEXTURE0, 2);
+
+  // 6 bytes of shorts and 3 bytes of color are each padded to a whole number of dwords.
+  auto &position = format.GetAttribute(NV2A_VERTEX_ATTR_POSITION);
+  auto &diffuse = format.GetAttribute(NV2A_VERTEX_ATTR_DIFFUSE);
+  auto &texcoord = format.GetAttribute(NV2A_VERTEX_ATTR_TEXTURE0);
+  HOST_CHECK_EQ(position.offset, 0u);
+  HOST_CHECK_EQ(position.size, 8u);
+  HOST_CHECK_EQ(diffuse.offset, 8u);
+  HOST_CHECK_EQ(diffuse.size, 4u);
+  HOST_CHECK_EQ(texcoord.offset, 12u);
+  HOST_CHECK_EQ(texcoord.size, 8u);
+  HOST_CHECK_EQ(format.GetStride(), 20u);
+  HOST_CHECK_EQ(texcoord.stride, 20u);
+
+  // Padding is written as zero so that vertex data is deterministic.
+  uint8_t vertex[20];
+  memset(vertex, 0xAA, sizeof(vertex));
+  const float xyz[] = {1.0f, -2.0f, 3.0f};
+  const float rgb[] = {1.0f, 0.0f, 1.0f};
+  VertexFormat::PackAttribute(position, xyz, vertex + position.offset);
+  VertexFormat::PackAttribute(diffuse, rgb, vertex + diffuse.offset);
+  HOST_CHECK(vertex[6] == 0 && vertex[7] == 0);
+  HOST_CHECK_EQ(vertex[11], 0);
+
+  float unpacked[3];
+  VertexFormat::UnpackAttribute(position, vertex + position.offset, unpacked);
+  HOST_CHECK(unpacked[0] == 1.0f && unpacked[1] == -2.0f && unpacked[2] == 3.0f);
+  VertexFormat::UnpackAttribute(diffuse, vertex + diffuse.offset, unpacked);
+  HOST_CHECK(unpacked[0] == 1.0f && unpacked[1] == 0.0f && unpacked[2] == 1.0f);
+}
+
+int main() {
+  TestPackNormalCMP();
+  TestPackColor();
+  TestPackShorts();
+  TestLayoutPadsToDwords();
+
+  return HostTestResult("vertex_format_test");
+}
@@ -0,0 +1,13 @@
+// Host stand-in for the XboxMath types used by library headers (e.g., vertex_buffer.h), so that code under test can be
+// built without fetching the XboxMath library. Only the type definitions are provided.
+#ifndef PBKITPLUSPLUS_TESTS_HOST_XBOX_MATH_TYPES_H_
+#define PBKITPLUSPLUS_TESTS_HOST_XBOX_MATH_TYPES_H_
+
+namespace XboxMath {
+
+typedef float vector_t[4];
+typedef vector_t matrix4_t[4];
+
+}  // namespace XboxMath
+
+#endif  // PBKITPLUSPLUS_TESTS_HOST_XBOX_MATH_TYPES_H_
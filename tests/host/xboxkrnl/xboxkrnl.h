@@ -0,0 +1,16 @@
+// Host stand-in for the parts of the nxdk kernel header that are used by code under test. It is found ahead of the
+// nxdk's own header through the host test include path, and implemented in host_support.cpp.
+#ifndef PBKITPLUSPLUS_TESTS_HOST_XBOXKRNL_XBOXKRNL_H_
+#define PBKITPLUSPLUS_TESTS_HOST_XBOXKRNL_XBOXKRNL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOMBINE 0x400
+
+void *MmAllocateContiguousMemoryEx(size_t NumberOfBytes, uintptr_t LowestAcceptableAddress,
+                                   uintptr_t HighestAcceptableAddress, size_t Alignment, uint32_t Protect);
+void MmFreeContiguousMemory(void *BaseAddress);
+
+#endif  // PBKITPLUSPLUS_TESTS_HOST_XBOXKRNL_XBOXKRNL_H_
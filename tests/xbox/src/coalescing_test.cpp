@@ -0,0 +1,96 @@
+// Checks the dwords saved by coalescing the pushes made by Light::Commit and TextureStage::Commit.
+
+#include <hal/debug.h>
+#include <pbkit/pbkit.h>
+
+#include <functional>
+#include <memory>
+
+#include "light.h"
+#include "nv2astate.h"
+#include "pushbuffer.h"
+#include "recording_pushbuffer_backend.h"
+#include "texture_format.h"
+#include "xbox_test.h"
+
+namespace PBKitPlusPlus {
+
+// Records the commands generated by `commit` with and without coalescing.
+static void Record(const std::function<void()> &commit, std::vector<uint32_t> &uncoalesced,
+                   std::vector<uint32_t> &coalesced) {
+  auto recorder = std::make_shared<RecordingPushbufferBackend>();
+  Pushbuffer::SetBackend(recorder);
+  Pushbuffer::SetRedundantWriteFilterEnabled(false);
+
+  Pushbuffer::SetCoalescingEnabled(false);
+  commit();
+  uncoalesced = recorder->GetDwords();
+
+  recorder->Clear();
+  Pushbuffer::SetCoalescingEnabled(true);
+  commit();
+  coalesced = recorder->GetDwords();
+
+  Pushbuffer::SetCoalescingEnabled(false);
+  Pushbuffer::SetBackend(nullptr);
+}
+
+static void TestLightCommit(NV2AState &host) {
+  static constexpr XboxMath::vector_t kLookDirection{0.f, 0.f, 1.f, 1.f};
+
+  DirectionalLight light(0, {1.f, 0.f, 1.f, 1.f});
+  light.SetAmbient(0.1f, 0.2f, 0.3f);
+  light.SetDiffuse(0.4f, 0.5f, 0.6f);
+  light.SetSpecular(0.7f, 0.8f, 0.9f);
+
+  std::vector<uint32_t> uncoalesced;
+  std::vector<uint32_t> coalesced;
+  Record([&]() { light.Commit(host, kLookDirection); }, uncoalesced, coalesced);
+
+  XBOX_CHECK(DecodeRegisterWrites(coalesced) == DecodeRegisterWrites(uncoalesced));
+
+  // Light::Commit pushes the front and back ambient/diffuse/specular colors as two runs of three contiguous Push3F
+  // calls. DirectionalLight then pushes LOCAL_RANGE, INFINITE_HALF_VECTOR and INFINITE_DIRECTION, which are also
+  // contiguous, in a separate block.
+  XBOX_CHECK(CountMethodHeaders(uncoalesced) == 9);
+  XBOX_CHECK(CountMethodHeaders(coalesced) == 3);
+  XBOX_CHECK(uncoalesced.size() == 34);
+  XBOX_CHECK(coalesced.size() == 28);
+
+  debugPrint("DirectionalLight::Commit: %d dwords -> %d dwords\n", static_cast<int>(uncoalesced.size()),
+             static_cast<int>(coalesced.size()));
+}
+
+static void TestTextureStageCommit(NV2AState &host) {
+  host.SetTextureStageEnabled(0, true);
+  for (uint32_t i = 1; i < 4; ++i) {
+    host.SetTextureStageEnabled(i, false);
+  }
+  auto &stage = host.GetTextureStage(0);
+  stage.SetFormat(GetTextureFormatInfo(NV097_SET_TEXTURE_FORMAT_COLOR_SZ_A8R8G8B8));
+  stage.SetTextureDimensions(64, 64);
+  stage.SetTextureMatrixEnable(false);
+
+  std::vector<uint32_t> uncoalesced;
+  std::vector<uint32_t> coalesced;
+  Record([&]() { host.SetupTextureStages(); }, uncoalesced, coalesced);
+
+  XBOX_CHECK(DecodeRegisterWrites(coalesced) == DecodeRegisterWrites(uncoalesced));
+
+  // The enabled stage pushes 17 methods with 20 params. Coalesced, they form four runs: OFFSET..FILTER, IMAGE_RECT..
+  // BUMP_ENV_OFFSET, TEXTURE_MATRIX_ENABLE and TEXGEN_S..Q. Each disabled stage pushes a single method in its own block.
+  XBOX_CHECK(CountMethodHeaders(uncoalesced) == 17 + 3);
+  XBOX_CHECK(CountMethodHeaders(coalesced) == 4 + 3);
+  XBOX_CHECK(uncoalesced.size() == 37 + 3 * 2);
+  XBOX_CHECK(coalesced.size() == 24 + 3 * 2);
+
+  debugPrint("SetupTextureStages: %d dwords -> %d dwords\n", static_cast<int>(uncoalesced.size()),
+             static_cast<int>(coalesced.size()));
+}
+
+void RunCoalescingTests(NV2AState &host) {
+  TestLightCommit(host);
+  TestTextureStageCommit(host);
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,46 @@
+#ifndef XBOX
+#error Must be built with nxdk
+#endif
+
+#include <hal/debug.h>
+#include <hal/video.h>
+#include <pbkit/pbkit.h>
+#include <windows.h>
+
+#include "nv2astate.h"
+#include "xbox_test.h"
+
+static constexpr int kFramebufferWidth = 640;
+static constexpr int kFramebufferHeight = 480;
+static constexpr int kBitsPerPixel = 32;
+static constexpr int kMaxTextureSize = 256;
+
+int main() {
+  if (!XVideoSetMode(kFramebufferWidth, kFramebufferHeight, kBitsPerPixel, REFRESH_DEFAULT)) {
+    debugPrint("Failed to set video mode\n");
+    Sleep(2000);
+    return 1;
+  }
+
+  int status = pb_init();
+  if (status) {
+    debugPrint("pb_init Error %d\n", status);
+    Sleep(2000);
+    return 1;
+  }
+  pb_show_debug_screen();
+
+  PBKitPlusPlus::NV2AState state(kFramebufferWidth, kFramebufferHeight, kMaxTextureSize, kMaxTextureSize);
+
+  PBKitPlusPlus::RunCoalescingTests(state);
+
+  if (PBKitPlusPlus::xbox_test_failures) {
+    debugPrint("\n%d check(s) FAILED\n", PBKitPlusPlus::xbox_test_failures);
+  } else {
+    debugPrint("\nAll tests passed\n");
+  }
+
+  Sleep(10000);
+  pb_kill();
+  return PBKitPlusPlus::xbox_test_failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#include "xbox_test.h"
+
+#include <hal/debug.h>
+#include <windows.h>
+
+#include <cstdio>
+
+namespace PBKitPlusPlus {
+
+uint32_t xbox_test_failures = 0;
+
+void XboxTestFail(const char *condition, const char *filename, uint32_t line) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "FAILED: %s at %s:%d\n", condition, filename, line);
+  OutputDebugString(buffer);
+  debugPrint("%s", buffer);
+  ++xbox_test_failures;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> DecodeRegisterWrites(const std::vector<uint32_t> &dwords) {
+  // Bit set in a method header that causes all of its parameters to be written to the same method.
+  static constexpr uint32_t kNonIncrementingFlag = 0x40000000;
+
+  std::vector<std::pair<uint32_t, uint32_t>> ret;
+  for (uint32_t i = 0; i < dwords.size();) {
+    auto header = dwords[i++];
+    auto method = header & 0x1FFC;
+    auto num_params = (header >> 18) & 0x7FF;
+    for (uint32_t param = 0; param < num_params; ++param) {
+      ret.emplace_back(method, dwords[i++]);
+      if (!(header & kNonIncrementingFlag)) {
+        method += 4;
+      }
+    }
+  }
+  return ret;
+}
+
+uint32_t CountMethodHeaders(const std::vector<uint32_t> &dwords) {
+  uint32_t ret = 0;
+  for (uint32_t i = 0; i < dwords.size(); i += 1 + ((dwords[i] >> 18) & 0x7FF)) {
+    ++ret;
+  }
+  return ret;
+}
+
+}  // namespace PBKitPlusPlus
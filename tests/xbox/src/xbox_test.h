@@ -0,0 +1,38 @@
+#ifndef PBKITPLUSPLUS_TESTS_XBOX_XBOX_TEST_H_
+#define PBKITPLUSPLUS_TESTS_XBOX_XBOX_TEST_H_
+
+// Minimal helpers for on-target tests, which print failures to the screen.
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace PBKitPlusPlus {
+
+class NV2AState;
+
+//! Number of checks that have failed.
+extern uint32_t xbox_test_failures;
+
+//! Reports a failed check.
+void XboxTestFail(const char *condition, const char *filename, uint32_t line);
+
+//! Decodes a recorded 3D subchannel dword stream into the (method, value) pair written to each register.
+std::vector<std::pair<uint32_t, uint32_t>> DecodeRegisterWrites(const std::vector<uint32_t> &dwords);
+
+//! Returns the number of method headers in a recorded dword stream.
+uint32_t CountMethodHeaders(const std::vector<uint32_t> &dwords);
+
+//! Checks the dwords saved by coalescing in Light::Commit and TextureStage::Commit.
+void RunCoalescingTests(NV2AState &host);
+
+}  // namespace PBKitPlusPlus
+
+#define XBOX_CHECK(c)                                                  \
+  do {                                                                 \
+    if (!(c)) {                                                        \
+      PBKitPlusPlus::XboxTestFail(#c, __FILE__, __LINE__);             \
+    }                                                                  \
+  } while (false)
+
+#endif  // PBKITPLUSPLUS_TESTS_XBOX_XBOX_TEST_H_
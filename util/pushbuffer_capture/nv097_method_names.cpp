@@ -0,0 +1,239 @@
+#include "nv097_method_names.h"
+
+#include <pbkit/nv_regs.h>
+
+#include <cstdio>
+
+#include "nxdk_ext.h"
+
+namespace PBKitPlusPlus {
+
+namespace {
+
+struct MethodInfo {
+  uint32_t method;
+  //! Number of dwords in a single element of the register.
+  uint32_t num_dwords;
+  //! Number of elements in the register array.
+  uint32_t count;
+  //! Distance in bytes between consecutive elements.
+  uint32_t stride;
+  const char *name;
+};
+
+#define METHOD(name, num_dwords) {name, num_dwords, 1, 0, #name}
+#define METHOD_ARRAY(name, num_dwords, count, stride) {name, num_dwords, count, stride, #name}
+
+constexpr MethodInfo kMethods[] = {
+    METHOD(NV097_NO_OPERATION, 1),
+    METHOD(NV097_WAIT_FOR_IDLE, 1),
+    METHOD(NV097_SET_FLIP_READ, 1),
+    METHOD(NV097_FLIP_STALL, 1),
+    METHOD(NV097_SET_CONTEXT_DMA_A, 1),
+    METHOD(NV097_SET_CONTEXT_DMA_COLOR, 1),
+    METHOD(NV097_SET_CONTEXT_DMA_SEMAPHORE, 1),
+    METHOD(NV097_SET_SURFACE_CLIP_HORIZONTAL, 1),
+    METHOD(NV097_SET_SURFACE_CLIP_VERTICAL, 1),
+    METHOD(NV097_SET_SURFACE_FORMAT, 1),
+    METHOD(NV097_SET_SURFACE_PITCH, 1),
+    METHOD(NV097_SET_SURFACE_COLOR_OFFSET, 1),
+    METHOD_ARRAY(NV097_SET_COMBINER_ALPHA_ICW, 1, 8, 4),
+    METHOD(NV097_SET_COMBINER_SPECULAR_FOG_CW0, 1),
+    METHOD(NV097_SET_COMBINER_SPECULAR_FOG_CW1, 1),
+    METHOD(NV097_SET_CONTROL0, 1),
+    METHOD(NV097_SET_WINDOW_CLIP_TYPE, 1),
+    METHOD_ARRAY(NV097_SET_WINDOW_CLIP_HORIZONTAL, 1, 8, 4),
+    METHOD_ARRAY(NV097_SET_WINDOW_CLIP_VERTICAL, 1, 8, 4),
+    METHOD(NV097_SET_ALPHA_TEST_ENABLE, 1),
+    METHOD(NV097_SET_BLEND_ENABLE, 1),
+    METHOD(NV097_SET_LIGHTING_ENABLE, 1),
+    METHOD(NV097_SET_SPECULAR_ENABLE, 1),
+    METHOD(NV097_SET_ALPHA_FUNC, 1),
+    METHOD(NV097_SET_ALPHA_REF, 1),
+    METHOD(NV097_SET_BLEND_FUNC_SFACTOR, 1),
+    METHOD(NV097_SET_BLEND_FUNC_DFACTOR, 1),
+    METHOD(NV097_SET_BLEND_COLOR, 1),
+    METHOD(NV097_SET_BLEND_EQUATION, 1),
+    METHOD(NV097_SET_COLOR_MASK, 1),
+    METHOD(NV097_SET_SWATH_WIDTH, 1),
+    METHOD(NV097_SET_SMOOTHING_CONTROL, 1),
+    METHOD(NV097_SET_SHADER_CLIP_PLANE_MODE, 1),
+    METHOD(NV097_SET_SHADER_STAGE_PROGRAM, 1),
+    METHOD(NV097_SET_SHADER_OTHER_STAGE_INPUT, 1),
+    METHOD(NV097_SET_SPECULAR_FOG_FACTOR, 2),
+    METHOD(NV097_SET_SPECULAR_PARAMS, 6),
+    METHOD(NV097_SET_SCENE_AMBIENT_COLOR_BACK, 3),
+    METHOD(NV097_SET_MATERIAL_EMISSION_BACK, 3),
+    METHOD(NV097_SET_MATERIAL_ALPHA_BACK, 1),
+    METHOD_ARRAY(NV097_SET_TEXGEN_S, 1, 4, 0x10),
+    METHOD_ARRAY(NV097_SET_TEXGEN_T, 1, 4, 0x10),
+    METHOD_ARRAY(NV097_SET_TEXGEN_R, 1, 4, 0x10),
+    METHOD_ARRAY(NV097_SET_TEXGEN_Q, 1, 4, 0x10),
+    METHOD_ARRAY(NV097_SET_TEXTURE_MATRIX_ENABLE, 1, 4, 4),
+    METHOD(NV097_SET_POINT_SIZE, 1),
+    METHOD_ARRAY(NV097_SET_MODEL_VIEW_MATRIX, 16, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_INVERSE_MODEL_VIEW_MATRIX, 16, 4, 0x40),
+    METHOD(NV097_SET_COMPOSITE_MATRIX, 16),
+    METHOD_ARRAY(NV097_SET_TEXTURE_MATRIX, 16, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_BACK_LIGHT_AMBIENT_COLOR, 3, 8, 0x40),
+    METHOD_ARRAY(NV097_SET_BACK_LIGHT_DIFFUSE_COLOR, 3, 8, 0x40),
+    METHOD_ARRAY(NV097_SET_BACK_LIGHT_SPECULAR_COLOR, 3, 8, 0x40),
+    METHOD_ARRAY(NV097_SET_LIGHT_AMBIENT_COLOR, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_DIFFUSE_COLOR, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_SPECULAR_COLOR, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_LOCAL_RANGE, 1, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_INFINITE_HALF_VECTOR, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_INFINITE_DIRECTION, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_SPOT_FALLOFF, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_SPOT_DIRECTION, 4, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_LOCAL_POSITION, 3, 8, 0x80),
+    METHOD_ARRAY(NV097_SET_LIGHT_LOCAL_ATTENUATION, 3, 8, 0x80),
+    METHOD(NV097_SET_CLIP_MIN, 1),
+    METHOD(NV097_SET_CLIP_MAX, 1),
+    METHOD(NV097_SET_VIEWPORT_OFFSET, 4),
+    METHOD(NV097_SET_VIEWPORT_SCALE, 4),
+    METHOD_ARRAY(NV097_SET_COMBINER_FACTOR0, 1, 8, 4),
+    METHOD_ARRAY(NV097_SET_COMBINER_FACTOR1, 1, 8, 4),
+    METHOD_ARRAY(NV097_SET_COMBINER_ALPHA_OCW, 1, 8, 4),
+    METHOD_ARRAY(NV097_SET_COMBINER_COLOR_ICW, 1, 8, 4),
+    METHOD_ARRAY(NV097_SET_COMBINER_COLOR_OCW, 1, 8, 4),
+    METHOD(NV097_SET_COMBINER_CONTROL, 1),
+    METHOD(NV097_SET_TRANSFORM_EXECUTION_MODE, 1),
+    METHOD(NV097_SET_TRANSFORM_PROGRAM_CXT_WRITE_EN, 1),
+    METHOD(NV097_SET_TRANSFORM_PROGRAM_LOAD, 1),
+    METHOD(NV097_SET_TRANSFORM_PROGRAM_START, 1),
+    METHOD(NV097_SET_TRANSFORM_CONSTANT_LOAD, 1),
+    METHOD(NV097_SET_TRANSFORM_PROGRAM, 32),
+    METHOD(NV097_SET_TRANSFORM_CONSTANT, 32),
+    METHOD(NV097_SET_VERTEX3F, 3),
+    METHOD(NV097_SET_VERTEX4F, 4),
+    METHOD(NV097_SET_VERTEX4S, 2),
+    METHOD(NV097_SET_NORMAL3F, 3),
+    METHOD(NV097_SET_NORMAL3S, 2),
+    METHOD(NV097_SET_DIFFUSE_COLOR4F, 4),
+    METHOD(NV097_SET_DIFFUSE_COLOR3F, 3),
+    METHOD(NV097_SET_DIFFUSE_COLOR4I, 1),
+    METHOD(NV097_SET_SPECULAR_COLOR4F, 4),
+    METHOD(NV097_SET_SPECULAR_COLOR3F, 3),
+    METHOD(NV097_SET_SPECULAR_COLOR4I, 1),
+    METHOD(NV097_SET_TEXCOORD0_2F, 2),
+    METHOD(NV097_SET_TEXCOORD0_2S, 1),
+    METHOD(NV097_SET_TEXCOORD0_4F, 4),
+    METHOD(NV097_SET_TEXCOORD0_4S, 2),
+    METHOD(NV097_SET_TEXCOORD1_2F, 2),
+    METHOD(NV097_SET_TEXCOORD1_2S, 1),
+    METHOD(NV097_SET_TEXCOORD1_4F, 4),
+    METHOD(NV097_SET_TEXCOORD1_4S, 2),
+    METHOD(NV097_SET_TEXCOORD2_2F, 2),
+    METHOD(NV097_SET_TEXCOORD2_2S, 1),
+    METHOD(NV097_SET_TEXCOORD2_4F, 4),
+    METHOD(NV097_SET_TEXCOORD2_4S, 2),
+    METHOD(NV097_SET_TEXCOORD3_2F, 2),
+    METHOD(NV097_SET_TEXCOORD3_2S, 1),
+    METHOD(NV097_SET_TEXCOORD3_4F, 4),
+    METHOD(NV097_SET_TEXCOORD3_4S, 2),
+    METHOD(NV097_SET_FOG_COORD, 1),
+    METHOD(NV097_SET_WEIGHT1F, 1),
+    METHOD(NV097_SET_WEIGHT2F, 2),
+    METHOD(NV097_SET_WEIGHT3F, 3),
+    METHOD(NV097_SET_WEIGHT4F, 4),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA_ARRAY_OFFSET, 1, 16, 4),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA_ARRAY_FORMAT, 1, 16, 4),
+    METHOD(NV097_BREAK_VERTEX_BUFFER_CACHE, 1),
+    METHOD(NV097_CLEAR_REPORT_VALUE, 1),
+    METHOD(NV097_GET_REPORT, 1),
+    METHOD(NV097_SET_BEGIN_END, 1),
+    METHOD(NV097_ARRAY_ELEMENT16, 1),
+    METHOD(NV097_ARRAY_ELEMENT32, 1),
+    METHOD(NV097_DRAW_ARRAYS, 1),
+    METHOD(NV097_INLINE_ARRAY, 1),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA2F_M, 2, 16, 8),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA2S, 1, 16, 4),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA4UB, 1, 16, 4),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA4S_M, 2, 16, 8),
+    METHOD_ARRAY(NV097_SET_VERTEX_DATA4F_M, 4, 16, 16),
+    METHOD_ARRAY(NV097_SET_TEXTURE_OFFSET, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_FORMAT, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_ADDRESS, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_CONTROL0, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_CONTROL1, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_FILTER, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_IMAGE_RECT, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_PALETTE, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_BORDER_COLOR, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_SET_BUMP_ENV_MAT, 4, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_SET_BUMP_ENV_SCALE, 1, 4, 0x40),
+    METHOD_ARRAY(NV097_SET_TEXTURE_SET_BUMP_ENV_OFFSET, 1, 4, 0x40),
+    METHOD(NV097_SET_SEMAPHORE_OFFSET, 1),
+    METHOD(NV097_BACK_END_WRITE_SEMAPHORE_RELEASE, 1),
+    METHOD(NV097_CLEAR_SURFACE, 1),
+};
+
+#undef METHOD
+#undef METHOD_ARRAY
+
+// Finds the register containing the given method, returning its table entry and setting element/offset to the array
+// index and byte offset within the element.
+const MethodInfo *Find(uint32_t method, uint32_t &element, uint32_t &offset) {
+  for (auto &info : kMethods) {
+    if (method < info.method) {
+      continue;
+    }
+
+    auto delta = method - info.method;
+    auto index = info.stride ? delta / info.stride : 0;
+    if (index >= info.count) {
+      continue;
+    }
+
+    auto within = info.stride ? delta % info.stride : delta;
+    if (within < info.num_dwords * 4) {
+      element = index;
+      offset = within;
+      return &info;
+    }
+  }
+
+  return nullptr;
+}
+
+}  // namespace
+
+std::string GetNV097MethodName(uint32_t method) {
+  uint32_t element;
+  uint32_t offset;
+  auto info = Find(method, element, offset);
+
+  char buffer[128];
+  if (!info) {
+    snprintf(buffer, sizeof(buffer), "0x%04X", method);
+    return buffer;
+  }
+
+  std::string ret = info->name;
+  if (info->count > 1) {
+    snprintf(buffer, sizeof(buffer), "[%u]", element);
+    ret += buffer;
+  }
+  if (offset) {
+    snprintf(buffer, sizeof(buffer), "+0x%X", offset);
+    ret += buffer;
+  }
+  return ret;
+}
+
+bool LookupNV097Method(uint32_t method, uint32_t *base_method) {
+  uint32_t element;
+  uint32_t offset;
+  auto info = Find(method, element, offset);
+  if (!info) {
+    return false;
+  }
+
+  if (base_method) {
+    *base_method = info->method + element * info->stride;
+  }
+  return true;
+}
+
+}  // namespace PBKitPlusPlus
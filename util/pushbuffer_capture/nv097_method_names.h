@@ -0,0 +1,24 @@
+#ifndef PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_NV097_METHOD_NAMES_H_
+#define PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_NV097_METHOD_NAMES_H_
+
+#include <cstdint>
+#include <string>
+
+namespace PBKitPlusPlus {
+
+//! Returns the symbolic name of the given NV097 (Kelvin) method, as defined in pbkit's nv_regs.h.
+//!
+//! Methods that are part of an array (e.g., per texture stage or per light) are suffixed with the element index, and
+//! methods that fall within a multi-dword register (e.g., the second column of a matrix) are suffixed with their byte
+//! offset. E.g., "NV097_SET_TEXTURE_OFFSET[1]" or "NV097_SET_MODEL_VIEW_MATRIX[0]+0x10".
+//!
+//! Unknown methods are returned as a hex string.
+std::string GetNV097MethodName(uint32_t method);
+
+//! Returns true if the given method is recognized by GetNV097MethodName. If `base_method` is not null, it is set to the
+//! first method of the register (or register array element) containing `method`.
+bool LookupNV097Method(uint32_t method, uint32_t *base_method = nullptr);
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_NV097_METHOD_NAMES_H_
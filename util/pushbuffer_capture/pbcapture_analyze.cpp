@@ -0,0 +1,101 @@
+// Reports per-frame statistics for a pushbuffer capture along with an estimate of the GPU front end and transfer cost
+// of each frame. Intended for comparing rendering strategies without running on hardware.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "pushbuffer_capture_reader.h"
+#include "pushbuffer_trace_analyzer.h"
+
+using namespace PBKitPlusPlus;
+
+// pbkit binds the 3D (Kelvin) object to subchannel 0.
+static constexpr uint32_t kDefault3DSubchannel = 0;
+
+static void PrintUsage(const char *program) {
+  fprintf(stderr, "Usage: %s [--subch3d <subchannel>] [--cost-model <file>] [--totals-only] <capture_file>\n", program);
+}
+
+static void PrintStats(const char *label, const PushbufferTraceFrameStats &stats, const PushbufferCostModel &model) {
+  auto cost = PushbufferTraceAnalyzer::EstimateCost(stats, model);
+
+  printf("%s\n", label);
+  printf("  blocks: %u  dwords: %llu  method headers: %llu  calls: %u  flushes: %u  wraps: %u\n", stats.blocks,
+         static_cast<unsigned long long>(stats.dwords), static_cast<unsigned long long>(stats.method_headers),
+         stats.calls, stats.flushes, stats.wraps);
+  printf("  draws: %u  vertices: %llu (draw arrays: %llu  inline array: %llu  inline elements: %llu  immediate: %llu)\n",
+         stats.draws, static_cast<unsigned long long>(stats.GetTotalVertices()),
+         static_cast<unsigned long long>(stats.draw_arrays_vertices),
+         static_cast<unsigned long long>(stats.inline_array_vertices),
+         static_cast<unsigned long long>(stats.inline_element_vertices),
+         static_cast<unsigned long long>(stats.immediate_vertices));
+  printf("  state changes: %llu  redundant: %llu\n", static_cast<unsigned long long>(stats.state_changes),
+         static_cast<unsigned long long>(stats.redundant_writes));
+  printf("  inline data bytes: %llu (array: %llu  elements: %llu  immediate: %llu)  vertex fetch bytes: %llu\n",
+         static_cast<unsigned long long>(stats.GetInlineDataBytes()),
+         static_cast<unsigned long long>(stats.inline_array_bytes),
+         static_cast<unsigned long long>(stats.inline_element_bytes),
+         static_cast<unsigned long long>(stats.immediate_bytes),
+         static_cast<unsigned long long>(stats.vertex_fetch_bytes));
+  printf("  estimated cycles: %.0f (front end: %.0f  transfer: %.0f)\n", cost.GetTotalCycles(), cost.front_end_cycles,
+         cost.transfer_cycles);
+}
+
+int main(int argc, char **argv) {
+  uint32_t subchannel_3d = kDefault3DSubchannel;
+  const char *cost_model_filename = nullptr;
+  bool totals_only = false;
+  const char *filename = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--subch3d") && i + 1 < argc) {
+      subchannel_3d = strtoul(argv[++i], nullptr, 0);
+    } else if (!strcmp(argv[i], "--cost-model") && i + 1 < argc) {
+      cost_model_filename = argv[++i];
+    } else if (!strcmp(argv[i], "--totals-only")) {
+      totals_only = true;
+    } else if (!filename) {
+      filename = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!filename) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  PushbufferCostModel model;
+  if (cost_model_filename) {
+    std::string error;
+    if (!model.LoadFile(cost_model_filename, error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+  }
+
+  PushbufferCaptureReader reader;
+  if (!reader.LoadFile(filename)) {
+    fprintf(stderr, "%s\n", reader.GetError().c_str());
+    return 1;
+  }
+
+  PushbufferTraceAnalyzer analyzer(subchannel_3d);
+  analyzer.Analyze(reader.GetEntries());
+
+  if (!totals_only) {
+    auto &frames = analyzer.GetFrames();
+    for (uint32_t i = 0; i < frames.size(); ++i) {
+      char label[32];
+      snprintf(label, sizeof(label), "FRAME %u", i);
+      PrintStats(label, frames[i], model);
+    }
+  }
+
+  PrintStats("TOTAL", analyzer.GetTotals(), model);
+
+  return 0;
+}
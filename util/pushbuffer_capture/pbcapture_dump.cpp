@@ -0,0 +1,111 @@
+// Prints the contents of a pushbuffer capture in a human readable form, one entry per line. The output is stable across
+// runs so that captures from different library versions may be compared with standard diff tools.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "nv097_method_names.h"
+#include "pushbuffer_capture_reader.h"
+
+using namespace PBKitPlusPlus;
+
+// pbkit binds the 3D (Kelvin) object to subchannel 0.
+static constexpr uint32_t kDefault3DSubchannel = 0;
+
+static void PrintUsage(const char *program) {
+  fprintf(stderr, "Usage: %s [--subch3d <subchannel>] <capture_file>\n", program);
+}
+
+int main(int argc, char **argv) {
+  uint32_t subchannel_3d = kDefault3DSubchannel;
+  const char *filename = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--subch3d") && i + 1 < argc) {
+      subchannel_3d = strtoul(argv[++i], nullptr, 0);
+    } else if (!filename) {
+      filename = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!filename) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  PushbufferCaptureReader reader;
+  if (!reader.LoadFile(filename)) {
+    fprintf(stderr, "%s\n", reader.GetError().c_str());
+    return 1;
+  }
+
+  uint32_t current_tag = 0;
+  for (auto &entry : reader.GetEntries()) {
+    if (entry.tag != current_tag && entry.type != PushbufferCaptureEntry::BLOCK) {
+      current_tag = entry.tag;
+      printf("  TAG %s\n", current_tag ? reader.GetTagName(current_tag).c_str() : "(none)");
+    }
+
+    switch (entry.type) {
+      case PushbufferCaptureEntry::BLOCK:
+        printf("BLOCK %u (%u dwords)\n", entry.block, entry.value);
+        break;
+
+      case PushbufferCaptureEntry::METHOD: {
+        auto name = entry.subchannel == subchannel_3d ? GetNV097MethodName(entry.method) : std::string();
+        if (name.empty()) {
+          char buffer[32];
+          snprintf(buffer, sizeof(buffer), "subch%u:0x%04X", entry.subchannel, entry.method);
+          name = buffer;
+        }
+        printf("  %s%s", name.c_str(), entry.non_incrementing ? " (non-incrementing)" : "");
+        for (auto param : entry.params) {
+          printf(" 0x%08X", param);
+        }
+        printf("\n");
+      } break;
+
+      case PushbufferCaptureEntry::JUMP:
+        printf("  JUMP 0x%08X\n", entry.value);
+        break;
+
+      case PushbufferCaptureEntry::CALL:
+        if (entry.num_indices) {
+          printf("  CALL 0x%08X (%u indices)\n", entry.value, entry.num_indices);
+        } else {
+          printf("  CALL 0x%08X\n", entry.value);
+        }
+        break;
+
+      case PushbufferCaptureEntry::RETURN:
+        printf("  RETURN\n");
+        break;
+
+      case PushbufferCaptureEntry::FLUSH:
+        printf("FLUSH\n");
+        break;
+
+      case PushbufferCaptureEntry::WRAP:
+        printf("WRAP\n");
+        break;
+
+      case PushbufferCaptureEntry::FRAME_END:
+        printf("FRAME_END\n");
+        break;
+
+      case PushbufferCaptureEntry::INVALIDATE:
+        printf("INVALIDATE\n");
+        break;
+
+      case PushbufferCaptureEntry::UNKNOWN:
+        printf("  UNKNOWN 0x%08X\n", entry.value);
+        break;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Lists the register writes in a pushbuffer capture that leave the NV097 state unchanged, grouped by the call site that
+// issued them. Call sites are only available for captures made with PBKPP_INSTRUMENTATION enabled.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "nv097_method_names.h"
+#include "pushbuffer_capture_reader.h"
+#include "redundant_state_analyzer.h"
+
+using namespace PBKitPlusPlus;
+
+// pbkit binds the 3D (Kelvin) object to subchannel 0.
+static constexpr uint32_t kDefault3DSubchannel = 0;
+
+static void PrintUsage(const char *program) {
+  fprintf(stderr, "Usage: %s [--subch3d <subchannel>] [--limit <count>] <capture_file>\n", program);
+}
+
+static const char *GetTagLabel(const PushbufferCaptureReader &reader, uint32_t tag) {
+  return tag ? reader.GetTagName(tag).c_str() : "(untagged)";
+}
+
+int main(int argc, char **argv) {
+  uint32_t subchannel_3d = kDefault3DSubchannel;
+  uint32_t limit = 0;
+  const char *filename = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--subch3d") && i + 1 < argc) {
+      subchannel_3d = strtoul(argv[++i], nullptr, 0);
+    } else if (!strcmp(argv[i], "--limit") && i + 1 < argc) {
+      limit = strtoul(argv[++i], nullptr, 0);
+    } else if (!filename) {
+      filename = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!filename) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  PushbufferCaptureReader reader;
+  if (!reader.LoadFile(filename)) {
+    fprintf(stderr, "%s\n", reader.GetError().c_str());
+    return 1;
+  }
+
+  RedundantStateAnalyzer analyzer(subchannel_3d);
+  analyzer.Analyze(reader.GetEntries());
+
+  printf("%llu of %llu state writes were redundant\n",
+         static_cast<unsigned long long>(analyzer.GetTotalRedundantWrites()),
+         static_cast<unsigned long long>(analyzer.GetTotalWrites()));
+
+  printf("\nBy call site:\n");
+  auto by_tag = analyzer.GetRedundantWritesByTag();
+  for (uint32_t tag = 0; tag < by_tag.size(); ++tag) {
+    if (by_tag[tag]) {
+      printf("  %10llu  %s\n", static_cast<unsigned long long>(by_tag[tag]), GetTagLabel(reader, tag));
+    }
+  }
+
+  printf("\nBy call site and method (redundant / total):\n");
+  auto sites = analyzer.GetRedundantSites();
+  uint32_t printed = 0;
+  for (auto &site : sites) {
+    if (limit && printed++ == limit) {
+      break;
+    }
+    printf("  %10llu / %-10llu %-48s %s\n", static_cast<unsigned long long>(site.redundant_writes),
+           static_cast<unsigned long long>(site.writes), GetNV097MethodName(site.method).c_str(),
+           GetTagLabel(reader, site.tag));
+  }
+
+  return 0;
+}
@@ -0,0 +1,222 @@
+#include "pushbuffer_capture_reader.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "pushbuffer_capture_format.h"
+
+namespace PBKitPlusPlus {
+
+// Pushbuffer command encodings, see xemu's pfifo implementation.
+static constexpr uint32_t kOldJumpMask = 0xE0000003;
+static constexpr uint32_t kOldJump = 0x20000000;
+static constexpr uint32_t kCommandTypeMask = 0x00000003;
+static constexpr uint32_t kJump = 0x00000001;
+static constexpr uint32_t kCall = 0x00000002;
+static constexpr uint32_t kReturn = 0x00020000;
+static constexpr uint32_t kMethodMask = 0xE0030003;
+static constexpr uint32_t kIncrementingMethod = 0x00000000;
+static constexpr uint32_t kNonIncrementingMethod = 0x40000000;
+
+bool PushbufferCaptureReader::LoadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    error_ = "Failed to open " + path;
+    return false;
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return Parse(data.data(), data.size());
+}
+
+bool PushbufferCaptureReader::Parse(const uint8_t *data, size_t size) {
+  Reset();
+
+  PushbufferCaptureFileHeader file_header;
+  if (size < sizeof(file_header)) {
+    error_ = "Capture is too small to contain a header";
+    return false;
+  }
+  memcpy(&file_header, data, sizeof(file_header));
+  if (file_header.magic != kPushbufferCaptureMagic) {
+    error_ = "Not a pushbuffer capture";
+    return false;
+  }
+  if (file_header.version != kPushbufferCaptureVersion) {
+    error_ = "Unsupported capture version " + std::to_string(file_header.version);
+    return false;
+  }
+
+  size_t offset = sizeof(file_header);
+  std::vector<uint32_t> payload;
+  while (offset < size) {
+    PushbufferCaptureRecordHeader record;
+    if (size - offset < sizeof(record)) {
+      error_ = "Truncated record header at offset " + std::to_string(offset);
+      return false;
+    }
+    memcpy(&record, data + offset, sizeof(record));
+    offset += sizeof(record);
+
+    const size_t payload_size = static_cast<size_t>(record.num_dwords) * sizeof(uint32_t);
+    if (size - offset < payload_size) {
+      error_ = "Truncated record payload at offset " + std::to_string(offset);
+      return false;
+    }
+
+    switch (record.type) {
+      case CAPTURE_RECORD_BLOCK:
+        payload.resize(record.num_dwords);
+        memcpy(payload.data(), data + offset, payload_size);
+        DecodeBlock(payload.data(), record.num_dwords);
+        break;
+
+      case CAPTURE_RECORD_FLUSH:
+        AppendMarker(PushbufferCaptureEntry::FLUSH);
+        break;
+
+      case CAPTURE_RECORD_WRAP:
+        AppendMarker(PushbufferCaptureEntry::WRAP);
+        break;
+
+      case CAPTURE_RECORD_TAG: {
+        if (!record.num_dwords) {
+          error_ = "Empty tag record at offset " + std::to_string(offset);
+          return false;
+        }
+        uint32_t tag_offset;
+        memcpy(&tag_offset, data + offset, sizeof(tag_offset));
+        auto name = reinterpret_cast<const char *>(data + offset + sizeof(tag_offset));
+        auto name_length = strnlen(name, payload_size - sizeof(tag_offset));
+        pending_tags_.push_back({tag_offset, InternTag(std::string(name, name_length))});
+      } break;
+
+      case CAPTURE_RECORD_FRAME_END:
+        AppendMarker(PushbufferCaptureEntry::FRAME_END);
+        break;
+
+      case CAPTURE_RECORD_INVALIDATE:
+        AppendMarker(PushbufferCaptureEntry::INVALIDATE);
+        break;
+
+      case CAPTURE_RECORD_CALL_INDICES: {
+        if (record.num_dwords < 2) {
+          error_ = "Truncated call indices record at offset " + std::to_string(offset);
+          return false;
+        }
+        PendingCallIndices pending;
+        memcpy(&pending, data + offset, sizeof(pending));
+        pending_call_indices_.push_back(pending);
+      } break;
+
+      default:
+        // Unknown records are skipped to allow the format to be extended.
+        break;
+    }
+
+    offset += payload_size;
+  }
+
+  return true;
+}
+
+void PushbufferCaptureReader::ParseDwords(const uint32_t *dwords, size_t num_dwords) {
+  Reset();
+
+  DecodeBlock(dwords, static_cast<uint32_t>(num_dwords));
+}
+
+void PushbufferCaptureReader::AppendMarker(PushbufferCaptureEntry::Type type) {
+  PushbufferCaptureEntry entry{type, block_count_ ? block_count_ - 1 : 0};
+  entry.tag = current_tag_;
+  entries_.push_back(entry);
+}
+
+void PushbufferCaptureReader::Reset() {
+  entries_.clear();
+  block_count_ = 0;
+  error_.clear();
+  tag_names_.assign(1, std::string());
+  pending_tags_.clear();
+  pending_call_indices_.clear();
+  current_tag_ = 0;
+}
+
+uint32_t PushbufferCaptureReader::InternTag(const std::string &name) {
+  for (uint32_t i = 0; i < tag_names_.size(); ++i) {
+    if (tag_names_[i] == name) {
+      return i;
+    }
+  }
+  tag_names_.push_back(name);
+  return static_cast<uint32_t>(tag_names_.size() - 1);
+}
+
+void PushbufferCaptureReader::ApplyPendingTags(uint32_t offset) {
+  uint32_t applied = 0;
+  while (applied < pending_tags_.size() && pending_tags_[applied].offset <= offset) {
+    current_tag_ = pending_tags_[applied++].tag;
+  }
+  pending_tags_.erase(pending_tags_.begin(), pending_tags_.begin() + applied);
+}
+
+void PushbufferCaptureReader::DecodeBlock(const uint32_t *dwords, uint32_t num_dwords) {
+  const uint32_t block = block_count_++;
+
+  PushbufferCaptureEntry block_entry{PushbufferCaptureEntry::BLOCK, block};
+  block_entry.value = num_dwords;
+  entries_.push_back(block_entry);
+
+  uint32_t index = 0;
+  while (index < num_dwords) {
+    ApplyPendingTags(index);
+
+    const uint32_t command = dwords[index++];
+    PushbufferCaptureEntry entry{PushbufferCaptureEntry::UNKNOWN, block};
+    entry.value = command;
+    entry.tag = current_tag_;
+
+    if ((command & kOldJumpMask) == kOldJump) {
+      entry.type = PushbufferCaptureEntry::JUMP;
+      entry.value = command & ~kOldJumpMask;
+    } else if ((command & kCommandTypeMask) == kJump) {
+      entry.type = PushbufferCaptureEntry::JUMP;
+      entry.value = command & ~kCommandTypeMask;
+    } else if ((command & kCommandTypeMask) == kCall) {
+      entry.type = PushbufferCaptureEntry::CALL;
+      entry.value = command & ~kCommandTypeMask;
+      for (auto &pending : pending_call_indices_) {
+        if (pending.offset == index - 1) {
+          entry.num_indices = pending.num_indices;
+        }
+      }
+    } else if (command == kReturn) {
+      entry.type = PushbufferCaptureEntry::RETURN;
+      entry.value = 0;
+    } else if ((command & kMethodMask) == kIncrementingMethod || (command & kMethodMask) == kNonIncrementingMethod) {
+      const uint32_t num_params = (command >> 18) & 0x7FF;
+      if (num_params > num_dwords - index) {
+        // The method runs past the end of the block, which Pushbuffer never produces.
+        entries_.push_back(entry);
+        break;
+      }
+
+      entry.type = PushbufferCaptureEntry::METHOD;
+      entry.value = 0;
+      entry.subchannel = (command >> 13) & 0x07;
+      entry.method = command & 0x1FFC;
+      entry.non_incrementing = (command & kMethodMask) == kNonIncrementingMethod;
+      entry.params.assign(dwords + index, dwords + index + num_params);
+      index += num_params;
+    }
+
+    entries_.push_back(std::move(entry));
+  }
+
+  // Tags placed at the end of the block apply to the blocks that follow.
+  ApplyPendingTags(UINT32_MAX);
+  pending_call_indices_.clear();
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,124 @@
+#ifndef PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_PUSHBUFFER_CAPTURE_READER_H_
+#define PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_PUSHBUFFER_CAPTURE_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PBKitPlusPlus {
+
+//! A single decoded element of a pushbuffer capture.
+struct PushbufferCaptureEntry {
+  enum Type {
+    //! The start of a pushbuffer block. `value` holds the number of dwords in the block.
+    BLOCK,
+    //! A method header and its parameters.
+    METHOD,
+    //! A jump command. `value` holds the target address.
+    JUMP,
+    //! A subroutine call command. `value` holds the target address and `num_indices` the number of vertex indices
+    //! submitted by the subroutine, if known.
+    CALL,
+    //! A subroutine return command.
+    RETURN,
+    //! The pushbuffer was drained and reset.
+    FLUSH,
+    //! The pushbuffer was wrapped back to its head without draining.
+    WRAP,
+    //! All commands for a frame have been submitted.
+    FRAME_END,
+    //! nv2a state may have been modified outside of the pushbuffer.
+    INVALIDATE,
+    //! A dword that could not be decoded. `value` holds the raw dword.
+    UNKNOWN,
+  };
+
+  Type type;
+  //! Index of the block containing this entry. Marker entries (e.g., FLUSH) refer to the most recent block.
+  uint32_t block;
+  uint32_t subchannel = 0;
+  //! The method of the first parameter (without the non-incrementing flag).
+  uint32_t method = 0;
+  //! True if all parameters are written to `method` rather than to consecutive methods.
+  bool non_incrementing = false;
+  uint32_t value = 0;
+  std::vector<uint32_t> params;
+  uint32_t num_indices = 0;
+  //! The call site that produced this entry, as an index for PushbufferCaptureReader::GetTagName. Zero if the capture
+  //! has no tag for the entry.
+  uint32_t tag = 0;
+
+  //! Returns the method that the parameter at the given index is written to.
+  [[nodiscard]] uint32_t GetParamMethod(uint32_t index) const { return non_incrementing ? method : method + index * 4; }
+};
+
+//! Parses pushbuffer captures written by CapturePushbufferBackend (see src/pushbuffer_capture_format.h).
+//!
+//! This class has no dependencies on the nxdk and is intended to be built on the host. Captures are assumed to be read
+//! on a little-endian machine.
+class PushbufferCaptureReader {
+ public:
+  //! Parses the capture file at the given path. Returns false and sets GetError on failure.
+  bool LoadFile(const std::string &path);
+
+  //! Parses an in-memory capture. Returns false and sets GetError on failure.
+  bool Parse(const uint8_t *data, size_t size);
+
+  //! Decodes a raw command stream (e.g., the contents of a RecordingPushbufferBackend or CommandList) as a single
+  //! block.
+  void ParseDwords(const uint32_t *dwords, size_t num_dwords);
+
+  //! Returns the entries decoded by the most recent successful LoadFile or Parse call.
+  [[nodiscard]] const std::vector<PushbufferCaptureEntry> &GetEntries() const { return entries_; }
+
+  //! Returns the number of blocks in the capture.
+  [[nodiscard]] uint32_t GetBlockCount() const { return block_count_; }
+
+  //! Returns the name of the call site with the given index. Index 0 is the empty string.
+  [[nodiscard]] const std::string &GetTagName(uint32_t tag) const { return tag_names_[tag]; }
+
+  //! Returns the number of distinct call site tags, including the empty tag at index 0.
+  [[nodiscard]] uint32_t GetTagCount() const { return static_cast<uint32_t>(tag_names_.size()); }
+
+  //! Returns a description of the last failure.
+  [[nodiscard]] const std::string &GetError() const { return error_; }
+
+ private:
+  struct PendingTag {
+    uint32_t offset;
+    uint32_t tag;
+  };
+
+  struct PendingCallIndices {
+    uint32_t offset;
+    uint32_t num_indices;
+  };
+
+  void Reset();
+
+  //! Appends an entry that marks an event between blocks (e.g., FLUSH).
+  void AppendMarker(PushbufferCaptureEntry::Type type);
+  void DecodeBlock(const uint32_t *dwords, uint32_t num_dwords);
+
+  //! Returns the index of the given tag name, adding it if necessary.
+  uint32_t InternTag(const std::string &name);
+
+  //! Makes current any pending tags that apply at or before the given dword offset of the block being decoded.
+  void ApplyPendingTags(uint32_t offset);
+
+  std::vector<PushbufferCaptureEntry> entries_;
+  uint32_t block_count_ = 0;
+  std::string error_;
+
+  std::vector<std::string> tag_names_{std::string()};
+  //! Tags that apply to the next block, in the order they were recorded.
+  std::vector<PendingTag> pending_tags_;
+  //! Index counts for calls in the next block.
+  std::vector<PendingCallIndices> pending_call_indices_;
+  uint32_t current_tag_ = 0;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_PUSHBUFFER_CAPTURE_READER_H_
@@ -0,0 +1,398 @@
+#include "pushbuffer_trace_analyzer.h"
+
+#include <pbkit/nv_regs.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include "nxdk_ext.h"
+
+namespace PBKitPlusPlus {
+
+namespace {
+
+// NV097_SET_VERTEX_DATA_ARRAY_FORMAT fields.
+constexpr uint32_t kArrayFormatTypeMask = 0x0000000F;
+constexpr uint32_t kArrayFormatSizeShift = 4;
+constexpr uint32_t kArrayFormatSizeMask = 0x000000F0;
+constexpr uint32_t kArrayFormatTypeUBD3D = 0;
+constexpr uint32_t kArrayFormatTypeS1 = 1;
+constexpr uint32_t kArrayFormatTypeF = 2;
+constexpr uint32_t kArrayFormatTypeUBOGL = 4;
+constexpr uint32_t kArrayFormatTypeS32K = 5;
+constexpr uint32_t kArrayFormatTypeCMP = 6;
+
+constexpr uint32_t kNumVertexAttributes = 16;
+
+// NV097_DRAW_ARRAYS encodes (count - 1) in the top byte.
+constexpr uint32_t kDrawArraysCountShift = 24;
+
+struct ImmediateMethod {
+  uint32_t method;
+  //! Size in bytes of the data for a single attribute.
+  uint32_t size;
+  //! Number of attributes addressed by the method.
+  uint32_t count;
+  //! True if the first attribute addressed by the method is the position.
+  bool addresses_position;
+};
+
+// Methods that pass vertex attributes inline. Writing the final dword of the position attribute emits a vertex, while
+// the remaining methods latch a value that is used by subsequent vertices.
+constexpr ImmediateMethod kImmediateMethods[] = {
+    {NV097_SET_VERTEX3F, 12, 1, true},
+    {NV097_SET_VERTEX4F, 16, 1, true},
+    {NV097_SET_VERTEX4S, 8, 1, true},
+    {NV097_SET_VERTEX_DATA2F_M, 8, kNumVertexAttributes, true},
+    {NV097_SET_VERTEX_DATA4F_M, 16, kNumVertexAttributes, true},
+    {NV097_SET_VERTEX_DATA2S, 4, kNumVertexAttributes, true},
+    {NV097_SET_VERTEX_DATA4UB, 4, kNumVertexAttributes, true},
+    {NV097_SET_VERTEX_DATA4S_M, 8, kNumVertexAttributes, true},
+    {NV097_SET_NORMAL3F, 12, 1, false},
+    {NV097_SET_NORMAL3S, 8, 1, false},
+    {NV097_SET_DIFFUSE_COLOR4F, 16, 1, false},
+    {NV097_SET_DIFFUSE_COLOR3F, 12, 1, false},
+    {NV097_SET_DIFFUSE_COLOR4I, 4, 1, false},
+    {NV097_SET_SPECULAR_COLOR4F, 16, 1, false},
+    {NV097_SET_SPECULAR_COLOR3F, 12, 1, false},
+    {NV097_SET_SPECULAR_COLOR4I, 4, 1, false},
+    {NV097_SET_TEXCOORD0_2F, 8, 1, false},
+    {NV097_SET_TEXCOORD0_2S, 4, 1, false},
+    {NV097_SET_TEXCOORD0_4F, 16, 1, false},
+    {NV097_SET_TEXCOORD0_4S, 8, 1, false},
+    {NV097_SET_TEXCOORD1_2F, 8, 1, false},
+    {NV097_SET_TEXCOORD1_2S, 4, 1, false},
+    {NV097_SET_TEXCOORD1_4F, 16, 1, false},
+    {NV097_SET_TEXCOORD1_4S, 8, 1, false},
+    {NV097_SET_TEXCOORD2_2F, 8, 1, false},
+    {NV097_SET_TEXCOORD2_2S, 4, 1, false},
+    {NV097_SET_TEXCOORD2_4F, 16, 1, false},
+    {NV097_SET_TEXCOORD2_4S, 8, 1, false},
+    {NV097_SET_TEXCOORD3_2F, 8, 1, false},
+    {NV097_SET_TEXCOORD3_2S, 4, 1, false},
+    {NV097_SET_TEXCOORD3_4F, 16, 1, false},
+    {NV097_SET_TEXCOORD3_4S, 8, 1, false},
+    {NV097_SET_WEIGHT1F, 4, 1, false},
+    {NV097_SET_WEIGHT2F, 8, 1, false},
+    {NV097_SET_WEIGHT3F, 12, 1, false},
+    {NV097_SET_WEIGHT4F, 16, 1, false},
+    {NV097_SET_FOG_COORD, 4, 1, false},
+    {NV097_SET_POINT_SIZE, 4, 1, false},
+};
+
+//! Returns true if the given method passes immediate mode vertex data, setting `emits_vertex` if the write completes a
+//! vertex.
+bool IsImmediateMethod(uint32_t method, bool &emits_vertex) {
+  for (auto &immediate : kImmediateMethods) {
+    if (method < immediate.method || method >= immediate.method + immediate.size * immediate.count) {
+      continue;
+    }
+
+    emits_vertex = immediate.addresses_position && method == immediate.method + immediate.size - 4;
+    return true;
+  }
+  return false;
+}
+
+uint32_t GetArrayAttributeSize(uint32_t format) {
+  auto size = (format & kArrayFormatSizeMask) >> kArrayFormatSizeShift;
+  switch (format & kArrayFormatTypeMask) {
+    case kArrayFormatTypeUBD3D:
+    case kArrayFormatTypeUBOGL:
+      return size;
+    case kArrayFormatTypeS1:
+    case kArrayFormatTypeS32K:
+      return size * 2;
+    case kArrayFormatTypeF:
+      return size * 4;
+    case kArrayFormatTypeCMP:
+      // Packed 11:11:10 normal.
+      return size ? 4 : 0;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+void PushbufferTraceFrameStats::Accumulate(const PushbufferTraceFrameStats &other) {
+  blocks += other.blocks;
+  dwords += other.dwords;
+  method_headers += other.method_headers;
+  calls += other.calls;
+  flushes += other.flushes;
+  wraps += other.wraps;
+  draws += other.draws;
+  draw_arrays_vertices += other.draw_arrays_vertices;
+  inline_array_vertices += other.inline_array_vertices;
+  inline_element_vertices += other.inline_element_vertices;
+  immediate_vertices += other.immediate_vertices;
+  state_changes += other.state_changes;
+  redundant_writes += other.redundant_writes;
+  inline_array_bytes += other.inline_array_bytes;
+  inline_element_bytes += other.inline_element_bytes;
+  immediate_bytes += other.immediate_bytes;
+  vertex_fetch_bytes += other.vertex_fetch_bytes;
+}
+
+bool PushbufferCostModel::LoadFile(const std::string &path, std::string &error) {
+  struct Coefficient {
+    const char *name;
+    double PushbufferCostModel::*value;
+  };
+
+  static constexpr Coefficient kCoefficients[] = {
+      {"cycles_per_dword", &PushbufferCostModel::cycles_per_dword},
+      {"cycles_per_method_header", &PushbufferCostModel::cycles_per_method_header},
+      {"cycles_per_state_change", &PushbufferCostModel::cycles_per_state_change},
+      {"cycles_per_draw", &PushbufferCostModel::cycles_per_draw},
+      {"cycles_per_array_vertex", &PushbufferCostModel::cycles_per_array_vertex},
+      {"cycles_per_inline_array_vertex", &PushbufferCostModel::cycles_per_inline_array_vertex},
+      {"cycles_per_immediate_vertex", &PushbufferCostModel::cycles_per_immediate_vertex},
+      {"cycles_per_call", &PushbufferCostModel::cycles_per_call},
+      {"pushbuffer_bytes_per_cycle", &PushbufferCostModel::pushbuffer_bytes_per_cycle},
+      {"vertex_fetch_bytes_per_cycle", &PushbufferCostModel::vertex_fetch_bytes_per_cycle},
+  };
+
+  std::ifstream file(path);
+  if (!file) {
+    error = "Failed to open " + path;
+    return false;
+  }
+
+  static constexpr char kWhitespace[] = " \t\r";
+  std::string line;
+  for (uint32_t line_number = 1; std::getline(file, line); ++line_number) {
+    auto start = line.find_first_not_of(kWhitespace);
+    if (start == std::string::npos || line[start] == '#') {
+      continue;
+    }
+
+    auto separator = line.find('=', start);
+    if (separator == std::string::npos) {
+      error = path + ":" + std::to_string(line_number) + ": expected `name = value`";
+      return false;
+    }
+
+    auto name_end = line.find_last_not_of(kWhitespace, separator - 1);
+    auto name = line.substr(start, name_end == std::string::npos ? 0 : name_end - start + 1);
+    auto value_string = line.substr(separator + 1);
+    char *value_end;
+    auto value = strtod(value_string.c_str(), &value_end);
+    if (value_end == value_string.c_str()) {
+      error = path + ":" + std::to_string(line_number) + ": invalid value for " + name;
+      return false;
+    }
+
+    bool found = false;
+    for (auto &coefficient : kCoefficients) {
+      if (name == coefficient.name) {
+        this->*coefficient.value = value;
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      error = path + ":" + std::to_string(line_number) + ": unknown coefficient " + name;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void PushbufferTraceAnalyzer::Analyze(const std::vector<PushbufferCaptureEntry> &entries) {
+  frames_.clear();
+  shadow_.Invalidate();
+  std::fill(std::begin(array_formats_), std::end(array_formats_), 0);
+  pending_inline_array_dwords_ = 0;
+
+  PushbufferTraceFrameStats frame;
+  bool frame_has_entries = false;
+
+  for (auto &entry : entries) {
+    frame_has_entries = true;
+
+    switch (entry.type) {
+      case PushbufferCaptureEntry::BLOCK:
+        ++frame.blocks;
+        frame.dwords += entry.value;
+        break;
+
+      case PushbufferCaptureEntry::METHOD:
+        ++frame.method_headers;
+        ProcessMethod(entry, frame);
+        break;
+
+      case PushbufferCaptureEntry::CALL:
+        ++frame.calls;
+        // Indices submitted by a subroutine (e.g., an IndexBuffer) are not captured, but their count may be known.
+        frame.inline_element_vertices += entry.num_indices;
+        frame.vertex_fetch_bytes += static_cast<uint64_t>(entry.num_indices) * GetArrayVertexSize();
+        break;
+
+      case PushbufferCaptureEntry::FLUSH:
+        ++frame.flushes;
+        break;
+
+      case PushbufferCaptureEntry::WRAP:
+        ++frame.wraps;
+        break;
+
+      case PushbufferCaptureEntry::FRAME_END:
+        frames_.push_back(frame);
+        frame = {};
+        frame_has_entries = false;
+        // NV2AState::FinishDraw invalidates its shadow as pbkit reprograms the surface registers directly. Captures
+        // made before INVALIDATE records were introduced rely on this.
+        shadow_.Invalidate();
+        break;
+
+      case PushbufferCaptureEntry::INVALIDATE:
+        shadow_.Invalidate();
+        break;
+
+      case PushbufferCaptureEntry::JUMP:
+      case PushbufferCaptureEntry::RETURN:
+      case PushbufferCaptureEntry::UNKNOWN:
+        break;
+    }
+  }
+
+  if (frame_has_entries) {
+    frames_.push_back(frame);
+  }
+}
+
+void PushbufferTraceAnalyzer::ProcessMethod(const PushbufferCaptureEntry &entry, PushbufferTraceFrameStats &stats) {
+  if (entry.subchannel != subchannel_3d_) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < entry.params.size(); ++i) {
+    ProcessWrite(entry.GetParamMethod(i), entry.params[i], stats);
+  }
+}
+
+void PushbufferTraceAnalyzer::ProcessWrite(uint32_t method, uint32_t value, PushbufferTraceFrameStats &stats) {
+  switch (method) {
+    case NV097_SET_BEGIN_END:
+      if (value == NV097_SET_BEGIN_END_OP_END) {
+        ++stats.draws;
+        if (pending_inline_array_dwords_) {
+          auto vertex_dwords = GetInlineVertexDwords();
+          if (vertex_dwords) {
+            stats.inline_array_vertices += pending_inline_array_dwords_ / vertex_dwords;
+          }
+          pending_inline_array_dwords_ = 0;
+        }
+      }
+      return;
+
+    case NV097_DRAW_ARRAYS: {
+      uint32_t count = (value >> kDrawArraysCountShift) + 1;
+      stats.draw_arrays_vertices += count;
+      stats.vertex_fetch_bytes += static_cast<uint64_t>(count) * GetArrayVertexSize();
+      return;
+    }
+
+    case NV097_INLINE_ARRAY:
+      ++pending_inline_array_dwords_;
+      stats.inline_array_bytes += 4;
+      return;
+
+    case NV097_ARRAY_ELEMENT16:
+      stats.inline_element_vertices += 2;
+      stats.inline_element_bytes += 4;
+      stats.vertex_fetch_bytes += 2ull * GetArrayVertexSize();
+      return;
+
+    case NV097_ARRAY_ELEMENT32:
+      ++stats.inline_element_vertices;
+      stats.inline_element_bytes += 4;
+      stats.vertex_fetch_bytes += GetArrayVertexSize();
+      return;
+
+    default:
+      break;
+  }
+
+  bool emits_vertex = false;
+  if (IsImmediateMethod(method, emits_vertex)) {
+    stats.immediate_bytes += 4;
+    if (emits_vertex) {
+      ++stats.immediate_vertices;
+    }
+    return;
+  }
+
+  if (RegisterShadow::IsVolatileMethod(method)) {
+    return;
+  }
+
+  if (method >= NV097_SET_VERTEX_DATA_ARRAY_FORMAT &&
+      method < NV097_SET_VERTEX_DATA_ARRAY_FORMAT + kNumVertexAttributes * 4) {
+    array_formats_[(method - NV097_SET_VERTEX_DATA_ARRAY_FORMAT) / 4] = value;
+  }
+
+  ++stats.state_changes;
+  if (shadow_.IsRedundant(method, 1, &value)) {
+    ++stats.redundant_writes;
+  } else {
+    shadow_.Update(method, 1, &value);
+  }
+}
+
+uint32_t PushbufferTraceAnalyzer::GetArrayVertexSize() const {
+  uint32_t size = 0;
+  for (auto format : array_formats_) {
+    size += GetArrayAttributeSize(format);
+  }
+  return size;
+}
+
+uint32_t PushbufferTraceAnalyzer::GetInlineVertexDwords() const {
+  // Each attribute within an inline array vertex starts on a dword boundary.
+  uint32_t dwords = 0;
+  for (auto format : array_formats_) {
+    dwords += (GetArrayAttributeSize(format) + 3) / 4;
+  }
+  return dwords;
+}
+
+PushbufferTraceFrameStats PushbufferTraceAnalyzer::GetTotals() const {
+  PushbufferTraceFrameStats totals;
+  for (auto &frame : frames_) {
+    totals.Accumulate(frame);
+  }
+  return totals;
+}
+
+PushbufferCostEstimate PushbufferTraceAnalyzer::EstimateCost(const PushbufferTraceFrameStats &stats,
+                                                             const PushbufferCostModel &model) {
+  PushbufferCostEstimate estimate;
+
+  estimate.front_end_cycles = static_cast<double>(stats.dwords) * model.cycles_per_dword +
+                              static_cast<double>(stats.method_headers) * model.cycles_per_method_header +
+                              static_cast<double>(stats.state_changes) * model.cycles_per_state_change +
+                              static_cast<double>(stats.draws) * model.cycles_per_draw +
+                              static_cast<double>(stats.draw_arrays_vertices + stats.inline_element_vertices) *
+                                  model.cycles_per_array_vertex +
+                              static_cast<double>(stats.inline_array_vertices) * model.cycles_per_inline_array_vertex +
+                              static_cast<double>(stats.immediate_vertices) * model.cycles_per_immediate_vertex +
+                              static_cast<double>(stats.calls) * model.cycles_per_call;
+
+  if (model.pushbuffer_bytes_per_cycle > 0.0) {
+    estimate.transfer_cycles += static_cast<double>(stats.dwords * 4) / model.pushbuffer_bytes_per_cycle;
+  }
+  if (model.vertex_fetch_bytes_per_cycle > 0.0) {
+    estimate.transfer_cycles += static_cast<double>(stats.vertex_fetch_bytes) / model.vertex_fetch_bytes_per_cycle;
+  }
+
+  return estimate;
+}
+
+}  // namespace PBKitPlusPlus
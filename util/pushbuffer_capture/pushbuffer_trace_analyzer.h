@@ -0,0 +1,152 @@
+#ifndef PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_PUSHBUFFER_TRACE_ANALYZER_H_
+#define PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_PUSHBUFFER_TRACE_ANALYZER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pushbuffer_capture_reader.h"
+#include "register_shadow.h"
+
+namespace PBKitPlusPlus {
+
+//! Statistics gathered from the commands submitted during a single frame.
+struct PushbufferTraceFrameStats {
+  //! Number of pushbuffer blocks.
+  uint32_t blocks = 0;
+  //! Total number of dwords fetched by the front end, including method headers and inline data.
+  uint64_t dwords = 0;
+  //! Number of method headers.
+  uint64_t method_headers = 0;
+  //! Number of subroutine calls (e.g., resident CommandLists).
+  uint32_t calls = 0;
+  uint32_t flushes = 0;
+  uint32_t wraps = 0;
+
+  //! Number of NV097_SET_BEGIN_END pairs.
+  uint32_t draws = 0;
+  //! Vertices submitted via NV097_DRAW_ARRAYS.
+  uint64_t draw_arrays_vertices = 0;
+  //! Vertices submitted via NV097_INLINE_ARRAY.
+  uint64_t inline_array_vertices = 0;
+  //! Vertices submitted via NV097_ARRAY_ELEMENT16/32, including those in subroutines with a recorded index count.
+  uint64_t inline_element_vertices = 0;
+  //! Vertices submitted via immediate mode position writes (e.g., NV097_SET_VERTEX3F).
+  uint64_t immediate_vertices = 0;
+
+  //! Number of register writes that do not trigger work, excluding writes to other subchannels.
+  uint64_t state_changes = 0;
+  //! Number of state changes that wrote the value already held by the register.
+  uint64_t redundant_writes = 0;
+
+  //! Bytes of vertex data passed through NV097_INLINE_ARRAY.
+  uint64_t inline_array_bytes = 0;
+  //! Bytes of indices passed through NV097_ARRAY_ELEMENT16/32.
+  uint64_t inline_element_bytes = 0;
+  //! Bytes of vertex data passed through immediate mode attribute methods.
+  uint64_t immediate_bytes = 0;
+  //! Estimated bytes of vertex data fetched from memory by DrawArrays and inline element draws.
+  uint64_t vertex_fetch_bytes = 0;
+
+  //! Returns the total number of vertices submitted through any path.
+  [[nodiscard]] uint64_t GetTotalVertices() const {
+    return draw_arrays_vertices + inline_array_vertices + inline_element_vertices + immediate_vertices;
+  }
+
+  //! Returns the total number of bytes of vertex data and indices embedded in the pushbuffer.
+  [[nodiscard]] uint64_t GetInlineDataBytes() const {
+    return inline_array_bytes + inline_element_bytes + immediate_bytes;
+  }
+
+  void Accumulate(const PushbufferTraceFrameStats &other);
+};
+
+//! Coefficients used to estimate the cost of a frame.
+//!
+//! The defaults are coarse approximations of the nv2a front end and are intended for comparing strategies against each
+//! other rather than for predicting absolute frame times. All costs are in GPU clock cycles.
+struct PushbufferCostModel {
+  //! Cost for the front end to fetch and decode a single pushbuffer dword.
+  double cycles_per_dword = 1.0;
+  //! Additional cost of each method header.
+  double cycles_per_method_header = 1.0;
+  //! Additional cost of each state change (e.g., pipeline revalidation).
+  double cycles_per_state_change = 2.0;
+  //! Fixed cost of each begin/end pair.
+  double cycles_per_draw = 200.0;
+  //! Cost of setting up a vertex fetched from memory (DrawArrays and inline elements).
+  double cycles_per_array_vertex = 2.0;
+  //! Cost of assembling a vertex from NV097_INLINE_ARRAY data.
+  double cycles_per_inline_array_vertex = 4.0;
+  //! Cost of assembling a vertex from immediate mode attribute writes.
+  double cycles_per_immediate_vertex = 8.0;
+  //! Cost of each subroutine call and its return.
+  double cycles_per_call = 20.0;
+  //! Bytes per cycle available to the front end when reading the pushbuffer.
+  double pushbuffer_bytes_per_cycle = 4.0;
+  //! Bytes per cycle available to the vertex fetcher when reading vertex arrays.
+  double vertex_fetch_bytes_per_cycle = 8.0;
+
+  //! Loads coefficients from a text file containing `name = value` lines. Lines starting with '#' are ignored, as are
+  //! coefficients that are not present in the file. Returns false and sets `error` on failure.
+  bool LoadFile(const std::string &path, std::string &error);
+};
+
+//! The estimated cost of a frame.
+struct PushbufferCostEstimate {
+  //! Cycles spent by the front end decoding commands and assembling vertices.
+  double front_end_cycles = 0.0;
+  //! Cycles spent transferring pushbuffer and vertex data from memory.
+  double transfer_cycles = 0.0;
+
+  //! Returns the estimated cost of the frame. Command processing and transfers overlap, so the more expensive of the
+  //! two bounds the frame.
+  [[nodiscard]] double GetTotalCycles() const {
+    return front_end_cycles > transfer_cycles ? front_end_cycles : transfer_cycles;
+  }
+};
+
+//! Computes per-frame statistics from decoded pushbuffer entries.
+//!
+//! Frames are delimited by FRAME_END entries. Entries after the final FRAME_END (or all entries, if the trace has no
+//! frame markers) are reported as a trailing frame. Commands executed via subroutine calls (e.g., resident
+//! CommandLists) are not part of the capture and are only reflected in the `calls` count, except that the vertices of
+//! calls with a recorded index count (e.g., IndexBuffer draws) are counted as inline element vertices.
+class PushbufferTraceAnalyzer {
+ public:
+  explicit PushbufferTraceAnalyzer(uint32_t subchannel_3d = 0) : subchannel_3d_(subchannel_3d) {}
+
+  //! Analyzes the given entries, replacing the results of any previous call.
+  void Analyze(const std::vector<PushbufferCaptureEntry> &entries);
+
+  //! Returns the statistics for each frame in the trace.
+  [[nodiscard]] const std::vector<PushbufferTraceFrameStats> &GetFrames() const { return frames_; }
+
+  //! Returns the sum of the statistics for all frames.
+  [[nodiscard]] PushbufferTraceFrameStats GetTotals() const;
+
+  //! Estimates the cost of a frame with the given statistics.
+  static PushbufferCostEstimate EstimateCost(const PushbufferTraceFrameStats &stats, const PushbufferCostModel &model);
+
+ private:
+  void ProcessMethod(const PushbufferCaptureEntry &entry, PushbufferTraceFrameStats &stats);
+  void ProcessWrite(uint32_t method, uint32_t value, PushbufferTraceFrameStats &stats);
+
+  //! Returns the number of bytes occupied by a single vertex in the enabled vertex arrays.
+  [[nodiscard]] uint32_t GetArrayVertexSize() const;
+
+  //! Returns the number of dwords occupied by a single vertex passed via NV097_INLINE_ARRAY.
+  [[nodiscard]] uint32_t GetInlineVertexDwords() const;
+
+  uint32_t subchannel_3d_;
+  std::vector<PushbufferTraceFrameStats> frames_;
+  RegisterShadow shadow_;
+  //! The most recent value written to each NV097_SET_VERTEX_DATA_ARRAY_FORMAT register.
+  uint32_t array_formats_[16]{};
+  //! Number of inline array dwords submitted within the current begin/end pair.
+  uint64_t pending_inline_array_dwords_ = 0;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_PUSHBUFFER_TRACE_ANALYZER_H_
@@ -0,0 +1,80 @@
+#include "redundant_state_analyzer.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace PBKitPlusPlus {
+
+void RedundantStateAnalyzer::Analyze(const std::vector<PushbufferCaptureEntry> &entries) {
+  shadow_.Invalidate();
+  sites_.clear();
+  site_indices_.clear();
+  total_writes_ = 0;
+  total_redundant_writes_ = 0;
+
+  for (auto &entry : entries) {
+    if (entry.type == PushbufferCaptureEntry::FRAME_END || entry.type == PushbufferCaptureEntry::INVALIDATE) {
+      shadow_.Invalidate();
+      continue;
+    }
+
+    if (entry.type != PushbufferCaptureEntry::METHOD || entry.subchannel != subchannel_3d_) {
+      continue;
+    }
+
+    for (uint32_t i = 0; i < entry.params.size(); ++i) {
+      ProcessWrite(entry.tag, entry.GetParamMethod(i), entry.params[i]);
+    }
+  }
+}
+
+void RedundantStateAnalyzer::ProcessWrite(uint32_t tag, uint32_t method, uint32_t value) {
+  if (RegisterShadow::IsVolatileMethod(method)) {
+    return;
+  }
+
+  auto register_index = method / 4;
+  auto key = static_cast<size_t>(tag) * RegisterShadow::kNumRegisters + register_index;
+  if (key >= site_indices_.size()) {
+    site_indices_.resize((static_cast<size_t>(tag) + 1) * RegisterShadow::kNumRegisters, 0);
+  }
+  if (!site_indices_[key]) {
+    sites_.push_back({tag, method, 0, 0});
+    site_indices_[key] = static_cast<uint32_t>(sites_.size());
+  }
+  auto &site = sites_[site_indices_[key] - 1];
+
+  ++site.writes;
+  ++total_writes_;
+
+  if (shadow_.IsRedundant(method, 1, &value)) {
+    ++site.redundant_writes;
+    ++total_redundant_writes_;
+  } else {
+    shadow_.Update(method, 1, &value);
+  }
+}
+
+std::vector<RedundantWriteSite> RedundantStateAnalyzer::GetRedundantSites() const {
+  std::vector<RedundantWriteSite> ret;
+  std::copy_if(sites_.begin(), sites_.end(), std::back_inserter(ret),
+               [](const RedundantWriteSite &site) { return site.redundant_writes != 0; });
+
+  std::stable_sort(ret.begin(), ret.end(), [](const RedundantWriteSite &a, const RedundantWriteSite &b) {
+    return a.redundant_writes > b.redundant_writes;
+  });
+  return ret;
+}
+
+std::vector<uint64_t> RedundantStateAnalyzer::GetRedundantWritesByTag() const {
+  std::vector<uint64_t> ret;
+  for (auto &site : sites_) {
+    if (site.tag >= ret.size()) {
+      ret.resize(site.tag + 1, 0);
+    }
+    ret[site.tag] += site.redundant_writes;
+  }
+  return ret;
+}
+
+}  // namespace PBKitPlusPlus
@@ -0,0 +1,65 @@
+#ifndef PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_REDUNDANT_STATE_ANALYZER_H_
+#define PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_REDUNDANT_STATE_ANALYZER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "pushbuffer_capture_reader.h"
+#include "register_shadow.h"
+
+namespace PBKitPlusPlus {
+
+//! Counts the writes made to a single register by a single call site.
+struct RedundantWriteSite {
+  //! The call site tag, as an index for PushbufferCaptureReader::GetTagName.
+  uint32_t tag;
+  //! The method that was written.
+  uint32_t method;
+  //! Total number of writes.
+  uint64_t writes;
+  //! Number of writes that left the register unchanged.
+  uint64_t redundant_writes;
+};
+
+//! Tracks the NV097 register state implied by a pushbuffer trace and reports writes that leave it unchanged.
+//!
+//! Writes are attributed to the call site tags recorded by CapturePushbufferBackend (see PBKPP_TAG_CALL_SITE). Methods
+//! that trigger work (see RegisterShadow::IsVolatileMethod) are never considered redundant. The tracked state is
+//! discarded at INVALIDATE entries (written whenever Pushbuffer::InvalidateShadowRegisters is called, e.g., after
+//! pb_fill) and at the end of each frame.
+class RedundantStateAnalyzer {
+ public:
+  explicit RedundantStateAnalyzer(uint32_t subchannel_3d = 0) : subchannel_3d_(subchannel_3d) {}
+
+  //! Analyzes the given entries, replacing the results of any previous call.
+  void Analyze(const std::vector<PushbufferCaptureEntry> &entries);
+
+  //! Returns every (call site, method) pair that performed at least one redundant write, ordered by descending number of
+  //! redundant writes.
+  [[nodiscard]] std::vector<RedundantWriteSite> GetRedundantSites() const;
+
+  //! Returns the total number of redundant writes made by each call site, indexed by tag.
+  [[nodiscard]] std::vector<uint64_t> GetRedundantWritesByTag() const;
+
+  //! Returns the total number of state writes that were analyzed.
+  [[nodiscard]] uint64_t GetTotalWrites() const { return total_writes_; }
+
+  //! Returns the total number of redundant writes.
+  [[nodiscard]] uint64_t GetTotalRedundantWrites() const { return total_redundant_writes_; }
+
+ private:
+  void ProcessWrite(uint32_t tag, uint32_t method, uint32_t value);
+
+  uint32_t subchannel_3d_;
+  RegisterShadow shadow_;
+  //! Counters for each (tag, register) pair that has been written.
+  std::vector<RedundantWriteSite> sites_;
+  //! Maps (tag, register) pairs to indices in sites_ (plus one), with RegisterShadow::kNumRegisters entries per tag.
+  std::vector<uint32_t> site_indices_;
+  uint64_t total_writes_ = 0;
+  uint64_t total_redundant_writes_ = 0;
+};
+
+}  // namespace PBKitPlusPlus
+
+#endif  // PBKITPLUSPLUS_UTIL_PUSHBUFFER_CAPTURE_REDUNDANT_STATE_ANALYZER_H_